@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_CACHE_PRIVATE_H__
+#define __GOVF_CACHE_PRIVATE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* identifies the file a cache entry was made from */
+typedef struct
+{
+	guint64			  dev;
+	guint64			  ino;
+	guint64			  size;
+	gint64			  mtime_nsec;
+} GovfCacheKey;
+
+gboolean		  govf_cache_key_init		(GovfCacheKey		 *key,
+							 const gchar		 *filename);
+gboolean		  govf_cache_key_init_from_fd	(GovfCacheKey		 *key,
+							 gint			  fd);
+gboolean		  govf_cache_key_equal		(const GovfCacheKey	 *a,
+							 const GovfCacheKey	 *b);
+GVariant		 *govf_cache_lookup		(const gchar		 *cache_dir,
+							 const GovfCacheKey	 *key,
+							 const GVariantType	 *type);
+gboolean		  govf_cache_store		(const gchar		 *cache_dir,
+							 const GovfCacheKey	 *key,
+							 GVariant		 *entry,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __GOVF_CACHE_PRIVATE_H__ */
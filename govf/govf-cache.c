@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "govf-cache-private.h"
+#include "govf-package.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* bumped whenever the layout of an entry changes; an entry written on a
+ * host of the other byte order reads back with a byteswapped version,
+ * and is ignored like any other mismatch */
+#define CACHE_VERSION 1
+#define CACHE_VARIANT_TYPE "(u(tttx)v)"
+
+/* one entry per file, so that a file changing in place replaces its
+ * entry instead of leaving a stale one behind */
+static gchar *
+cache_path (const gchar *cache_dir, const GovfCacheKey *key)
+{
+	g_autofree gchar *basename = NULL;
+
+	basename = g_strdup_printf ("%" G_GINT64_MODIFIER "x-%" G_GINT64_MODIFIER "x.gvariant",
+	                            key->dev,
+	                            key->ino);
+	return g_build_filename (cache_dir, basename, NULL);
+}
+
+static gboolean
+cache_key_init_from_stat (GovfCacheKey *key, const struct stat *st)
+{
+	if (!S_ISREG (st->st_mode))
+		return FALSE;
+
+	key->dev = st->st_dev;
+	key->ino = st->st_ino;
+	key->size = st->st_size;
+	key->mtime_nsec = (gint64) st->st_mtim.tv_sec * G_GINT64_CONSTANT (1000000000) +
+	                  st->st_mtim.tv_nsec;
+	return TRUE;
+}
+
+gboolean
+govf_cache_key_init (GovfCacheKey *key, const gchar *filename)
+{
+	struct stat st;
+
+	if (stat (filename, &st) != 0)
+		return FALSE;
+
+	return cache_key_init_from_stat (key, &st);
+}
+
+/* the key of the file actually opened, which a path may no longer lead to */
+gboolean
+govf_cache_key_init_from_fd (GovfCacheKey *key, gint fd)
+{
+	struct stat st;
+
+	if (fstat (fd, &st) != 0)
+		return FALSE;
+
+	return cache_key_init_from_stat (key, &st);
+}
+
+gboolean
+govf_cache_key_equal (const GovfCacheKey *a, const GovfCacheKey *b)
+{
+	return a->dev == b->dev &&
+	       a->ino == b->ino &&
+	       a->size == b->size &&
+	       a->mtime_nsec == b->mtime_nsec;
+}
+
+/* maps the entry for @key and returns its contents, which keep the
+ * mapping alive; entries are never written in place, so a mapping stays
+ * valid when another process replaces the entry */
+GVariant *
+govf_cache_lookup (const gchar        *cache_dir,
+                   const GovfCacheKey *key,
+                   const GVariantType *type)
+{
+	g_autofree gchar *path = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GMappedFile) mapped = NULL;
+	g_autoptr(GVariant) entry = NULL;
+	g_autoptr(GVariant) variant = NULL;
+	GovfCacheKey stored;
+	guint32 version;
+
+	path = cache_path (cache_dir, key);
+	mapped = g_mapped_file_new (path, FALSE, &error);
+	if (mapped == NULL) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_debug ("Cannot map %s: %s", path, error->message);
+		return NULL;
+	}
+
+	/* the accessors cope with any contents, so a corrupt entry only
+	 * turns into a mismatch */
+	bytes = g_mapped_file_get_bytes (mapped);
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_VARIANT_TYPE),
+	                                                        bytes,
+	                                                        FALSE));
+	g_variant_get (variant,
+	               CACHE_VARIANT_TYPE,
+	               &version,
+	               &stored.dev,
+	               &stored.ino,
+	               &stored.size,
+	               &stored.mtime_nsec,
+	               &entry);
+
+	if (version != CACHE_VERSION ||
+	    !govf_cache_key_equal (key, &stored) ||
+	    !g_variant_is_of_type (entry, type)) {
+		g_debug ("Ignoring stale cache entry %s", path);
+		return NULL;
+	}
+
+	return g_steal_pointer (&entry);
+}
+
+/* writes the entry to a temporary file which is then renamed over the
+ * old one, so concurrent readers see either entry whole */
+gboolean
+govf_cache_store (const gchar         *cache_dir,
+                  const GovfCacheKey  *key,
+                  GVariant            *entry,
+                  GError             **error)
+{
+	g_autofree gchar *path = NULL;
+	g_autoptr(GVariant) variant = NULL;
+
+	if (g_mkdir_with_parents (cache_dir, 0755) != 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot create %s: %s",
+		             cache_dir,
+		             g_strerror (errno));
+		return FALSE;
+	}
+
+	variant = g_variant_ref_sink (g_variant_new (CACHE_VARIANT_TYPE,
+	                                             (guint32) CACHE_VERSION,
+	                                             key->dev,
+	                                             key->ino,
+	                                             key->size,
+	                                             key->mtime_nsec,
+	                                             entry));
+
+	path = cache_path (cache_dir, key);
+	return g_file_set_contents (path,
+	                            g_variant_get_data (variant),
+	                            g_variant_get_size (variant),
+	                            error);
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "govf-catalog-entry.h"
+
+struct _GovfCatalogEntry
+{
+	GObject			  parent_instance;
+
+	gchar			 *filename;
+	gchar			 *name;
+	const gchar		 *os_id;
+	GPtrArray		 *disks;
+	GError			 *error;
+};
+
+G_DEFINE_TYPE (GovfCatalogEntry, govf_catalog_entry, G_TYPE_OBJECT)
+
+/**
+ * govf_catalog_entry_get_filename:
+ * @self: a #GovfCatalogEntry
+ *
+ * Returns the file the entry was loaded from.
+ *
+ * Returns: (transfer none): the file name
+ */
+const gchar *
+govf_catalog_entry_get_filename (GovfCatalogEntry *self)
+{
+	return self->filename;
+}
+
+/**
+ * govf_catalog_entry_get_name:
+ * @self: a #GovfCatalogEntry
+ *
+ * Returns the name of the virtual system in the package.
+ *
+ * Returns: (transfer none) (nullable): the name
+ */
+const gchar *
+govf_catalog_entry_get_name (GovfCatalogEntry *self)
+{
+	return self->name;
+}
+
+/**
+ * govf_catalog_entry_set_name:
+ * @self: a #GovfCatalogEntry
+ * @name: (nullable): name of the virtual system
+ *
+ * Sets the name of the virtual system in the package.
+ */
+void
+govf_catalog_entry_set_name (GovfCatalogEntry *self,
+                             const gchar      *name)
+{
+	g_free (self->name);
+	self->name = g_strdup (name);
+}
+
+/**
+ * govf_catalog_entry_get_os_id:
+ * @self: a #GovfCatalogEntry
+ *
+ * Returns the CIM operating system id of the virtual system in the
+ * package, see govf_package_get_os_id().
+ *
+ * Returns: (transfer none) (nullable): the operating system id
+ */
+const gchar *
+govf_catalog_entry_get_os_id (GovfCatalogEntry *self)
+{
+	return self->os_id;
+}
+
+/**
+ * govf_catalog_entry_set_os_id:
+ * @self: a #GovfCatalogEntry
+ * @os_id: (nullable): operating system id of the virtual system
+ *
+ * Sets the operating system id of the virtual system in the package.
+ */
+void
+govf_catalog_entry_set_os_id (GovfCatalogEntry *self,
+                              const gchar      *os_id)
+{
+	/* few distinct values across a whole catalog */
+	self->os_id = g_intern_string (os_id);
+}
+
+/**
+ * govf_catalog_entry_get_disks:
+ * @self: a #GovfCatalogEntry
+ *
+ * Returns the disks in the package, along with their capacities.
+ *
+ * Returns: (element-type GovfDisk) (transfer full) (nullable): an array
+ */
+GPtrArray *
+govf_catalog_entry_get_disks (GovfCatalogEntry *self)
+{
+	if (self->disks == NULL)
+		return NULL;
+
+	return g_ptr_array_ref (self->disks);
+}
+
+/**
+ * govf_catalog_entry_set_disks:
+ * @self: a #GovfCatalogEntry
+ * @disks: (element-type GovfDisk) (nullable): an array of disks
+ *
+ * Sets the disks in the package.
+ */
+void
+govf_catalog_entry_set_disks (GovfCatalogEntry *self,
+                              GPtrArray        *disks)
+{
+	g_clear_pointer (&self->disks, g_ptr_array_unref);
+	if (disks != NULL)
+		self->disks = g_ptr_array_ref (disks);
+}
+
+/**
+ * govf_catalog_entry_get_error:
+ * @self: a #GovfCatalogEntry
+ *
+ * Returns the error loading the package failed with.
+ *
+ * Returns: (transfer none) (nullable): a #GError, or %NULL if the package
+ *   was loaded
+ */
+const GError *
+govf_catalog_entry_get_error (GovfCatalogEntry *self)
+{
+	return self->error;
+}
+
+/**
+ * govf_catalog_entry_set_error:
+ * @self: a #GovfCatalogEntry
+ * @error: (nullable): a #GError, or %NULL
+ *
+ * Sets the error loading the package failed with.
+ */
+void
+govf_catalog_entry_set_error (GovfCatalogEntry *self,
+                              const GError     *error)
+{
+	g_clear_error (&self->error);
+	if (error != NULL)
+		self->error = g_error_copy (error);
+}
+
+/**
+ * govf_catalog_entry_new:
+ * @filename: the file the entry is for
+ *
+ * Creates a new, empty #GovfCatalogEntry. See govf_catalog_scan_dir().
+ *
+ * Returns: (transfer full): a #GovfCatalogEntry
+ */
+GovfCatalogEntry *
+govf_catalog_entry_new (const gchar *filename)
+{
+	GovfCatalogEntry *self;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	self = g_object_new (GOVF_TYPE_CATALOG_ENTRY, NULL);
+	self->filename = g_strdup (filename);
+
+	return self;
+}
+
+static void
+govf_catalog_entry_finalize (GObject *object)
+{
+	GovfCatalogEntry *self = GOVF_CATALOG_ENTRY (object);
+
+	g_free (self->filename);
+	g_free (self->name);
+	if (self->disks != NULL)
+		g_ptr_array_unref (self->disks);
+	g_clear_error (&self->error);
+
+	G_OBJECT_CLASS (govf_catalog_entry_parent_class)->finalize (object);
+}
+
+static void
+govf_catalog_entry_class_init (GovfCatalogEntryClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = govf_catalog_entry_finalize;
+}
+
+static void
+govf_catalog_entry_init (GovfCatalogEntry *self)
+{
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_CATALOG_ENTRY_H__
+#define __GOVF_CATALOG_ENTRY_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GOVF_TYPE_CATALOG_ENTRY (govf_catalog_entry_get_type ())
+G_DECLARE_FINAL_TYPE (GovfCatalogEntry, govf_catalog_entry, GOVF, CATALOG_ENTRY, GObject)
+
+GovfCatalogEntry	 *govf_catalog_entry_new		(const gchar		 *filename);
+const gchar		 *govf_catalog_entry_get_filename	(GovfCatalogEntry	 *self);
+const gchar		 *govf_catalog_entry_get_name		(GovfCatalogEntry	 *self);
+void			  govf_catalog_entry_set_name		(GovfCatalogEntry	 *self,
+								 const gchar		 *name);
+const gchar		 *govf_catalog_entry_get_os_id		(GovfCatalogEntry	 *self);
+void			  govf_catalog_entry_set_os_id		(GovfCatalogEntry	 *self,
+								 const gchar		 *os_id);
+GPtrArray		 *govf_catalog_entry_get_disks		(GovfCatalogEntry	 *self);
+void			  govf_catalog_entry_set_disks		(GovfCatalogEntry	 *self,
+								 GPtrArray		 *disks);
+const GError		 *govf_catalog_entry_get_error		(GovfCatalogEntry	 *self);
+void			  govf_catalog_entry_set_error		(GovfCatalogEntry	 *self,
+								 const GError		 *error);
+
+G_END_DECLS
+
+#endif /* __GOVF_CATALOG_ENTRY_H__ */
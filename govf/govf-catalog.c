@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "govf-catalog.h"
+#include "govf-package.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* a package file to load, with what it is ordered by */
+typedef struct
+{
+	gchar			 *filename;
+	guint64			  dev;
+	guint64			  ino;
+} GovfCatalogItem;
+
+/* state shared by the workers of a single scan */
+typedef struct
+{
+	GovfCatalog		 *catalog;
+	GCancellable		 *cancellable;
+	GAsyncQueue		 *results;
+} GovfCatalogScan;
+
+struct _GovfCatalog
+{
+	GObject			  parent_instance;
+
+	guint			  max_threads;
+	gchar			 *cache_dir;
+};
+
+G_DEFINE_TYPE (GovfCatalog, govf_catalog, G_TYPE_OBJECT)
+
+static gboolean
+has_suffix_nocase (const gchar *name, const gchar *suffix)
+{
+	gsize len = strlen (name);
+	gsize suffix_len = strlen (suffix);
+
+	return len >= suffix_len && g_ascii_strcasecmp (name + len - suffix_len, suffix) == 0;
+}
+
+static void
+catalog_item_free (GovfCatalogItem *item)
+{
+	g_free (item->filename);
+	g_slice_free (GovfCatalogItem, item);
+}
+
+static GovfCatalogItem *
+catalog_item_new (const gchar *filename, const struct stat *st)
+{
+	GovfCatalogItem *item;
+
+	item = g_slice_new0 (GovfCatalogItem);
+	item->filename = g_strdup (filename);
+	if (st != NULL) {
+		item->dev = st->st_dev;
+		item->ino = st->st_ino;
+	}
+
+	return item;
+}
+
+/* on a cold page cache, loading files in inode order mostly keeps the
+ * reads moving forward on the disk */
+static gint
+catalog_item_compare (gconstpointer a, gconstpointer b)
+{
+	const GovfCatalogItem *item_a = *(GovfCatalogItem **) a;
+	const GovfCatalogItem *item_b = *(GovfCatalogItem **) b;
+
+	if (item_a->dev != item_b->dev)
+		return item_a->dev < item_b->dev ? -1 : 1;
+	if (item_a->ino != item_b->ino)
+		return item_a->ino < item_b->ino ? -1 : 1;
+	return 0;
+}
+
+/* collects the .ova and .ovf files below @path; symlinks to files are
+ * followed, symlinks to directories are not, and subdirectories that
+ * can't be read are left out */
+static gboolean
+collect_dir (const gchar   *path,
+             GPtrArray     *items,
+             GCancellable  *cancellable,
+             GError       **error)
+{
+	g_autoptr(GDir) dir = NULL;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, error);
+	if (dir == NULL)
+		return FALSE;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar *filename = NULL;
+		g_autoptr(GError) error_local = NULL;
+		struct stat st;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return FALSE;
+
+		if (name[0] == '.')
+			continue;
+
+		filename = g_build_filename (path, name, NULL);
+		if (lstat (filename, &st) != 0)
+			continue;
+
+		if (S_ISDIR (st.st_mode)) {
+			if (!collect_dir (filename, items, cancellable, &error_local)) {
+				if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+					g_propagate_error (error, g_steal_pointer (&error_local));
+					return FALSE;
+				}
+				g_debug ("Skipping %s: %s", filename, error_local->message);
+			}
+			continue;
+		}
+
+		if (S_ISLNK (st.st_mode) && stat (filename, &st) != 0)
+			continue;
+		if (S_ISREG (st.st_mode) &&
+		    (has_suffix_nocase (name, ".ova") || has_suffix_nocase (name, ".ovf")))
+			g_ptr_array_add (items, catalog_item_new (filename, &st));
+	}
+
+	return TRUE;
+}
+
+/* loads the summary of a single package; a package that fails to load
+ * still gets an entry, holding the error */
+static GovfCatalogEntry *
+catalog_load (GovfCatalog  *self,
+              const gchar  *filename,
+              GCancellable *cancellable)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) disks = NULL;
+	g_autoptr(GovfPackage) package = NULL;
+	GovfCatalogEntry *entry;
+	gboolean ret;
+
+	entry = govf_catalog_entry_new (filename);
+	if (g_cancellable_set_error_if_cancelled (cancellable, &error)) {
+		govf_catalog_entry_set_error (entry, error);
+		return entry;
+	}
+
+	/* only the summary is kept, so there is no need for a document
+	 * tree; the package and its file are gone once this returns */
+	package = govf_package_new ();
+	govf_package_set_load_flags (package, GOVF_LOAD_FLAGS_STREAMING);
+	govf_package_set_cache_dir (package, self->cache_dir);
+
+	if (has_suffix_nocase (filename, ".ovf"))
+		ret = govf_package_load_from_file (package, filename, &error);
+	else
+		ret = govf_package_load_from_ova_file (package, filename, &error);
+	if (!ret) {
+		govf_catalog_entry_set_error (entry, error);
+		return entry;
+	}
+
+	disks = govf_package_get_disks (package);
+	govf_catalog_entry_set_name (entry, govf_package_get_name (package));
+	govf_catalog_entry_set_os_id (entry, govf_package_get_os_id (package));
+	govf_catalog_entry_set_disks (entry, disks);
+
+	return entry;
+}
+
+static void
+scan_job_func (gpointer data, gpointer user_data)
+{
+	GovfCatalogItem *item = data;
+	GovfCatalogScan *scan = user_data;
+
+	g_async_queue_push (scan->results,
+	                    catalog_load (scan->catalog, item->filename, scan->cancellable));
+}
+
+/* loads the packages on a pool of threads, each with at most one
+ * package file open, and hands the entries to @func on this thread in
+ * the order they are done */
+static gboolean
+catalog_scan (GovfCatalog      *self,
+              GPtrArray        *items,
+              GovfCatalogFunc   func,
+              gpointer          user_data,
+              GCancellable     *cancellable,
+              GError          **error)
+{
+	GovfCatalogScan scan;
+	GThreadPool *pool;
+	guint i;
+
+	g_ptr_array_sort (items, catalog_item_compare);
+
+	scan.catalog = self;
+	scan.cancellable = cancellable;
+	scan.results = g_async_queue_new_full (g_object_unref);
+
+	pool = g_thread_pool_new (scan_job_func,
+	                          &scan,
+	                          MIN (self->max_threads, MAX (items->len, 1)),
+	                          FALSE,
+	                          NULL);
+	for (i = 0; i < items->len; i++)
+		g_thread_pool_push (pool, g_ptr_array_index (items, i), NULL);
+
+	for (i = 0; i < items->len; i++) {
+		g_autoptr(GovfCatalogEntry) entry = g_async_queue_pop (scan.results);
+
+		if (!g_cancellable_is_cancelled (cancellable))
+			func (entry, user_data);
+	}
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_async_queue_unref (scan.results);
+
+	return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+/**
+ * govf_catalog_scan_dir:
+ * @self: a #GovfCatalog
+ * @path: a directory
+ * @func: (scope call): a #GovfCatalogFunc to call for every package
+ * @user_data: the data to pass to @func
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @error: a #GError or %NULL
+ *
+ * Loads every .ova and .ovf file in @path and its subdirectories, several
+ * at a time, and calls @func with a summary of each as soon as it is
+ * loaded. Packages that fail to load are passed to @func too, with the
+ * error set on their #GovfCatalogEntry.
+ *
+ * Hidden files and directories are left out, as are symlinks to
+ * directories.
+ *
+ * Returns: %TRUE if the directory could be scanned
+ */
+gboolean
+govf_catalog_scan_dir (GovfCatalog      *self,
+                       const gchar      *path,
+                       GovfCatalogFunc   func,
+                       gpointer          user_data,
+                       GCancellable     *cancellable,
+                       GError          **error)
+{
+	g_autoptr(GPtrArray) items = NULL;
+
+	g_return_val_if_fail (GOVF_IS_CATALOG (self), FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) catalog_item_free);
+	if (!collect_dir (path, items, cancellable, error))
+		return FALSE;
+
+	return catalog_scan (self, items, func, user_data, cancellable, error);
+}
+
+/**
+ * govf_catalog_scan_files:
+ * @self: a #GovfCatalog
+ * @filenames: (array zero-terminated=1): .ova and .ovf file names
+ * @func: (scope call): a #GovfCatalogFunc to call for every package
+ * @user_data: the data to pass to @func
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @error: a #GError or %NULL
+ *
+ * Loads every file in @filenames, several at a time, and calls @func
+ * with a summary of each as soon as it is loaded. See
+ * govf_catalog_scan_dir().
+ *
+ * Returns: %TRUE unless the scan was cancelled
+ */
+gboolean
+govf_catalog_scan_files (GovfCatalog         *self,
+                         const gchar * const *filenames,
+                         GovfCatalogFunc      func,
+                         gpointer             user_data,
+                         GCancellable        *cancellable,
+                         GError             **error)
+{
+	g_autoptr(GPtrArray) items = NULL;
+	guint i;
+
+	g_return_val_if_fail (GOVF_IS_CATALOG (self), FALSE);
+	g_return_val_if_fail (filenames != NULL, FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) catalog_item_free);
+	for (i = 0; filenames[i] != NULL; i++) {
+		struct stat st;
+
+		/* a file that can't be stat'ed fails to load later on, and
+		 * gets its entry then */
+		g_ptr_array_add (items,
+		                 catalog_item_new (filenames[i],
+		                                   stat (filenames[i], &st) == 0 ? &st : NULL));
+	}
+
+	return catalog_scan (self, items, func, user_data, cancellable, error);
+}
+
+/**
+ * govf_catalog_get_max_threads:
+ * @self: a #GovfCatalog
+ *
+ * Returns how many packages a scan loads at once.
+ *
+ * Returns: the number of threads
+ */
+guint
+govf_catalog_get_max_threads (GovfCatalog *self)
+{
+	g_return_val_if_fail (GOVF_IS_CATALOG (self), 0);
+
+	return self->max_threads;
+}
+
+/**
+ * govf_catalog_set_max_threads:
+ * @self: a #GovfCatalog
+ * @n_threads: the number of threads
+ *
+ * Sets how many packages a scan loads at once. Each thread has at most
+ * one package file open, so this also bounds the number of files a scan
+ * keeps open. The default is the number of processors.
+ */
+void
+govf_catalog_set_max_threads (GovfCatalog *self,
+                              guint        n_threads)
+{
+	g_return_if_fail (GOVF_IS_CATALOG (self));
+	g_return_if_fail (n_threads > 0);
+
+	self->max_threads = n_threads;
+}
+
+/**
+ * govf_catalog_get_cache_dir:
+ * @self: a #GovfCatalog
+ *
+ * Returns the directory loads of .ova files are cached in.
+ *
+ * Returns: (nullable): the cache directory, or %NULL if loads are not
+ *   cached
+ */
+const gchar *
+govf_catalog_get_cache_dir (GovfCatalog *self)
+{
+	g_return_val_if_fail (GOVF_IS_CATALOG (self), NULL);
+
+	return self->cache_dir;
+}
+
+/**
+ * govf_catalog_set_cache_dir:
+ * @self: a #GovfCatalog
+ * @cache_dir: (nullable): a directory, or %NULL to not cache loads
+ *
+ * Sets a directory to cache loads of .ova files in, so that scanning the
+ * same files again only maps in their cache entries. See
+ * govf_package_set_cache_dir().
+ */
+void
+govf_catalog_set_cache_dir (GovfCatalog *self,
+                            const gchar *cache_dir)
+{
+	g_return_if_fail (GOVF_IS_CATALOG (self));
+
+	g_free (self->cache_dir);
+	self->cache_dir = g_strdup (cache_dir);
+}
+
+/**
+ * govf_catalog_new:
+ *
+ * Creates a new #GovfCatalog.
+ *
+ * Returns: (transfer full): a #GovfCatalog
+ */
+GovfCatalog *
+govf_catalog_new (void)
+{
+	return g_object_new (GOVF_TYPE_CATALOG, NULL);
+}
+
+static void
+govf_catalog_finalize (GObject *object)
+{
+	GovfCatalog *self = GOVF_CATALOG (object);
+
+	g_free (self->cache_dir);
+
+	G_OBJECT_CLASS (govf_catalog_parent_class)->finalize (object);
+}
+
+static void
+govf_catalog_class_init (GovfCatalogClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = govf_catalog_finalize;
+}
+
+static void
+govf_catalog_init (GovfCatalog *self)
+{
+	self->max_threads = MAX (g_get_num_processors (), 1);
+}
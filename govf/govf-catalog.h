@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_CATALOG_H__
+#define __GOVF_CATALOG_H__
+
+#include "govf-catalog-entry.h"
+
+#include <gio/gio.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GOVF_TYPE_CATALOG (govf_catalog_get_type ())
+G_DECLARE_FINAL_TYPE (GovfCatalog, govf_catalog, GOVF, CATALOG, GObject)
+
+/**
+ * GovfCatalogFunc:
+ * @entry: a #GovfCatalogEntry for a package that was scanned
+ * @user_data: the data passed to the scan
+ *
+ * Called for every package found by a scan, in the thread that started
+ * the scan, as soon as the package has been loaded.
+ */
+typedef void		(*GovfCatalogFunc)			(GovfCatalogEntry	 *entry,
+								 gpointer		  user_data);
+
+GovfCatalog		 *govf_catalog_new			(void);
+guint			  govf_catalog_get_max_threads		(GovfCatalog		 *self);
+void			  govf_catalog_set_max_threads		(GovfCatalog		 *self,
+								 guint			  n_threads);
+const gchar		 *govf_catalog_get_cache_dir		(GovfCatalog		 *self);
+void			  govf_catalog_set_cache_dir		(GovfCatalog		 *self,
+								 const gchar		 *cache_dir);
+gboolean		  govf_catalog_scan_dir			(GovfCatalog		 *self,
+								 const gchar		 *path,
+								 GovfCatalogFunc	  func,
+								 gpointer		  user_data,
+								 GCancellable		 *cancellable,
+								 GError			**error);
+gboolean		  govf_catalog_scan_files		(GovfCatalog		 *self,
+								 const gchar * const	 *filenames,
+								 GovfCatalogFunc	  func,
+								 gpointer		  user_data,
+								 GCancellable		 *cancellable,
+								 GError			**error);
+
+G_END_DECLS
+
+#endif /* __GOVF_CATALOG_H__ */
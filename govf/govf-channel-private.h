@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_CHANNEL_PRIVATE_H__
+#define __GOVF_CHANNEL_PRIVATE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* a bounded queue handing buffers from one thread to another */
+typedef struct _GovfChannel GovfChannel;
+
+GovfChannel		 *govf_channel_new		(GDestroyNotify		  item_free);
+gboolean		  govf_channel_push		(GovfChannel		 *channel,
+							 gpointer		  item,
+							 gsize			  size);
+gpointer		  govf_channel_pop		(GovfChannel		 *channel);
+void			  govf_channel_release		(GovfChannel		 *channel,
+							 gsize			  size);
+void			  govf_channel_close		(GovfChannel		 *channel);
+void			  govf_channel_free		(GovfChannel		 *channel);
+
+G_END_DECLS
+
+#endif /* __GOVF_CHANNEL_PRIVATE_H__ */
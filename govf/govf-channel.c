@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "govf-channel-private.h"
+
+#define CHANNEL_MAX_QUEUED (8 * 1024 * 1024)
+
+/* a bounded queue handing buffers from one thread to another */
+struct _GovfChannel
+{
+	GAsyncQueue		 *queue;
+	GMutex			  mutex;
+	GCond			  cond;
+	gsize			  queued;
+	gboolean		  closed;
+};
+
+GovfChannel *
+govf_channel_new (GDestroyNotify item_free)
+{
+	GovfChannel *channel;
+
+	channel = g_slice_new0 (GovfChannel);
+	channel->queue = g_async_queue_new_full (item_free);
+	g_mutex_init (&channel->mutex);
+	g_cond_init (&channel->cond);
+
+	return channel;
+}
+
+/* blocks while too much data is queued; fails once the receiving end has
+ * closed the channel, leaving @item to the caller */
+gboolean
+govf_channel_push (GovfChannel *channel, gpointer item, gsize size)
+{
+	g_mutex_lock (&channel->mutex);
+	while (!channel->closed &&
+	       channel->queued > 0 &&
+	       channel->queued + size > CHANNEL_MAX_QUEUED)
+		g_cond_wait (&channel->cond, &channel->mutex);
+	if (channel->closed) {
+		g_mutex_unlock (&channel->mutex);
+		return FALSE;
+	}
+	channel->queued += size;
+	g_mutex_unlock (&channel->mutex);
+
+	g_async_queue_push (channel->queue, item);
+	return TRUE;
+}
+
+gpointer
+govf_channel_pop (GovfChannel *channel)
+{
+	return g_async_queue_pop (channel->queue);
+}
+
+/* called by the receiving end once it is done with a popped item */
+void
+govf_channel_release (GovfChannel *channel, gsize size)
+{
+	g_mutex_lock (&channel->mutex);
+	channel->queued -= size;
+	g_cond_signal (&channel->cond);
+	g_mutex_unlock (&channel->mutex);
+}
+
+void
+govf_channel_close (GovfChannel *channel)
+{
+	g_mutex_lock (&channel->mutex);
+	channel->closed = TRUE;
+	g_cond_broadcast (&channel->cond);
+	g_mutex_unlock (&channel->mutex);
+}
+
+void
+govf_channel_free (GovfChannel *channel)
+{
+	g_async_queue_unref (channel->queue);
+	g_mutex_clear (&channel->mutex);
+	g_cond_clear (&channel->cond);
+	g_slice_free (GovfChannel, channel);
+}
@@ -27,7 +27,7 @@ struct _GovfDisk
 	gchar			 *capacity;
 	gchar			 *disk_id;
 	gchar			 *file_ref;
-	gchar			 *format;
+	const gchar		 *format;
 };
 
 G_DEFINE_TYPE (GovfDisk, govf_disk, G_TYPE_OBJECT)
@@ -144,8 +144,8 @@ void
 govf_disk_set_format (GovfDisk    *self,
                       const gchar *format)
 {
-	g_free (self->format);
-	self->format = g_strdup (format);
+	/* only a handful of formats exist, shared by every disk */
+	self->format = g_intern_string (format);
 }
 
 /**
@@ -169,7 +169,6 @@ govf_disk_finalize (GObject *object)
 	g_free (self->capacity);
 	g_free (self->disk_id);
 	g_free (self->file_ref);
-	g_free (self->format);
 
 	G_OBJECT_CLASS (govf_disk_parent_class)->finalize (object);
 }
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "govf-extract-options.h"
+
+struct _GovfExtractOptions
+{
+	GObject			  parent_instance;
+
+	gsize			  block_size;
+	GovfIoFlags		  flags;
+	guint			  convert_threads;
+};
+
+G_DEFINE_TYPE (GovfExtractOptions, govf_extract_options, G_TYPE_OBJECT)
+
+/**
+ * govf_extract_options_get_block_size:
+ * @self: a #GovfExtractOptions
+ *
+ * Returns the size of the reads and writes done when extracting disks.
+ *
+ * Returns: the block size in bytes, or 0 for the default
+ */
+gsize
+govf_extract_options_get_block_size (GovfExtractOptions *self)
+{
+	return self->block_size;
+}
+
+/**
+ * govf_extract_options_set_block_size:
+ * @self: a #GovfExtractOptions
+ * @block_size: the block size in bytes, or 0 for the default
+ *
+ * Sets the size of the reads and writes done when extracting disks.
+ */
+void
+govf_extract_options_set_block_size (GovfExtractOptions *self,
+                                     gsize               block_size)
+{
+	self->block_size = block_size;
+}
+
+/**
+ * govf_extract_options_get_flags:
+ * @self: a #GovfExtractOptions
+ *
+ * Returns the flags controlling the I/O done when extracting disks.
+ *
+ * Returns: the #GovfIoFlags
+ */
+GovfIoFlags
+govf_extract_options_get_flags (GovfExtractOptions *self)
+{
+	return self->flags;
+}
+
+/**
+ * govf_extract_options_set_flags:
+ * @self: a #GovfExtractOptions
+ * @flags: #GovfIoFlags for extracting disks
+ *
+ * Sets the flags controlling the I/O done when extracting disks.
+ */
+void
+govf_extract_options_set_flags (GovfExtractOptions *self,
+                                GovfIoFlags         flags)
+{
+	self->flags = flags;
+}
+
+/**
+ * govf_extract_options_get_convert_threads:
+ * @self: a #GovfExtractOptions
+ *
+ * Returns the number of threads inflating grains when converting
+ * streamOptimized VMDK disks with %GOVF_EXTRACT_FLAGS_CONVERT_RAW.
+ *
+ * Returns: the number of threads, or 0 for one per processor
+ */
+guint
+govf_extract_options_get_convert_threads (GovfExtractOptions *self)
+{
+	return self->convert_threads;
+}
+
+/**
+ * govf_extract_options_set_convert_threads:
+ * @self: a #GovfExtractOptions
+ * @n_threads: the number of threads, or 0 for one per processor
+ *
+ * Sets the number of threads inflating grains when converting
+ * streamOptimized VMDK disks with %GOVF_EXTRACT_FLAGS_CONVERT_RAW.
+ */
+void
+govf_extract_options_set_convert_threads (GovfExtractOptions *self,
+                                          guint               n_threads)
+{
+	self->convert_threads = n_threads;
+}
+
+/**
+ * govf_extract_options_new:
+ *
+ * Creates a new #GovfExtractOptions with the default block size and no
+ * flags set. See govf_package_set_extract_options().
+ *
+ * Returns: (transfer full): a #GovfExtractOptions
+ */
+GovfExtractOptions *
+govf_extract_options_new (void)
+{
+	return g_object_new (GOVF_TYPE_EXTRACT_OPTIONS, NULL);
+}
+
+static void
+govf_extract_options_class_init (GovfExtractOptionsClass *klass)
+{
+}
+
+static void
+govf_extract_options_init (GovfExtractOptions *self)
+{
+}
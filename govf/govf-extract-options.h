@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_EXTRACT_OPTIONS_H__
+#define __GOVF_EXTRACT_OPTIONS_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GOVF_TYPE_EXTRACT_OPTIONS (govf_extract_options_get_type ())
+G_DECLARE_FINAL_TYPE (GovfExtractOptions, govf_extract_options, GOVF, EXTRACT_OPTIONS, GObject)
+
+/**
+ * GovfIoFlags:
+ * @GOVF_IO_FLAGS_NONE: No flags set
+ * @GOVF_IO_FLAGS_DROP_CACHE: Read the archive with sequential access hints,
+ *   and drop both the archive and the extracted disk from the page cache
+ *   once the disk is extracted; the disk is flushed to storage for that
+ * @GOVF_IO_FLAGS_DIRECT: Write the extracted disk with O_DIRECT, bypassing
+ *   the page cache, where the filesystem supports it
+ * @GOVF_IO_FLAGS_PREALLOCATE: Allocate space for the whole disk before
+ *   writing it, unless it is extracted sparsely
+ * @GOVF_IO_FLAGS_IO_URING: Copy disks stored uncompressed in an .ova file
+ *   with io_uring, keeping several reads and writes in flight, where the
+ *   library is built with liburing and the kernel allows it
+ *
+ * Flags controlling the I/O done when extracting disks.
+ */
+typedef enum
+{
+	GOVF_IO_FLAGS_NONE		= 0,
+	GOVF_IO_FLAGS_DROP_CACHE	= 1 << 0,
+	GOVF_IO_FLAGS_DIRECT		= 1 << 1,
+	GOVF_IO_FLAGS_PREALLOCATE	= 1 << 2,
+	GOVF_IO_FLAGS_IO_URING		= 1 << 3
+} GovfIoFlags;
+
+GovfExtractOptions	 *govf_extract_options_new		(void);
+gsize			  govf_extract_options_get_block_size	(GovfExtractOptions	 *self);
+void			  govf_extract_options_set_block_size	(GovfExtractOptions	 *self,
+								 gsize			  block_size);
+GovfIoFlags		  govf_extract_options_get_flags	(GovfExtractOptions	 *self);
+void			  govf_extract_options_set_flags	(GovfExtractOptions	 *self,
+								 GovfIoFlags		  flags);
+guint			  govf_extract_options_get_convert_threads	(GovfExtractOptions	 *self);
+void			  govf_extract_options_set_convert_threads	(GovfExtractOptions	 *self,
+								 guint			  n_threads);
+
+G_END_DECLS
+
+#endif /* __GOVF_EXTRACT_OPTIONS_H__ */
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "govf-extraction.h"
+
+struct _GovfExtraction
+{
+	GObject			  parent_instance;
+
+	GovfDisk		 *disk;
+	gchar			 *save_path;
+	GovfExtractFlags	  flags;
+	guint64			  size;
+	guint64			  bytes_written;
+	GError			 *error;
+};
+
+G_DEFINE_TYPE (GovfExtraction, govf_extraction, G_TYPE_OBJECT)
+
+/**
+ * govf_extraction_get_disk:
+ * @self: a #GovfExtraction
+ *
+ * Returns the disk to extract.
+ *
+ * Returns: (transfer none): the disk
+ */
+GovfDisk *
+govf_extraction_get_disk (GovfExtraction *self)
+{
+	return self->disk;
+}
+
+/**
+ * govf_extraction_get_save_path:
+ * @self: a #GovfExtraction
+ *
+ * Returns the path the disk is extracted to.
+ *
+ * Returns: (transfer none): the save path
+ */
+const gchar *
+govf_extraction_get_save_path (GovfExtraction *self)
+{
+	return self->save_path;
+}
+
+/**
+ * govf_extraction_get_flags:
+ * @self: a #GovfExtraction
+ *
+ * Returns the flags the disk is extracted with.
+ *
+ * Returns: the #GovfExtractFlags
+ */
+GovfExtractFlags
+govf_extraction_get_flags (GovfExtraction *self)
+{
+	return self->flags;
+}
+
+/**
+ * govf_extraction_set_flags:
+ * @self: a #GovfExtraction
+ * @flags: #GovfExtractFlags for the extraction
+ *
+ * Sets the flags the disk is extracted with.
+ */
+void
+govf_extraction_set_flags (GovfExtraction   *self,
+                           GovfExtractFlags  flags)
+{
+	self->flags = flags;
+}
+
+/**
+ * govf_extraction_get_size:
+ * @self: a #GovfExtraction
+ *
+ * Returns the logical size of the extracted disk image, including any
+ * holes.
+ *
+ * Returns: the size in bytes
+ */
+guint64
+govf_extraction_get_size (GovfExtraction *self)
+{
+	return self->size;
+}
+
+/**
+ * govf_extraction_set_size:
+ * @self: a #GovfExtraction
+ * @size: the size in bytes
+ *
+ * Sets the logical size of the extracted disk image.
+ */
+void
+govf_extraction_set_size (GovfExtraction *self,
+                          guint64         size)
+{
+	self->size = size;
+}
+
+/**
+ * govf_extraction_get_bytes_written:
+ * @self: a #GovfExtraction
+ *
+ * Returns the number of bytes that were actually written out when
+ * extracting the disk image. With %GOVF_EXTRACT_FLAGS_SPARSE this is less
+ * than the size of the image if any holes were left.
+ *
+ * Returns: the number of bytes written
+ */
+guint64
+govf_extraction_get_bytes_written (GovfExtraction *self)
+{
+	return self->bytes_written;
+}
+
+/**
+ * govf_extraction_set_bytes_written:
+ * @self: a #GovfExtraction
+ * @bytes_written: the number of bytes written
+ *
+ * Sets the number of bytes that were written out when extracting the disk
+ * image.
+ */
+void
+govf_extraction_set_bytes_written (GovfExtraction *self,
+                                   guint64         bytes_written)
+{
+	self->bytes_written = bytes_written;
+}
+
+/**
+ * govf_extraction_get_error:
+ * @self: a #GovfExtraction
+ *
+ * Returns the error the extraction failed with.
+ *
+ * Returns: (transfer none) (nullable): a #GError, or %NULL if the disk
+ * was extracted successfully
+ */
+const GError *
+govf_extraction_get_error (GovfExtraction *self)
+{
+	return self->error;
+}
+
+/**
+ * govf_extraction_set_error:
+ * @self: a #GovfExtraction
+ * @error: (nullable): a #GError, or %NULL
+ *
+ * Sets the error the extraction failed with.
+ */
+void
+govf_extraction_set_error (GovfExtraction *self,
+                           const GError   *error)
+{
+	g_clear_error (&self->error);
+	if (error != NULL)
+		self->error = g_error_copy (error);
+}
+
+/**
+ * govf_extraction_new:
+ * @disk: a #GovfDisk to extract
+ * @save_path: full path to extract to
+ *
+ * Creates a new #GovfExtraction, pairing a disk with the path it should be
+ * extracted to.
+ *
+ * Returns: (transfer full): a #GovfExtraction
+ */
+GovfExtraction *
+govf_extraction_new (GovfDisk    *disk,
+                     const gchar *save_path)
+{
+	GovfExtraction *self;
+
+	g_return_val_if_fail (GOVF_IS_DISK (disk), NULL);
+	g_return_val_if_fail (save_path != NULL, NULL);
+
+	self = g_object_new (GOVF_TYPE_EXTRACTION, NULL);
+	self->disk = g_object_ref (disk);
+	self->save_path = g_strdup (save_path);
+
+	return self;
+}
+
+static void
+govf_extraction_finalize (GObject *object)
+{
+	GovfExtraction *self = GOVF_EXTRACTION (object);
+
+	g_object_unref (self->disk);
+	g_free (self->save_path);
+	g_clear_error (&self->error);
+
+	G_OBJECT_CLASS (govf_extraction_parent_class)->finalize (object);
+}
+
+static void
+govf_extraction_class_init (GovfExtractionClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = govf_extraction_finalize;
+}
+
+static void
+govf_extraction_init (GovfExtraction *self)
+{
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_EXTRACTION_H__
+#define __GOVF_EXTRACTION_H__
+
+#include "govf-disk.h"
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GOVF_TYPE_EXTRACTION (govf_extraction_get_type ())
+G_DECLARE_FINAL_TYPE (GovfExtraction, govf_extraction, GOVF, EXTRACTION, GObject)
+
+/**
+ * GovfExtractFlags:
+ * @GOVF_EXTRACT_FLAGS_NONE: No flags set
+ * @GOVF_EXTRACT_FLAGS_SPARSE: Leave holes in the extracted file instead of
+ *   writing out blocks that are all zeros
+ * @GOVF_EXTRACT_FLAGS_CONVERT_RAW: Convert streamOptimized VMDK disks to
+ *   raw disk images; other disks are extracted unchanged
+ * @GOVF_EXTRACT_FLAGS_VERIFY: Check the disk against its digest in the
+ *   manifest of the .ova file while extracting it
+ *
+ * Flags controlling how a disk is extracted.
+ */
+typedef enum
+{
+	GOVF_EXTRACT_FLAGS_NONE		= 0,
+	GOVF_EXTRACT_FLAGS_SPARSE	= 1 << 0,
+	GOVF_EXTRACT_FLAGS_CONVERT_RAW	= 1 << 1,
+	GOVF_EXTRACT_FLAGS_VERIFY	= 1 << 2
+} GovfExtractFlags;
+
+GovfExtraction		 *govf_extraction_new			(GovfDisk	 *disk,
+								 const gchar	 *save_path);
+GovfDisk		 *govf_extraction_get_disk		(GovfExtraction	 *self);
+const gchar		 *govf_extraction_get_save_path		(GovfExtraction	 *self);
+GovfExtractFlags	  govf_extraction_get_flags		(GovfExtraction	 *self);
+void			  govf_extraction_set_flags		(GovfExtraction	 *self,
+								 GovfExtractFlags flags);
+guint64			  govf_extraction_get_size		(GovfExtraction	 *self);
+void			  govf_extraction_set_size		(GovfExtraction	 *self,
+								 guint64	  size);
+guint64			  govf_extraction_get_bytes_written	(GovfExtraction	 *self);
+void			  govf_extraction_set_bytes_written	(GovfExtraction	 *self,
+								 guint64	  bytes_written);
+const GError		 *govf_extraction_get_error		(GovfExtraction	 *self);
+void			  govf_extraction_set_error		(GovfExtraction	 *self,
+								 const GError	 *error);
+
+G_END_DECLS
+
+#endif /* __GOVF_EXTRACTION_H__ */
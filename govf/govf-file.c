@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "govf-file.h"
+
+struct _GovfFile
+{
+	GObject			  parent_instance;
+
+	gchar			 *id;
+	gchar			 *href;
+	gchar			 *size;
+	const gchar		 *compression;
+	gchar			 *chunk_size;
+};
+
+G_DEFINE_TYPE (GovfFile, govf_file, G_TYPE_OBJECT)
+
+/**
+ * govf_file_get_id:
+ * @self: a #GovfFile
+ *
+ * Returns the file id.
+ *
+ * Returns: (transfer none): the file id
+ */
+const gchar *
+govf_file_get_id (GovfFile *self)
+{
+	return self->id;
+}
+
+/**
+ * govf_file_set_id:
+ * @self: a #GovfFile
+ * @id: id for the file
+ *
+ * Sets a new id for the file.
+ */
+void
+govf_file_set_id (GovfFile    *self,
+                  const gchar *id)
+{
+	g_free (self->id);
+	self->id = g_strdup (id);
+}
+
+/**
+ * govf_file_get_href:
+ * @self: a #GovfFile
+ *
+ * Returns the file's location, relative to the descriptor.
+ *
+ * Returns: (transfer none): the href
+ */
+const gchar *
+govf_file_get_href (GovfFile *self)
+{
+	return self->href;
+}
+
+/**
+ * govf_file_set_href:
+ * @self: a #GovfFile
+ * @href: location of the file
+ *
+ * Sets a new location for the file.
+ */
+void
+govf_file_set_href (GovfFile    *self,
+                    const gchar *href)
+{
+	g_free (self->href);
+	self->href = g_strdup (href);
+}
+
+/**
+ * govf_file_get_size:
+ * @self: a #GovfFile
+ *
+ * Returns the file's size in bytes.
+ *
+ * Returns: (transfer none): the size
+ */
+const gchar *
+govf_file_get_size (GovfFile *self)
+{
+	return self->size;
+}
+
+/**
+ * govf_file_set_size:
+ * @self: a #GovfFile
+ * @size: size for the file
+ *
+ * Sets a new size for the file.
+ */
+void
+govf_file_set_size (GovfFile    *self,
+                    const gchar *size)
+{
+	g_free (self->size);
+	self->size = g_strdup (size);
+}
+
+/**
+ * govf_file_get_compression:
+ * @self: a #GovfFile
+ *
+ * Returns the compression applied to the file, such as "gzip".
+ *
+ * Returns: (transfer none): the compression
+ */
+const gchar *
+govf_file_get_compression (GovfFile *self)
+{
+	return self->compression;
+}
+
+/**
+ * govf_file_set_compression:
+ * @self: a #GovfFile
+ * @compression: compression for the file
+ *
+ * Sets a new compression for the file.
+ */
+void
+govf_file_set_compression (GovfFile    *self,
+                           const gchar *compression)
+{
+	/* only a handful of compression methods exist, shared by every file */
+	self->compression = g_intern_string (compression);
+}
+
+/**
+ * govf_file_get_chunk_size:
+ * @self: a #GovfFile
+ *
+ * Returns the size of each chunk if the file is split into chunks.
+ *
+ * Returns: (transfer none): the chunk size
+ */
+const gchar *
+govf_file_get_chunk_size (GovfFile *self)
+{
+	return self->chunk_size;
+}
+
+/**
+ * govf_file_set_chunk_size:
+ * @self: a #GovfFile
+ * @chunk_size: chunk size for the file
+ *
+ * Sets a new chunk size for the file.
+ */
+void
+govf_file_set_chunk_size (GovfFile    *self,
+                          const gchar *chunk_size)
+{
+	g_free (self->chunk_size);
+	self->chunk_size = g_strdup (chunk_size);
+}
+
+/**
+ * govf_file_new:
+ *
+ * Creates a new #GovfFile.
+ *
+ * Returns: (transfer full): a #GovfFile
+ */
+GovfFile *
+govf_file_new (void)
+{
+	return g_object_new (GOVF_TYPE_FILE, NULL);
+}
+
+static void
+govf_file_finalize (GObject *object)
+{
+	GovfFile *self = GOVF_FILE (object);
+
+	g_free (self->id);
+	g_free (self->href);
+	g_free (self->size);
+	g_free (self->chunk_size);
+
+	G_OBJECT_CLASS (govf_file_parent_class)->finalize (object);
+}
+
+static void
+govf_file_class_init (GovfFileClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = govf_file_finalize;
+}
+
+static void
+govf_file_init (GovfFile *self)
+{
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_FILE_H__
+#define __GOVF_FILE_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define GOVF_TYPE_FILE (govf_file_get_type ())
+G_DECLARE_FINAL_TYPE (GovfFile, govf_file, GOVF, FILE, GObject)
+
+GovfFile		 *govf_file_new				(void);
+const gchar		 *govf_file_get_id			(GovfFile	 *self);
+void			  govf_file_set_id			(GovfFile	 *self,
+								 const gchar	 *id);
+const gchar		 *govf_file_get_href			(GovfFile	 *self);
+void			  govf_file_set_href			(GovfFile	 *self,
+								 const gchar	 *href);
+const gchar		 *govf_file_get_size			(GovfFile	 *self);
+void			  govf_file_set_size			(GovfFile	 *self,
+								 const gchar	 *size);
+const gchar		 *govf_file_get_compression		(GovfFile	 *self);
+void			  govf_file_set_compression		(GovfFile	 *self,
+								 const gchar	 *compression);
+const gchar		 *govf_file_get_chunk_size		(GovfFile	 *self);
+void			  govf_file_set_chunk_size		(GovfFile	 *self,
+								 const gchar	 *chunk_size);
+
+G_END_DECLS
+
+#endif /* __GOVF_FILE_H__ */
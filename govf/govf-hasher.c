@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "govf-hasher-private.h"
+
+#define HASHER_MAX_QUEUED (16 * 1024 * 1024)
+#define HASHER_ZERO_BUFFER_SIZE (64 * 1024)
+
+/* digests data on a thread of its own, so that hashing overlaps with
+ * reading and writing; the data is copied into the queue */
+struct _GovfHasher
+{
+	GChecksum		 *checksum;
+	GAsyncQueue		 *queue;
+	GThread			 *thread;
+	GMutex			  mutex;
+	GCond			  cond;
+	gsize			  queued;
+};
+
+static gpointer
+hasher_thread_func (gpointer data)
+{
+	GovfHasher *hasher = data;
+
+	for (;;) {
+		g_autoptr(GBytes) bytes = g_async_queue_pop (hasher->queue);
+		const guchar *buf;
+		gsize len;
+
+		/* an empty buffer marks the end of the data */
+		buf = g_bytes_get_data (bytes, &len);
+		if (len == 0)
+			break;
+		g_checksum_update (hasher->checksum, buf, len);
+
+		g_mutex_lock (&hasher->mutex);
+		hasher->queued -= len;
+		g_cond_signal (&hasher->cond);
+		g_mutex_unlock (&hasher->mutex);
+	}
+
+	return NULL;
+}
+
+GovfHasher *
+govf_hasher_new (GChecksumType type)
+{
+	GovfHasher *hasher;
+
+	hasher = g_slice_new0 (GovfHasher);
+	hasher->checksum = g_checksum_new (type);
+	hasher->queue = g_async_queue_new_full ((GDestroyNotify) g_bytes_unref);
+	g_mutex_init (&hasher->mutex);
+	g_cond_init (&hasher->cond);
+	hasher->thread = g_thread_new ("govf-hasher", hasher_thread_func, hasher);
+
+	return hasher;
+}
+
+/* blocks while too much data is waiting to be hashed */
+void
+govf_hasher_update (GovfHasher *hasher, const gchar *buf, gsize len)
+{
+	if (len == 0)
+		return;
+
+	g_mutex_lock (&hasher->mutex);
+	while (hasher->queued > 0 && hasher->queued + len > HASHER_MAX_QUEUED)
+		g_cond_wait (&hasher->cond, &hasher->mutex);
+	hasher->queued += len;
+	g_mutex_unlock (&hasher->mutex);
+
+	g_async_queue_push (hasher->queue, g_bytes_new (buf, len));
+}
+
+/* holes in sparse members read back as zeros */
+void
+govf_hasher_update_zeros (GovfHasher *hasher, gint64 len)
+{
+	static const gchar zeros[HASHER_ZERO_BUFFER_SIZE] = { 0, };
+
+	while (len > 0) {
+		gsize n = MIN (len, HASHER_ZERO_BUFFER_SIZE);
+		govf_hasher_update (hasher, zeros, n);
+		len -= n;
+	}
+}
+
+static void
+hasher_stop (GovfHasher *hasher)
+{
+	if (hasher->thread == NULL)
+		return;
+
+	g_async_queue_push (hasher->queue, g_bytes_new (NULL, 0));
+	g_thread_join (hasher->thread);
+	hasher->thread = NULL;
+}
+
+const gchar *
+govf_hasher_get_digest (GovfHasher *hasher)
+{
+	hasher_stop (hasher);
+	return g_checksum_get_string (hasher->checksum);
+}
+
+void
+govf_hasher_free (GovfHasher *hasher)
+{
+	hasher_stop (hasher);
+	g_checksum_free (hasher->checksum);
+	g_async_queue_unref (hasher->queue);
+	g_mutex_clear (&hasher->mutex);
+	g_cond_clear (&hasher->cond);
+	g_slice_free (GovfHasher, hasher);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_MEMBER_STREAM_PRIVATE_H__
+#define __GOVF_MEMBER_STREAM_PRIVATE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define GOVF_TYPE_MEMBER_STREAM (govf_member_stream_get_type ())
+G_DECLARE_FINAL_TYPE (GovfMemberStream, govf_member_stream, GOVF, MEMBER_STREAM, GInputStream)
+
+GInputStream		 *govf_member_stream_new	(gint			  fd,
+							 goffset		  offset,
+							 goffset		  size);
+
+G_END_DECLS
+
+#endif /* __GOVF_MEMBER_STREAM_PRIVATE_H__ */
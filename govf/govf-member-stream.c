@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "govf-member-stream-private.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+/* reads a byte range of a file, such as the data of an archive member,
+ * with pread() at an offset of its own, so that several streams can
+ * share a file without a shared file position */
+struct _GovfMemberStream
+{
+	GInputStream		  parent_instance;
+
+	gint			  fd;
+	goffset			  offset;
+	goffset			  size;
+	goffset			  position;
+};
+
+static void govf_member_stream_seekable_iface_init (GSeekableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GovfMemberStream, govf_member_stream, G_TYPE_INPUT_STREAM,
+                         G_IMPLEMENT_INTERFACE (G_TYPE_SEEKABLE,
+                                                govf_member_stream_seekable_iface_init))
+
+static gssize
+govf_member_stream_read (GInputStream  *stream,
+                         void          *buffer,
+                         gsize          count,
+                         GCancellable  *cancellable,
+                         GError       **error)
+{
+	GovfMemberStream *self = GOVF_MEMBER_STREAM (stream);
+	gssize n;
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return -1;
+
+	count = MIN ((goffset) count, self->size - self->position);
+	if (count == 0)
+		return 0;
+
+	do
+		n = pread (self->fd, buffer, count, self->offset + self->position);
+	while (n < 0 && errno == EINTR);
+	if (n < 0) {
+		int errsv = errno;
+
+		g_set_error (error,
+		             G_IO_ERROR,
+		             g_io_error_from_errno (errsv),
+		             "Cannot read: %s",
+		             g_strerror (errsv));
+		return -1;
+	}
+
+	self->position += n;
+	return n;
+}
+
+static gssize
+govf_member_stream_skip (GInputStream  *stream,
+                         gsize          count,
+                         GCancellable  *cancellable,
+                         GError       **error)
+{
+	GovfMemberStream *self = GOVF_MEMBER_STREAM (stream);
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error))
+		return -1;
+
+	count = MIN ((goffset) count, self->size - self->position);
+	self->position += count;
+	return count;
+}
+
+static gboolean
+govf_member_stream_close (GInputStream  *stream,
+                          GCancellable  *cancellable,
+                          GError       **error)
+{
+	GovfMemberStream *self = GOVF_MEMBER_STREAM (stream);
+
+	if (self->fd != -1) {
+		close (self->fd);
+		self->fd = -1;
+	}
+
+	return TRUE;
+}
+
+static goffset
+govf_member_stream_tell (GSeekable *seekable)
+{
+	return GOVF_MEMBER_STREAM (seekable)->position;
+}
+
+static gboolean
+govf_member_stream_can_seek (GSeekable *seekable)
+{
+	return TRUE;
+}
+
+static gboolean
+govf_member_stream_seek (GSeekable     *seekable,
+                         goffset        offset,
+                         GSeekType      type,
+                         GCancellable  *cancellable,
+                         GError       **error)
+{
+	GovfMemberStream *self = GOVF_MEMBER_STREAM (seekable);
+	goffset position;
+
+	switch (type) {
+	case G_SEEK_CUR:
+		position = self->position + offset;
+		break;
+	case G_SEEK_SET:
+		position = offset;
+		break;
+	case G_SEEK_END:
+		position = self->size + offset;
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+
+	/* reads past the end of the member would run into the next one */
+	if (position < 0 || position > self->size) {
+		g_set_error (error,
+		             G_IO_ERROR,
+		             G_IO_ERROR_INVALID_ARGUMENT,
+		             "Cannot seek to %" G_GOFFSET_FORMAT " in a stream of %" G_GOFFSET_FORMAT " bytes",
+		             position,
+		             self->size);
+		return FALSE;
+	}
+
+	self->position = position;
+	return TRUE;
+}
+
+static gboolean
+govf_member_stream_can_truncate (GSeekable *seekable)
+{
+	return FALSE;
+}
+
+static gboolean
+govf_member_stream_truncate (GSeekable     *seekable,
+                             goffset        offset,
+                             GCancellable  *cancellable,
+                             GError       **error)
+{
+	g_set_error (error,
+	             G_IO_ERROR,
+	             G_IO_ERROR_NOT_SUPPORTED,
+	             "Cannot truncate a read-only stream");
+	return FALSE;
+}
+
+/**
+ * govf_member_stream_new:
+ * @fd: a file descriptor, which the stream takes over
+ * @offset: where the range starts in the file
+ * @size: the size of the range
+ *
+ * Creates a seekable stream over @size bytes of @fd starting at @offset.
+ *
+ * Returns: (transfer full): a #GInputStream
+ */
+GInputStream *
+govf_member_stream_new (gint    fd,
+                        goffset offset,
+                        goffset size)
+{
+	GovfMemberStream *self;
+
+	g_return_val_if_fail (fd >= 0, NULL);
+	g_return_val_if_fail (offset >= 0 && size >= 0, NULL);
+
+	self = g_object_new (GOVF_TYPE_MEMBER_STREAM, NULL);
+	self->fd = fd;
+	self->offset = offset;
+	self->size = size;
+
+	return G_INPUT_STREAM (self);
+}
+
+static void
+govf_member_stream_finalize (GObject *object)
+{
+	GovfMemberStream *self = GOVF_MEMBER_STREAM (object);
+
+	if (self->fd != -1)
+		close (self->fd);
+
+	G_OBJECT_CLASS (govf_member_stream_parent_class)->finalize (object);
+}
+
+static void
+govf_member_stream_seekable_iface_init (GSeekableIface *iface)
+{
+	iface->tell = govf_member_stream_tell;
+	iface->can_seek = govf_member_stream_can_seek;
+	iface->seek = govf_member_stream_seek;
+	iface->can_truncate = govf_member_stream_can_truncate;
+	iface->truncate_fn = govf_member_stream_truncate;
+}
+
+static void
+govf_member_stream_class_init (GovfMemberStreamClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	GInputStreamClass *stream_class = G_INPUT_STREAM_CLASS (klass);
+
+	object_class->finalize = govf_member_stream_finalize;
+
+	stream_class->read_fn = govf_member_stream_read;
+	stream_class->skip = govf_member_stream_skip;
+	stream_class->close_fn = govf_member_stream_close;
+}
+
+static void
+govf_member_stream_init (GovfMemberStream *self)
+{
+	self->fd = -1;
+}
@@ -18,24 +18,161 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include "config.h"
+
 #include "govf-package.h"
+#include "govf-cache-private.h"
+#include "govf-channel-private.h"
+#include "govf-hasher-private.h"
+#include "govf-member-stream-private.h"
+#include "govf-trace-private.h"
+#include "govf-uring-private.h"
+#include "govf-vmdk-private.h"
 
 #include <archive.h>
 #include <archive_entry.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <libxml/parser.h>
+#include <libxml/xmlsave.h>
 #include <libxml/xpath.h>
 #include <libxml/xpathInternals.h>
+#include <libxml/xmlreader.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+
+#define COPY_BUFFER_SIZE (1024 * 1024)
+#define COPY_BUFFER_ALIGNMENT 4096
+/* copy_file_range() and sendfile() cannot be interrupted once started, so
+ * this bounds how long cancelling waits and how far apart progress reports
+ * are: a 1 GiB chunk takes seconds on a slow disk, 64 MiB well under one,
+ * while still being large enough that the per-call overhead is negligible */
+#define COPY_KERNEL_CHUNK_SIZE (64 * 1024 * 1024)
+#define DESCRIPTOR_READ_CHUNK_SIZE (64 * 1024)
+#define DESCRIPTOR_MAX_SIZE (16 * 1024 * 1024)
+#define WORKER_POOL_MAX_THREADS 4
+#define EXTRACT_THREADS_DEFAULT 4
+#define PROGRESS_INTERVAL_USEC (100 * 1000)
+#define STREAM_READ_BUFFER_SIZE (64 * 1024)
+#define INDEX_READ_SIZE (4 * 1024)
+#define SPARSE_BLOCK_SIZE 4096
+
+#define GOVF_ROUND_UP(x, align) (((x) + (align) - 1) / (align) * (align))
+
+typedef struct
+{
+	gchar			 *name;
+	gint64			  header_offset;
+	gint64			  data_offset;
+	gint64			  size;
+	guint			  filetype;
+	gboolean		  sparse;
+} GovfOvaMember;
+
+typedef struct
+{
+	GChecksumType		  type;
+	gchar			 *digest;
+} GovfManifestEntry;
+
+/* state shared by the copy loops of a single extraction */
+typedef struct
+{
+	GCancellable		 *cancellable;
+	GFileProgressCallback	  progress_callback;
+	gpointer		  progress_data;
+	goffset			  current;
+	goffset			  total;
+	gboolean		  sparse;
+	gboolean		  convert_raw;
+	guint			  convert_threads;
+	gboolean		  verify;
+	GovfHasher		 *hasher;
+	const gchar		 *digest;
+	goffset			  bytes_read;
+	goffset			  bytes_written;
+	gsize			  block_size;
+	GovfIoFlags		  io_flags;
+	gchar			 *direct_buf;
+	gsize			  direct_len;
+	gboolean		  created;
+} GovfCopyContext;
+
+/* sequential reader over the data of a single member */
+typedef struct
+{
+	GovfCopyContext		 *ctx;
+	struct archive		 *a;
+	GInputStream		 *stream;
+	gint			  fd;
+	gint64			  offset;
+	gint64			  remaining;
+} GovfMemberReader;
+
+/* client data for reading an archive from a GInputStream */
+typedef struct
+{
+	GovfPackage		 *package;
+	GInputStream		 *stream;
+	GCancellable		 *cancellable;
+	gchar			 *buf;
+	gsize			  buf_size;
+	gsize			  read_size;
+	guint64			 *bytes_read;
+	gulong			  cancelled_id;
+	GovfChannel		 *readahead;
+	GThread			 *readahead_thread;
+	GCancellable		 *readahead_cancellable;
+	GBytes			 *readahead_bytes;
+	GError			 *readahead_error;
+	gboolean		  readahead_eof;
+} GovfStreamReader;
 
 struct _GovfPackage
 {
 	GObject			  parent_instance;
 
 	gchar			 *ova_filename;
+	GovfCacheKey		  ova_key;
+	gboolean		  ova_key_valid;
+	GInputStream		 *ova_stream;
+	gchar			 *ova_stream_name;
+	gboolean		  ova_stream_consumed;
+	gint			  ova_stream_busy;
+	struct archive		 *ova_stream_archive;
+	GovfStreamReader	 *ova_stream_reader;
+	GPtrArray		 *ova_members;
+	gboolean		  ova_uncompressed_tar;
+	gboolean		  ova_compressed;
+	gchar			 *ova_descriptor_name;
+	GBytes			 *ova_descriptor;
+	GHashTable		 *manifest;
+	GovfLoadFlags		  load_flags;
+	guint64			  bytes_read;
+	GovfExtractOptions	 *extract_options;
+	guint			  extract_threads;
+	gchar			 *cache_dir;
+	GMutex			  stats_mutex;
+	guint64			  stats[GOVF_PACKAGE_STAT_LAST];
+	GBytes			 *descriptor;
+	gchar			 *name;
+	gchar			 *description;
+	const gchar		 *os_id;
+	GPtrArray		 *files;
+	GHashTable		 *files_by_id;
 	GPtrArray		 *disks;
+	GHashTable		 *disks_by_id;
 	xmlDoc			 *doc;
 	xmlXPathContext		 *ctx;
 };
@@ -53,6 +190,32 @@ G_DEFINE_QUARK (govf-package-error-quark, govf_package_error)
 #define OVF_PATH_OPERATINGSYSTEM OVF_PATH_VIRTUALSYSTEM "/ovf:OperatingSystemSection"
 #define OVF_PATH_VIRTUALHARDWARE OVF_PATH_VIRTUALSYSTEM "/ovf:VirtualHardwareSection"
 
+typedef enum
+{
+	OVF_XPATH_VIRTUALSYSTEM,
+	OVF_XPATH_OPERATINGSYSTEM,
+	OVF_XPATH_VIRTUALHARDWARE,
+	OVF_XPATH_NAME,
+	OVF_XPATH_SYSTEM_ID,
+	OVF_XPATH_ANNOTATION,
+	OVF_XPATH_OS_ID,
+	OVF_XPATH_FILES,
+	OVF_XPATH_DISKS,
+	OVF_XPATH_LAST
+} OvfXPath;
+
+static const gchar *ovf_xpath_exprs[OVF_XPATH_LAST] = {
+	OVF_PATH_VIRTUALSYSTEM,
+	OVF_PATH_OPERATINGSYSTEM,
+	OVF_PATH_VIRTUALHARDWARE,
+	OVF_PATH_VIRTUALSYSTEM "/ovf:Name",
+	OVF_PATH_VIRTUALSYSTEM "/@ovf:id",
+	OVF_PATH_VIRTUALSYSTEM "/ovf:AnnotationSection/ovf:Annotation",
+	OVF_PATH_OPERATINGSYSTEM "/@ovf:id",
+	OVF_PATH_REFERENCES "/ovf:File",
+	OVF_PATH_DISKSECTION "/ovf:Disk",
+};
+
 static gboolean
 endswith (const gchar *str, const gchar *search)
 {
@@ -65,533 +228,5058 @@ endswith (const gchar *str, const gchar *search)
 	return g_ascii_strcasecmp (str + str_len - search_len, search) == 0;
 }
 
-static gboolean
-ova_extract_file_to_fd (const gchar  *ova_filename,
-                        const gchar  *extract_filename,
-                        gint          out_fd,
-                        GError      **error)
+static void
+govf_ova_member_free (GovfOvaMember *member)
 {
-	gboolean found;
-	gboolean ret = TRUE;
-	int r;
-	struct archive *a = NULL;
-
-	/* open the .ova archive */
-	a = archive_read_new ();
-	archive_read_support_format_all (a);
-	archive_read_support_filter_all (a);
-	r = archive_read_open_filename (a, ova_filename, 10240);
-	if (r != ARCHIVE_OK) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_FAILED,
-		             "Cannot open: %s",
-		             archive_error_string (a));
-		ret = FALSE;
-		goto out;
-	}
+	g_free (member->name);
+	g_slice_free (GovfOvaMember, member);
+}
 
-	/* find first matching file and extract it */
-	found = FALSE;
-	for (;;) {
-		g_autofree gchar *buf = NULL;
-		const gchar *name;
-		struct archive_entry *entry;
+static GovfOvaMember *
+ova_find_member (GovfPackage *self, const gchar *filename)
+{
+	guint i;
 
-		r = archive_read_next_header (a, &entry);
-		if (r == ARCHIVE_EOF)
-			break;
-		if (r != ARCHIVE_OK) {
-			g_set_error (error,
-			             GOVF_PACKAGE_ERROR,
-			             GOVF_PACKAGE_ERROR_FAILED,
-			             "Cannot read header: %s",
-			             archive_error_string (a));
-			ret = FALSE;
-			goto out;
-		}
+	if (self->ova_members == NULL)
+		return NULL;
 
-		/* did we find a match? */
-		name = archive_entry_pathname (entry);
-		if (name != NULL && endswith (name, extract_filename)) {
-			r = archive_read_data_into_fd (a, out_fd);
-			if (r != ARCHIVE_OK) {
-				g_set_error (error,
-				             GOVF_PACKAGE_ERROR,
-				             GOVF_PACKAGE_ERROR_FAILED,
-				             "Cannot extract: %s",
-				             archive_error_string (a));
-				ret = FALSE;
-				goto out;
-			}
-			found = TRUE;
-			break;
-		}
+	for (i = 0; i < self->ova_members->len; i++) {
+		GovfOvaMember *member = g_ptr_array_index (self->ova_members, i);
+		if (endswith (member->name, filename))
+			return member;
 	}
 
-	if (!found) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_NOT_FOUND,
-		             "Could not find any %s files",
-		             extract_filename);
-		ret = FALSE;
-	}
+	return NULL;
+}
 
-out:
-	if (a != NULL) {
-		archive_read_close (a);
-		archive_read_free (a);
-	}
-	return ret;
+/* extractions may run on several threads at once */
+static void
+stats_add (GovfPackage *self, GovfPackageStat stat, guint64 value)
+{
+	g_mutex_lock (&self->stats_mutex);
+	self->stats[stat] += value;
+	g_mutex_unlock (&self->stats_mutex);
 }
 
-static gboolean
-ova_extract_file_to_path (const gchar  *ova_filename,
-                          const gchar  *extract_filename,
-                          const gchar  *save_path,
-                          GError      **error)
+static void
+stats_add_time (GovfPackage *self, GovfPackageStat stat, gint64 begin)
 {
-	gboolean ret = TRUE;
-	gint fd = -1;
+	stats_add (self, stat, g_get_monotonic_time () - begin);
+}
 
-	fd = g_open (save_path, O_WRONLY | O_CREAT, 0666);
-	if (fd == -1) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_FAILED,
-		             "Failed to open file for writing: %s",
-		             save_path);
-		ret = FALSE;
-		goto out;
-	}
+static void
+govf_manifest_entry_free (GovfManifestEntry *entry)
+{
+	g_free (entry->digest);
+	g_slice_free (GovfManifestEntry, entry);
+}
 
+/* parses lines like "SHA256(disk1.vmdk)= 0123abcd..."; lines with other
+ * algorithms or in other formats are skipped */
+static GHashTable *
+manifest_parse (const gchar *data, gsize length)
+{
+	g_autofree gchar *text = NULL;
+	g_auto(GStrv) lines = NULL;
+	GHashTable *manifest;
+	guint i;
 
-	if (!ova_extract_file_to_fd (ova_filename, extract_filename, fd, error)) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_FAILED,
-		             "Failed to extract %s from %s",
-		             extract_filename,
-		             ova_filename);
-		ret = FALSE;
-		goto out;
-	}
+	manifest = g_hash_table_new_full (g_str_hash,
+	                                  g_str_equal,
+	                                  g_free,
+	                                  (GDestroyNotify) govf_manifest_entry_free);
 
-out:
-	if (fd != -1)
-		close (fd);
+	text = g_strndup (data, length);
+	lines = g_strsplit (text, "\n", -1);
+	for (i = 0; lines[i] != NULL; i++) {
+		GovfManifestEntry *entry;
+		GChecksumType type;
+		gchar *algorithm = lines[i];
+		gchar *name;
+		gchar *name_end;
+		gchar *digest;
 
-	return ret;
+		name = strchr (algorithm, '(');
+		name_end = strrchr (algorithm, ')');
+		if (name == NULL || name_end == NULL || name_end < name)
+			continue;
+		digest = strchr (name_end, '=');
+		if (digest == NULL)
+			continue;
+		*name++ = '\0';
+		*name_end = '\0';
+		digest++;
+
+		g_strstrip (algorithm);
+		if (g_ascii_strcasecmp (algorithm, "SHA1") == 0)
+			type = G_CHECKSUM_SHA1;
+		else if (g_ascii_strcasecmp (algorithm, "SHA256") == 0)
+			type = G_CHECKSUM_SHA256;
+		else if (g_ascii_strcasecmp (algorithm, "SHA512") == 0)
+			type = G_CHECKSUM_SHA512;
+		else
+			continue;
+
+		entry = g_slice_new (GovfManifestEntry);
+		entry->type = type;
+		entry->digest = g_strdup (g_strstrip (digest));
+		g_hash_table_insert (manifest, g_strdup (name), entry);
+	}
+
+	return manifest;
 }
 
-/**
- * govf_package_load_from_ova_file:
- * @self: a #GovfPackage
- * @filename: an .ova file name
- * @error: a #GError or %NULL
- *
- * Loads an OVF package from a compressed .ova file.
- *
- * Returns: %TRUE if the operation succeeded
- */
-gboolean
-govf_package_load_from_ova_file (GovfPackage  *self,
-                                 const gchar  *filename,
-                                 GError      **error)
+static GovfManifestEntry *
+manifest_lookup (GovfPackage *self, const gchar *name)
 {
-	g_autofree gchar *tmp_path = NULL;
-	gint tmp_fd = -1;
-	gboolean ret = TRUE;
-
-	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
+	GovfManifestEntry *entry;
 
-	g_free (self->ova_filename);
-	self->ova_filename = g_strdup (filename);
+	if (self->manifest == NULL)
+		return NULL;
 
-	/* open a temporary file */
-	tmp_fd = g_file_open_tmp ("govf-package-XXXXXX.ovf", &tmp_path, error);
-	if (tmp_fd == -1) {
-		ret = FALSE;
-		goto out;
-	}
+	entry = g_hash_table_lookup (self->manifest, name);
+	if (entry == NULL && g_str_has_prefix (name, "./"))
+		entry = g_hash_table_lookup (self->manifest, name + 2);
 
-	/* extract an .ovf file */
-	if (!ova_extract_file_to_fd (self->ova_filename, ".ovf", tmp_fd, error)) {
-		ret = FALSE;
-		goto out;
-	}
+	return entry;
+}
 
-	if (!govf_package_load_from_file (self, tmp_path, error)) {
-		ret = FALSE;
-		goto out;
-	}
+static void
+copy_context_progress (GovfCopyContext *ctx, goffset n)
+{
+	ctx->current += n;
+	if (ctx->progress_callback != NULL)
+		ctx->progress_callback (ctx->current, ctx->total, ctx->progress_data);
+}
 
-out:
-	if (tmp_fd != -1) {
-		close (tmp_fd);
-		g_unlink (tmp_path);
+static gboolean
+write_all (gint          fd,
+           const gchar  *buf,
+           gsize         count,
+           GError      **error)
+{
+	while (count > 0) {
+		gssize n = write (fd, buf, count);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot write: %s",
+			             g_strerror (errno));
+			return FALSE;
+		}
+		buf += n;
+		count -= n;
 	}
 
-	return ret;
+	return TRUE;
 }
 
-/**
- * govf_package_load_from_file:
- * @self: a #GovfPackage
- * @filename: an .ovf file name
- * @error: a #GError or %NULL
- *
- * Loads an OVF package from an uncompressed .ovf file.
- *
- * Returns: %TRUE if the operation succeeded
- */
-gboolean
-govf_package_load_from_file (GovfPackage  *self,
-                             const gchar  *filename,
-                             GError      **error)
+/* glibc's memcmp is vectorized, which makes comparing the buffer against
+ * itself shifted by one byte the quickest portable zero check */
+static gboolean
+buffer_is_zero (const gchar *buf, gsize len)
 {
-	g_autofree gchar *data = NULL;
-	gsize length;
+	return len == 0 || (buf[0] == 0 && memcmp (buf, buf + 1, len - 1) == 0);
+}
 
-	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
+/* page aligned, so that the buffer can also be used for direct I/O */
+static gchar *
+copy_buffer_new (gsize size)
+{
+	void *buf;
 
-	if (!g_file_get_contents (filename, &data, &length, error))
-		return FALSE;
+	if (posix_memalign (&buf, COPY_BUFFER_ALIGNMENT, size) != 0)
+		g_error ("Failed to allocate %" G_GSIZE_FORMAT " bytes", size);
 
-	return govf_package_load_from_data (self, data, length, error);
+	return buf;
 }
 
-/**
- * govf_package_save_file:
- * @self: a #GovfPackage
- * @filename: an .ovf file name
- * @error: a #GError or %NULL
- *
- * Saves the OVF package to an uncompressed .ovf file.
- *
- * Returns: %TRUE if the operation succeeded
- */
-gboolean
-govf_package_save_file (GovfPackage  *self,
-                        const gchar  *filename,
-                        GError      **error)
+static gsize
+copy_context_block_size (GovfCopyContext *ctx)
 {
-	gboolean ret = TRUE;
-	int length;
-	xmlChar *data = NULL;
+	return ctx->block_size > 0 ? ctx->block_size : COPY_BUFFER_SIZE;
+}
 
-	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
-	g_return_val_if_fail (filename != NULL, FALSE);
+/* only regular files read back holes as zeros */
+static void
+copy_context_prepare (GovfCopyContext *ctx, gint out_fd)
+{
+	struct stat st;
 
-	xmlDocDumpMemory (self->doc, &data, &length);
+	if (ctx->sparse && (fstat (out_fd, &st) != 0 || !S_ISREG (st.st_mode)))
+		ctx->sparse = FALSE;
+}
 
-	if (!g_file_set_contents (filename, (const gchar *) data, (gsize) length, error)) {
-		ret = FALSE;
-		goto out;
+/* writes out a buffer at the current position; when extracting sparsely,
+ * runs of all-zero blocks are seeked over instead, leaving holes in the
+ * file */
+static gboolean
+copy_context_write_out (GovfCopyContext  *ctx,
+                        gint              out_fd,
+                        const gchar      *buf,
+                        gsize             count,
+                        GError          **error)
+{
+	if (!ctx->sparse) {
+		if (!write_all (out_fd, buf, count, error))
+			return FALSE;
+		ctx->bytes_written += count;
+		return TRUE;
 	}
 
-out:
-	if (data != NULL)
-		xmlFree (data);
+	while (count > 0) {
+		gboolean zero;
+		gsize len;
 
-	return ret;
+		zero = buffer_is_zero (buf, MIN (count, SPARSE_BLOCK_SIZE));
+		len = MIN (count, SPARSE_BLOCK_SIZE);
+		while (len < count &&
+		       buffer_is_zero (buf + len, MIN (count - len, SPARSE_BLOCK_SIZE)) == zero)
+			len += MIN (count - len, SPARSE_BLOCK_SIZE);
+
+		if (zero) {
+			if (lseek (out_fd, len, SEEK_CUR) < 0) {
+				g_set_error (error,
+				             GOVF_PACKAGE_ERROR,
+				             GOVF_PACKAGE_ERROR_FAILED,
+				             "Cannot seek: %s",
+				             g_strerror (errno));
+				return FALSE;
+			}
+		} else {
+			if (!write_all (out_fd, buf, len, error))
+				return FALSE;
+			ctx->bytes_written += len;
+		}
+		buf += len;
+		count -= len;
+	}
+
+	return TRUE;
 }
 
+/* direct I/O needs aligned buffers, sizes and offsets, so data is gathered
+ * into whole aligned blocks first; a NULL buffer stands for zeros */
 static gboolean
-xpath_section_exists (xmlXPathContext *ctx, const gchar *path)
+copy_context_stage (GovfCopyContext  *ctx,
+                    gint              out_fd,
+                    const gchar      *buf,
+                    gsize             count,
+                    GError          **error)
 {
-	gboolean ret = TRUE;
-	xmlXPathObject *obj;
+	gsize size = GOVF_ROUND_UP (copy_context_block_size (ctx), COPY_BUFFER_ALIGNMENT);
 
-	obj = xmlXPathEval ((const xmlChar *) path, ctx);
-	if (obj == NULL ||
-	    obj->type != XPATH_NODESET ||
-	    obj->nodesetval == NULL ||
-	    obj->nodesetval->nodeNr == 0) {
-		ret = FALSE;
-		goto out;
+	while (count > 0) {
+		gsize n = MIN (count, size - ctx->direct_len);
+
+		if (buf != NULL) {
+			memcpy (ctx->direct_buf + ctx->direct_len, buf, n);
+			buf += n;
+		} else {
+			memset (ctx->direct_buf + ctx->direct_len, 0, n);
+		}
+		ctx->direct_len += n;
+		count -= n;
+
+		if (ctx->direct_len == size) {
+			if (!copy_context_write_out (ctx, out_fd, ctx->direct_buf, size, error))
+				return FALSE;
+			ctx->direct_len = 0;
+		}
 	}
 
-out:
-	if (obj != NULL)
-		xmlXPathFreeObject (obj);
+	return TRUE;
+}
 
-	return ret;
+static gboolean
+copy_context_write (GovfCopyContext  *ctx,
+                    gint              out_fd,
+                    const gchar      *buf,
+                    gsize             count,
+                    GError          **error)
+{
+	if (ctx->hasher != NULL)
+		govf_hasher_update (ctx->hasher, buf, count);
+
+	if (ctx->direct_buf != NULL)
+		return copy_context_stage (ctx, out_fd, buf, count, error);
+
+	return copy_context_write_out (ctx, out_fd, buf, count, error);
 }
 
-static gchar *
-xpath_str (xmlXPathContext *ctx, const gchar *path)
+/* moves past a hole in the member */
+static gboolean
+copy_context_skip (GovfCopyContext  *ctx,
+                   gint              out_fd,
+                   gint64            count,
+                   GError          **error)
 {
-	xmlChar *content = NULL;
-	xmlXPathObject *obj;
-	gchar *ret;
+	if (ctx->direct_buf != NULL) {
+		while (count > 0) {
+			gsize n = MIN (count, G_MAXSIZE);
 
-	obj = xmlXPathEval ((const xmlChar *) path, ctx);
-	if (obj == NULL ||
-	    obj->type != XPATH_NODESET ||
-	    obj->nodesetval == NULL ||
-	    obj->nodesetval->nodeNr == 0) {
-		ret = NULL;
-		goto out;
+			if (!copy_context_stage (ctx, out_fd, NULL, n, error))
+				return FALSE;
+			count -= n;
+		}
+		return TRUE;
 	}
 
-	content = xmlNodeGetContent (obj->nodesetval->nodeTab[0]);
+	if (lseek (out_fd, count, SEEK_CUR) < 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot seek: %s",
+		             g_strerror (errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* a hole reads back as zeros, so that is what gets hashed */
+static gboolean
+copy_context_hole (GovfCopyContext  *ctx,
+                   gint              out_fd,
+                   gint64            count,
+                   GError          **error)
+{
+	if (ctx->hasher != NULL)
+		govf_hasher_update_zeros (ctx->hasher, count);
+
+	return copy_context_skip (ctx, out_fd, count, error);
+}
+
+/* writes out the last staged block padded to the alignment, and returns
+ * where the data really ends */
+static gboolean
+copy_context_flush_direct (GovfCopyContext  *ctx,
+                           gint              out_fd,
+                           off_t            *end,
+                           GError          **error)
+{
+	gsize padded;
+	gsize pad;
+
+	padded = GOVF_ROUND_UP (ctx->direct_len, COPY_BUFFER_ALIGNMENT);
+	pad = padded - ctx->direct_len;
+	memset (ctx->direct_buf + ctx->direct_len, 0, pad);
+	if (!copy_context_write_out (ctx, out_fd, ctx->direct_buf, padded, error))
+		return FALSE;
+	if (pad > 0 &&
+	    !(ctx->sparse && buffer_is_zero (ctx->direct_buf + padded - COPY_BUFFER_ALIGNMENT,
+	                                     COPY_BUFFER_ALIGNMENT)))
+		ctx->bytes_written -= pad;
+	ctx->direct_len = 0;
+
+	*end = lseek (out_fd, 0, SEEK_CUR);
+	if (*end >= 0)
+		*end -= pad;
+
+	return TRUE;
+}
+
+/* allocates the whole member up front, without changing the file size so
+ * that a short copy still shows */
+static void
+copy_context_preallocate (GovfCopyContext *ctx, gint out_fd, gint64 size)
+{
+#ifdef HAVE_FALLOCATE
+	if ((ctx->io_flags & GOVF_IO_FLAGS_PREALLOCATE) == 0 || ctx->sparse || size <= 0)
+		return;
+
+	/* only a hint; not every filesystem can do this */
+	if (fallocate (out_fd, FALLOC_FL_KEEP_SIZE, 0, size) != 0)
+		g_debug ("Cannot preallocate %" G_GINT64_FORMAT " bytes: %s", size, g_strerror (errno));
+#endif
+}
+
+static gboolean
+disk_is_stream_optimized (GovfDisk *disk)
+{
+	const gchar *format = govf_disk_get_format (disk);
+
+	return format != NULL && endswith (format, "#streamOptimized");
+}
+
+static void
+copy_context_init_for_extraction (GovfCopyContext  *ctx,
+                                  GovfExtraction   *extraction)
+{
+	GovfExtractFlags flags = govf_extraction_get_flags (extraction);
+
+	ctx->sparse = (flags & GOVF_EXTRACT_FLAGS_SPARSE) != 0;
+	ctx->verify = (flags & GOVF_EXTRACT_FLAGS_VERIFY) != 0;
+	ctx->convert_raw = (flags & GOVF_EXTRACT_FLAGS_CONVERT_RAW) != 0 &&
+	                   disk_is_stream_optimized (govf_extraction_get_disk (extraction));
+}
+
+static void
+copy_context_update_extraction (GovfCopyContext  *ctx,
+                                GovfExtraction   *extraction)
+{
+	govf_extraction_set_size (extraction, ctx->total);
+	govf_extraction_set_bytes_written (extraction, ctx->bytes_written);
+}
+
+/* starts digesting the member that is about to be copied, if the
+ * extraction is to be verified against the manifest */
+static gboolean
+copy_context_start_verify (GovfCopyContext  *ctx,
+                           GovfPackage      *self,
+                           const gchar      *filename,
+                           GError          **error)
+{
+	GovfManifestEntry *entry;
+
+	if (!ctx->verify)
+		return TRUE;
+
+	entry = manifest_lookup (self, filename);
+	if (entry == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_NOT_FOUND,
+		             "No digest for %s in the manifest",
+		             filename);
+		return FALSE;
+	}
+
+	ctx->hasher = govf_hasher_new (entry->type);
+	ctx->digest = entry->digest;
+
+	return TRUE;
+}
+
+static gboolean
+copy_context_finish_verify (GovfCopyContext  *ctx,
+                            const gchar      *filename,
+                            GError          **error)
+{
+	if (ctx->hasher == NULL)
+		return TRUE;
+
+	if (g_ascii_strcasecmp (govf_hasher_get_digest (ctx->hasher), ctx->digest) != 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH,
+		             "Digest of %s does not match the manifest",
+		             filename);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+copy_context_clear (GovfCopyContext *ctx)
+{
+	g_clear_pointer (&ctx->hasher, govf_hasher_free);
+	g_clear_pointer (&ctx->direct_buf, free);
+	ctx->direct_len = 0;
+}
+
+static gboolean
+copy_context_finish (GovfCopyContext  *ctx,
+                     gint              out_fd,
+                     GError          **error)
+{
+	struct stat st;
+	off_t end;
+
+	if (ctx->direct_buf != NULL) {
+		if (!copy_context_flush_direct (ctx, out_fd, &end, error))
+			return FALSE;
+	} else {
+		end = lseek (out_fd, 0, SEEK_CUR);
+	}
+
+	/* holes at the end of a file only show up in its size, and the last
+	 * block written with direct I/O is padded */
+	if (end >= 0 &&
+	    fstat (out_fd, &st) == 0 &&
+	    S_ISREG (st.st_mode) &&
+	    (st.st_size < end || (ctx->direct_buf != NULL && st.st_size > end)) &&
+	    ftruncate (out_fd, end) != 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot write: %s",
+		             g_strerror (errno));
+		return FALSE;
+	}
+
+	/* dirty pages can't be dropped, so write them out first */
+	if ((ctx->io_flags & GOVF_IO_FLAGS_DROP_CACHE) != 0) {
+		if (fdatasync (out_fd) != 0 && errno != EINVAL) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot sync: %s",
+			             g_strerror (errno));
+			return FALSE;
+		}
+#ifdef HAVE_POSIX_FADVISE
+		posix_fadvise (out_fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	}
+
+	return TRUE;
+}
+
+#ifdef FICLONERANGE
+/* shares the extents with the archive on filesystems with reflink support;
+ * the kernel only allows this for block aligned ranges */
+static gboolean
+copy_fd_range_clone (gint              in_fd,
+                     gint64            offset,
+                     gint64            size,
+                     gint              out_fd,
+                     GovfCopyContext  *ctx)
+{
+	struct file_clone_range range;
+	off_t out_offset;
+
+	out_offset = lseek (out_fd, 0, SEEK_CUR);
+	if (out_offset < 0)
+		return FALSE;
+
+	range.src_fd = in_fd;
+	range.src_offset = offset;
+	range.src_length = size;
+	range.dest_offset = out_offset;
+	if (ioctl (out_fd, FICLONERANGE, &range) != 0)
+		return FALSE;
+	if (lseek (out_fd, out_offset + size, SEEK_SET) < 0)
+		return FALSE;
+
+	ctx->bytes_written += size;
+	copy_context_progress (ctx, size);
+	return TRUE;
+}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+static gboolean
+copy_fd_range_copy_file_range (gint              in_fd,
+                               gint64           *offset,
+                               gint64           *size,
+                               gint              out_fd,
+                               GovfCopyContext  *ctx)
+{
+	while (*size > 0) {
+		loff_t off_in = *offset;
+		gssize n;
+
+		if (g_cancellable_is_cancelled (ctx->cancellable))
+			return FALSE;
+
+		n = copy_file_range (in_fd, &off_in, out_fd, NULL,
+		                     MIN (*size, COPY_KERNEL_CHUNK_SIZE), 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+		*offset += n;
+		*size -= n;
+		ctx->bytes_written += n;
+		copy_context_progress (ctx, n);
+	}
+
+	return TRUE;
+}
+#endif
+
+#ifdef HAVE_SYS_SENDFILE_H
+static gboolean
+copy_fd_range_sendfile (gint              in_fd,
+                        gint64           *offset,
+                        gint64           *size,
+                        gint              out_fd,
+                        GovfCopyContext  *ctx)
+{
+	while (*size > 0) {
+		off_t off_in = *offset;
+		gssize n;
+
+		if (g_cancellable_is_cancelled (ctx->cancellable))
+			return FALSE;
+
+		n = sendfile (out_fd, in_fd, &off_in, MIN (*size, COPY_KERNEL_CHUNK_SIZE));
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return FALSE;
+		*offset += n;
+		*size -= n;
+		ctx->bytes_written += n;
+		copy_context_progress (ctx, n);
+	}
+
+	return TRUE;
+}
+#endif
+
+#ifdef HAVE_LIBURING
+static void
+copy_context_written_cb (gsize len, gpointer user_data)
+{
+	GovfCopyContext *ctx = user_data;
+
+	ctx->bytes_written += len;
+	copy_context_progress (ctx, len);
+}
+#endif
+
+/* copies a byte range between two files, preferring reflinks and in-kernel
+ * copies; each method picks up where the previous one gave up, and plain
+ * read/write is used for whatever is left */
+static gboolean
+copy_fd_range (gint              in_fd,
+               gint64            offset,
+               gint64            size,
+               gint              out_fd,
+               GovfCopyContext  *ctx,
+               GError          **error)
+{
+	gboolean ret = TRUE;
+	gchar *buf = NULL;
+
+	if (g_cancellable_set_error_if_cancelled (ctx->cancellable, error))
+		return FALSE;
+
+	/* reflinks and in-kernel copies would carry over zero blocks too, and
+	 * bypass the hasher and the staging for direct I/O */
+	if (!ctx->sparse && ctx->hasher == NULL && ctx->direct_buf == NULL) {
+#ifdef FICLONERANGE
+		if (size > 0 && copy_fd_range_clone (in_fd, offset, size, out_fd, ctx))
+			return TRUE;
+#endif
+#ifdef HAVE_COPY_FILE_RANGE
+		if (copy_fd_range_copy_file_range (in_fd, &offset, &size, out_fd, ctx))
+			return TRUE;
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+		if (copy_fd_range_sendfile (in_fd, &offset, &size, out_fd, ctx))
+			return TRUE;
+#endif
+	}
+
+#ifdef HAVE_LIBURING
+	/* falls back to read/write below where the kernel doesn't allow it */
+	if ((ctx->io_flags & GOVF_IO_FLAGS_IO_URING) != 0 &&
+	    !ctx->sparse && ctx->direct_buf == NULL && size > 0) {
+		GovfUring *uring = govf_uring_new (in_fd,
+		                                   offset,
+		                                   size,
+		                                   out_fd,
+		                                   copy_context_block_size (ctx));
+
+		if (uring != NULL) {
+			ret = govf_uring_copy (uring,
+			                       ctx->hasher,
+			                       copy_context_written_cb,
+			                       ctx,
+			                       &ctx->bytes_read,
+			                       ctx->cancellable,
+			                       error);
+			govf_uring_free (uring);
+			return ret;
+		}
+	}
+#endif
+
+	buf = copy_buffer_new (copy_context_block_size (ctx));
+	while (size > 0) {
+		gssize n;
+
+		if (g_cancellable_set_error_if_cancelled (ctx->cancellable, error)) {
+			ret = FALSE;
+			goto out;
+		}
+
+		n = pread (in_fd, buf, MIN (size, copy_context_block_size (ctx)), offset);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot read: %s",
+			             g_strerror (errno));
+			ret = FALSE;
+			goto out;
+		}
+		if (n == 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Unexpected end of archive");
+			ret = FALSE;
+			goto out;
+		}
+		ctx->bytes_read += n;
+		if (!copy_context_write (ctx, out_fd, buf, n, error)) {
+			ret = FALSE;
+			goto out;
+		}
+		offset += n;
+		size -= n;
+		copy_context_progress (ctx, n);
+	}
+
+out:
+	free (buf);
+	return ret;
+}
+
+static gssize
+member_reader_read (gpointer   user_data,
+                    gpointer   buf,
+                    gsize      count,
+                    GError   **error)
+{
+	GovfMemberReader *reader = user_data;
+	gssize n;
+
+	if (g_cancellable_set_error_if_cancelled (reader->ctx->cancellable, error))
+		return -1;
+
+	if (reader->a != NULL) {
+		n = archive_read_data (reader->a, buf, count);
+		if (n < 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot extract: %s",
+			             archive_error_string (reader->a));
+			return -1;
+		}
+		if (reader->ctx->hasher != NULL)
+			govf_hasher_update (reader->ctx->hasher, buf, n);
+		copy_context_progress (reader->ctx, n);
+		return n;
+	}
+
+	count = MIN ((gint64) count, reader->remaining);
+	if (count == 0)
+		return 0;
+
+	if (reader->stream != NULL) {
+		n = g_input_stream_read (reader->stream,
+		                         buf,
+		                         count,
+		                         reader->ctx->cancellable,
+		                         error);
+		if (n < 0)
+			return -1;
+	} else {
+		do {
+			n = pread (reader->fd, buf, count, reader->offset);
+		} while (n < 0 && errno == EINTR);
+		if (n < 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot read: %s",
+			             g_strerror (errno));
+			return -1;
+		}
+	}
+	reader->offset += n;
+	reader->remaining -= n;
+	reader->ctx->bytes_read += n;
+	if (reader->ctx->hasher != NULL)
+		govf_hasher_update (reader->ctx->hasher, buf, n);
+	copy_context_progress (reader->ctx, n);
+
+	return n;
+}
+
+/* the progress reported while converting is in compressed bytes read,
+ * while the extraction records the size of the raw image */
+static gboolean
+copy_context_convert (GovfCopyContext   *ctx,
+                      GovfMemberReader  *reader,
+                      gint               out_fd,
+                      GError           **error)
+{
+	guint64 size;
+	guint64 bytes_written;
+
+	if (!govf_vmdk_convert_to_raw (member_reader_read,
+	                               reader,
+	                               out_fd,
+	                               ctx->sparse,
+	                               ctx->convert_threads,
+	                               &size,
+	                               &bytes_written,
+	                               error))
+		return FALSE;
+
+	ctx->total = size;
+	ctx->bytes_written += bytes_written;
+
+	return TRUE;
+}
+
+static gboolean
+copy_stream_range (GInputStream     *stream,
+                   gint64            offset,
+                   gint64            size,
+                   gint              out_fd,
+                   GovfCopyContext  *ctx,
+                   GError          **error)
+{
+	g_autofree gchar *buf = NULL;
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, ctx->cancellable, error))
+		return FALSE;
+
+	buf = g_malloc (copy_context_block_size (ctx));
+	while (size > 0) {
+		gssize n;
+
+		n = g_input_stream_read (stream,
+		                         buf,
+		                         MIN (size, copy_context_block_size (ctx)),
+		                         ctx->cancellable,
+		                         error);
+		if (n < 0)
+			return FALSE;
+		if (n == 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Unexpected end of archive");
+			return FALSE;
+		}
+		ctx->bytes_read += n;
+		if (!copy_context_write (ctx, out_fd, buf, n, error))
+			return FALSE;
+		size -= n;
+		copy_context_progress (ctx, n);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+ova_source_is_seekable (GovfPackage *self)
+{
+	if (self->ova_stream != NULL)
+		return G_IS_SEEKABLE (self->ova_stream) &&
+		       g_seekable_can_seek (G_SEEKABLE (self->ova_stream));
+
+	return self->ova_filename != NULL;
+}
+
+static const gchar *
+ova_source_name (GovfPackage *self)
+{
+	if (self->ova_stream_name != NULL)
+		return self->ova_stream_name;
+	if (self->ova_stream != NULL)
+		return "input stream";
+
+	return self->ova_filename;
+}
+
+/* a stream has a single read position, so only one pass may read it at
+ * a time; another one fails right away rather than interleaving reads */
+static gboolean
+ova_source_begin (GovfPackage *self, GError **error)
+{
+	if (self->ova_stream == NULL)
+		return TRUE;
+
+	if (!g_atomic_int_compare_and_exchange (&self->ova_stream_busy, FALSE, TRUE)) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Another operation is already reading the package");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+ova_source_end (GovfPackage *self)
+{
+	if (self->ova_stream != NULL)
+		g_atomic_int_set (&self->ova_stream_busy, FALSE);
+}
+
+/* the member offsets recorded when loading are only good for the file as
+ * it was then; one rewritten or replaced since may have anything there */
+static gboolean
+ova_check_unchanged (GovfPackage *self, gint fd, GError **error)
+{
+	GovfCacheKey now;
+
+	if (!self->ova_key_valid)
+		return TRUE;
+
+	if (!govf_cache_key_init_from_fd (&now, fd) ||
+	    !govf_cache_key_equal (&self->ova_key, &now)) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot open %s: file changed since it was loaded",
+		             self->ova_filename);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* copies a member straight from its recorded offset in the archive,
+ * without going through libarchive */
+static gboolean
+ova_copy_member_to_fd (GovfPackage      *self,
+                       GovfOvaMember    *member,
+                       gint              out_fd,
+                       GovfCopyContext  *ctx,
+                       GError          **error)
+{
+	GovfMemberReader reader = { ctx, NULL, NULL, -1, member->data_offset, member->size };
+	gboolean ret = TRUE;
+	gint in_fd = -1;
+
+	ctx->total = member->size;
+	if (!ctx->convert_raw)
+		copy_context_preallocate (ctx, out_fd, member->size);
+	if (self->ova_stream != NULL) {
+		if (!ova_source_begin (self, error))
+			return FALSE;
+		if (!ctx->convert_raw) {
+			ret = copy_stream_range (self->ova_stream,
+			                         member->data_offset,
+			                         member->size,
+			                         out_fd,
+			                         ctx,
+			                         error);
+		} else if (g_seekable_seek (G_SEEKABLE (self->ova_stream),
+		                            member->data_offset,
+		                            G_SEEK_SET,
+		                            ctx->cancellable,
+		                            error)) {
+			reader.stream = self->ova_stream;
+			ret = copy_context_convert (ctx, &reader, out_fd, error);
+		} else {
+			ret = FALSE;
+		}
+		ova_source_end (self);
+		return ret;
+	}
+
+	in_fd = g_open (self->ova_filename, O_RDONLY, 0);
+	if (in_fd == -1) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot open: %s",
+		             g_strerror (errno));
+		ret = FALSE;
+		goto out;
+	}
+	if (!ova_check_unchanged (self, in_fd, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+#ifdef HAVE_POSIX_FADVISE
+	if ((ctx->io_flags & GOVF_IO_FLAGS_DROP_CACHE) != 0)
+		posix_fadvise (in_fd, member->data_offset, member->size, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	if (ctx->convert_raw) {
+		reader.fd = in_fd;
+		ret = copy_context_convert (ctx, &reader, out_fd, error);
+		goto out;
+	}
+
+	if (!copy_fd_range (in_fd, member->data_offset, member->size, out_fd, ctx, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+out:
+	if (in_fd != -1) {
+#ifdef HAVE_POSIX_FADVISE
+		if ((ctx->io_flags & GOVF_IO_FLAGS_DROP_CACHE) != 0)
+			posix_fadvise (in_fd, member->data_offset, member->size, POSIX_FADV_DONTNEED);
+#endif
+		close (in_fd);
+	}
+
+	return ret;
+}
+
+/* reads the stream ahead of libarchive, so that reading and inflating a
+ * compressed archive overlap; an empty buffer marks the end */
+static gpointer
+stream_reader_readahead_func (gpointer data)
+{
+	GovfStreamReader *reader = data;
+
+	for (;;) {
+		GBytes *bytes;
+		gchar *buf;
+		gssize n;
+
+		buf = g_malloc (reader->buf_size);
+		n = g_input_stream_read (reader->stream,
+		                         buf,
+		                         reader->buf_size,
+		                         reader->readahead_cancellable,
+		                         &reader->readahead_error);
+		if (n <= 0) {
+			g_free (buf);
+			bytes = g_bytes_new (NULL, 0);
+		} else {
+			bytes = g_bytes_new_take (buf, n);
+		}
+
+		if (!govf_channel_push (reader->readahead, bytes, g_bytes_get_size (bytes))) {
+			g_bytes_unref (bytes);
+			break;
+		}
+		if (n <= 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static void
+stream_reader_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	GovfStreamReader *reader = user_data;
+
+	g_cancellable_cancel (reader->readahead_cancellable);
+}
+
+/* sets the cancellable of the pass reading the archive; the read-ahead
+ * thread outlives a pass over a stream, so it reads with a cancellable of
+ * its own that cancelling the current pass cancels as well */
+static void
+stream_reader_set_cancellable (GovfStreamReader  *reader,
+                               GCancellable      *cancellable)
+{
+	if (reader->cancelled_id != 0) {
+		g_cancellable_disconnect (reader->cancellable, reader->cancelled_id);
+		reader->cancelled_id = 0;
+	}
+
+	reader->cancellable = cancellable;
+	if (reader->readahead_cancellable != NULL && cancellable != NULL) {
+		reader->cancelled_id = g_cancellable_connect (cancellable,
+		                                              G_CALLBACK (stream_reader_cancelled_cb),
+		                                              reader,
+		                                              NULL);
+	}
+}
+
+/* from here on the stream is only touched by the read-ahead thread */
+static void
+stream_reader_start_readahead (GovfStreamReader *reader)
+{
+	if (reader->readahead != NULL)
+		return;
+
+	reader->readahead = govf_channel_new ((GDestroyNotify) g_bytes_unref);
+	reader->readahead_cancellable = g_cancellable_new ();
+	stream_reader_set_cancellable (reader, reader->cancellable);
+	reader->readahead_thread = g_thread_new ("govf-readahead",
+	                                         stream_reader_readahead_func,
+	                                         reader);
+}
+
+static la_ssize_t
+stream_reader_read_cb (struct archive  *a,
+                       void            *client_data,
+                       const void     **buffer)
+{
+	GovfStreamReader *reader = client_data;
+	g_autoptr(GError) error = NULL;
+	gssize n;
+
+	if (reader->readahead != NULL) {
+		gsize size;
+
+		if (reader->readahead_eof)
+			return 0;
+
+		/* libarchive may use the buffer until the next read */
+		g_clear_pointer (&reader->readahead_bytes, g_bytes_unref);
+		reader->readahead_bytes = govf_channel_pop (reader->readahead);
+		*buffer = g_bytes_get_data (reader->readahead_bytes, &size);
+		govf_channel_release (reader->readahead, size);
+		stats_add (reader->package, GOVF_PACKAGE_STAT_BYTES_READ, size);
+		if (size == 0) {
+			reader->readahead_eof = TRUE;
+			if (reader->readahead_error != NULL) {
+				archive_set_error (a, EIO, "%s", reader->readahead_error->message);
+				return ARCHIVE_FATAL;
+			}
+		}
+		return size;
+	}
+
+	n = g_input_stream_read (reader->stream,
+	                         reader->buf,
+	                         reader->read_size,
+	                         reader->cancellable,
+	                         &error);
+	if (n < 0) {
+		archive_set_error (a, EIO, "%s", error->message);
+		return ARCHIVE_FATAL;
+	}
+	if (reader->bytes_read != NULL)
+		*reader->bytes_read += n;
+	stats_add (reader->package, GOVF_PACKAGE_STAT_BYTES_READ, n);
+
+	/* reads start out small after a seek, and grow back while the data
+	 * is actually being read through */
+	reader->read_size = MIN (reader->read_size * 2, reader->buf_size);
+
+	*buffer = reader->buf;
+	return n;
+}
+
+/* lets libarchive step over member data without reading it */
+static la_int64_t
+stream_reader_skip_cb (struct archive  *a,
+                       void            *client_data,
+                       la_int64_t       request)
+{
+	GovfStreamReader *reader = client_data;
+
+	if (reader->readahead != NULL ||
+	    !G_IS_SEEKABLE (reader->stream) ||
+	    !g_seekable_can_seek (G_SEEKABLE (reader->stream)))
+		return 0;
+
+	if (!g_seekable_seek (G_SEEKABLE (reader->stream),
+	                      request,
+	                      G_SEEK_CUR,
+	                      reader->cancellable,
+	                      NULL))
+		return 0;
+	if (reader->bytes_read != NULL)
+		reader->read_size = INDEX_READ_SIZE;
+	stats_add (reader->package, GOVF_PACKAGE_STAT_BYTES_SKIPPED, request);
+
+	return request;
+}
+
+static la_int64_t
+stream_reader_seek_cb (struct archive  *a,
+                       void            *client_data,
+                       la_int64_t       offset,
+                       int              whence)
+{
+	GovfStreamReader *reader = client_data;
+	g_autoptr(GError) error = NULL;
+	GSeekType type;
+	goffset new_position;
+	goffset position;
+
+	position = g_seekable_tell (G_SEEKABLE (reader->stream));
+	switch (whence) {
+	case SEEK_CUR:
+		type = G_SEEK_CUR;
+		break;
+	case SEEK_END:
+		type = G_SEEK_END;
+		break;
+	default:
+		type = G_SEEK_SET;
+		break;
+	}
+
+	if (!g_seekable_seek (G_SEEKABLE (reader->stream),
+	                      offset,
+	                      type,
+	                      reader->cancellable,
+	                      &error)) {
+		archive_set_error (a, EIO, "%s", error->message);
+		return ARCHIVE_FATAL;
+	}
+	if (reader->bytes_read != NULL)
+		reader->read_size = INDEX_READ_SIZE;
+
+	/* libarchive seeks forward to step over member data */
+	new_position = g_seekable_tell (G_SEEKABLE (reader->stream));
+	if (new_position > position)
+		stats_add (reader->package, GOVF_PACKAGE_STAT_BYTES_SKIPPED, new_position - position);
+
+	return new_position;
+}
+
+static int
+stream_reader_close_cb (struct archive  *a,
+                        void            *client_data)
+{
+	GovfStreamReader *reader = client_data;
+
+	stream_reader_set_cancellable (reader, NULL);
+	if (reader->readahead != NULL) {
+		/* a read blocked on a stalled stream would hold up the join */
+		g_cancellable_cancel (reader->readahead_cancellable);
+		govf_channel_close (reader->readahead);
+		g_thread_join (reader->readahead_thread);
+		govf_channel_free (reader->readahead);
+		g_clear_object (&reader->readahead_cancellable);
+		g_clear_pointer (&reader->readahead_bytes, g_bytes_unref);
+		g_clear_error (&reader->readahead_error);
+	}
+	g_object_unref (reader->stream);
+	g_free (reader->buf);
+	g_slice_free (GovfStreamReader, reader);
+
+	return ARCHIVE_OK;
+}
+
+/* opens the package source for a pass over the archive; a non-seekable
+ * stream can only be read once, so each pass over it carries on from
+ * where the previous one stopped
+ *
+ * an .ova file is read through GIO as well, so that libarchive seeks over
+ * member data instead of reading it; when @bytes_read is set, the bytes
+ * actually read are added to it, and reads are kept small after seeks as
+ * the pass is mostly after headers */
+static struct archive *
+ova_open_archive (GovfPackage   *self,
+                  guint64       *bytes_read,
+                  GCancellable  *cancellable,
+                  GError       **error)
+{
+	g_autoptr(GInputStream) stream = NULL;
+	GovfStreamReader *reader;
+	int r;
+	struct archive *a;
+
+	if (!ova_source_begin (self, error))
+		return NULL;
+
+	if (self->ova_stream_archive != NULL) {
+		stream_reader_set_cancellable (self->ova_stream_reader, cancellable);
+		self->ova_stream_reader->read_size = self->ova_stream_reader->buf_size;
+		self->ova_stream_reader->bytes_read = bytes_read;
+		if (bytes_read == NULL && self->ova_compressed)
+			stream_reader_start_readahead (self->ova_stream_reader);
+		return g_steal_pointer (&self->ova_stream_archive);
+	}
+
+	if (self->ova_stream == NULL) {
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GFile) file = g_file_new_for_path (self->ova_filename);
+
+		stream = G_INPUT_STREAM (g_file_read (file, cancellable, &error_local));
+		if (stream == NULL) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot open: %s",
+			             error_local->message);
+			return NULL;
+		}
+	} else {
+		if (ova_source_is_seekable (self)) {
+			if (!g_seekable_seek (G_SEEKABLE (self->ova_stream), 0, G_SEEK_SET, cancellable, error)) {
+				ova_source_end (self);
+				return NULL;
+			}
+		} else if (self->ova_stream_consumed) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot rewind stream");
+			ova_source_end (self);
+			return NULL;
+		}
+		self->ova_stream_consumed = TRUE;
+		stream = g_object_ref (self->ova_stream);
+	}
+
+	reader = g_slice_new0 (GovfStreamReader);
+	reader->package = self;
+	reader->stream = g_steal_pointer (&stream);
+	reader->cancellable = cancellable;
+	reader->buf_size = STREAM_READ_BUFFER_SIZE;
+	if (self->extract_options != NULL &&
+	    govf_extract_options_get_block_size (self->extract_options) > 0)
+		reader->buf_size = govf_extract_options_get_block_size (self->extract_options);
+	reader->buf = g_malloc (reader->buf_size);
+	reader->read_size = MIN (bytes_read != NULL ? INDEX_READ_SIZE : STREAM_READ_BUFFER_SIZE,
+	                         reader->buf_size);
+	reader->bytes_read = bytes_read;
+	if (self->ova_stream != NULL)
+		self->ova_stream_reader = reader;
+
+	a = archive_read_new ();
+	archive_read_support_format_all (a);
+	archive_read_support_filter_all (a);
+	archive_read_set_callback_data (a, reader);
+	archive_read_set_read_callback (a, stream_reader_read_cb);
+	archive_read_set_skip_callback (a, stream_reader_skip_cb);
+	archive_read_set_close_callback (a, stream_reader_close_cb);
+	/* a compressed archive is inflated front to back anyway, so there is
+	 * nothing to seek over once the index is known */
+	if (bytes_read == NULL && self->ova_compressed)
+		stream_reader_start_readahead (reader);
+	else if (ova_source_is_seekable (self))
+		archive_read_set_seek_callback (a, stream_reader_seek_cb);
+	r = archive_read_open1 (a);
+	if (r != ARCHIVE_OK) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot open: %s",
+		             archive_error_string (a));
+		archive_read_free (a);
+		ova_source_end (self);
+		return NULL;
+	}
+
+	return a;
+}
+
+/* ends a pass over the archive, keeping a non-seekable stream open so that
+ * the next pass can pick up from here */
+static void
+ova_close_archive (GovfPackage *self, struct archive *a)
+{
+	if (self->ova_stream != NULL && !ova_source_is_seekable (self)) {
+		g_assert (self->ova_stream_archive == NULL);
+		stream_reader_set_cancellable (self->ova_stream_reader, NULL);
+		self->ova_stream_archive = a;
+		ova_source_end (self);
+		return;
+	}
+
+	archive_read_close (a);
+	archive_read_free (a);
+	ova_source_end (self);
+}
+
+static void
+ova_clear_source (GovfPackage *self)
+{
+	if (self->ova_stream_archive != NULL) {
+		archive_read_close (self->ova_stream_archive);
+		archive_read_free (self->ova_stream_archive);
+		self->ova_stream_archive = NULL;
+	}
+	self->ova_stream_reader = NULL;
+	self->ova_stream_consumed = FALSE;
+	self->ova_key_valid = FALSE;
+	self->ova_compressed = FALSE;
+	g_clear_object (&self->ova_stream);
+	g_clear_pointer (&self->ova_stream_name, g_free);
+	g_clear_pointer (&self->ova_filename, g_free);
+	g_clear_pointer (&self->ova_descriptor_name, g_free);
+	g_clear_pointer (&self->ova_descriptor, g_bytes_unref);
+	g_clear_pointer (&self->manifest, g_hash_table_unref);
+}
+
+/* drops what a pass over an .ova file has read from the page cache; the
+ * advice applies to the file, not to the descriptor it is given on */
+static void
+ova_drop_source_cache (GovfPackage *self, struct archive *a)
+{
+#ifdef HAVE_POSIX_FADVISE
+	gint fd;
+
+	if (self->ova_filename == NULL ||
+	    self->extract_options == NULL ||
+	    (govf_extract_options_get_flags (self->extract_options) & GOVF_IO_FLAGS_DROP_CACHE) == 0)
+		return;
+
+	fd = g_open (self->ova_filename, O_RDONLY, 0);
+	if (fd == -1)
+		return;
+	posix_fadvise (fd, 0, archive_filter_bytes (a, -1), POSIX_FADV_DONTNEED);
+	close (fd);
+#endif
+}
+
+/* a block of member data, or a hole, on its way to the writer thread; a
+ * block with neither marks the end */
+typedef struct
+{
+	GBytes			 *bytes;
+	gint64			  hole;
+} GovfWriteBlock;
+
+/* writes out member data on a thread of its own, so that inflating a
+ * compressed archive doesn't have to wait for the disk */
+typedef struct
+{
+	GovfCopyContext		 *ctx;
+	gint			  out_fd;
+	GovfChannel		 *channel;
+	GThread			 *thread;
+	GError			 *error;
+} GovfWriter;
+
+static void
+write_block_free (GovfWriteBlock *block)
+{
+	if (block->bytes != NULL)
+		g_bytes_unref (block->bytes);
+	g_slice_free (GovfWriteBlock, block);
+}
+
+static gpointer
+writer_thread_func (gpointer data)
+{
+	GovfWriter *writer = data;
+	GovfCopyContext *ctx = writer->ctx;
+
+	for (;;) {
+		GovfWriteBlock *block = govf_channel_pop (writer->channel);
+		gboolean done = block->bytes == NULL && block->hole == 0;
+		gboolean ret = TRUE;
+		gsize size = 0;
+
+		if (block->hole > 0) {
+			ret = copy_context_hole (ctx, writer->out_fd, block->hole, &writer->error);
+		} else if (block->bytes != NULL) {
+			const gchar *buf = g_bytes_get_data (block->bytes, &size);
+
+			ret = copy_context_write (ctx, writer->out_fd, buf, size, &writer->error);
+			if (ret)
+				copy_context_progress (ctx, size);
+		}
+		govf_channel_release (writer->channel, size);
+		write_block_free (block);
+
+		if (!ret) {
+			govf_channel_close (writer->channel);
+			break;
+		}
+		if (done)
+			break;
+	}
+
+	return NULL;
+}
+
+static GovfWriter *
+writer_new (GovfCopyContext *ctx, gint out_fd)
+{
+	GovfWriter *writer;
+
+	writer = g_slice_new0 (GovfWriter);
+	writer->ctx = ctx;
+	writer->out_fd = out_fd;
+	writer->channel = govf_channel_new ((GDestroyNotify) write_block_free);
+	writer->thread = g_thread_new ("govf-writer", writer_thread_func, writer);
+
+	return writer;
+}
+
+/* waits for everything queued to be written out */
+static gboolean
+writer_finish (GovfWriter *writer, GError **error)
+{
+	if (writer->thread != NULL) {
+		GovfWriteBlock *end = g_slice_new0 (GovfWriteBlock);
+
+		if (!govf_channel_push (writer->channel, end, 0))
+			write_block_free (end);
+		g_thread_join (writer->thread);
+		writer->thread = NULL;
+	}
+
+	if (writer->error != NULL) {
+		g_propagate_error (error, g_steal_pointer (&writer->error));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+writer_free (GovfWriter *writer)
+{
+	writer_finish (writer, NULL);
+	govf_channel_free (writer->channel);
+	g_slice_free (GovfWriter, writer);
+}
+
+/* hands data or a hole to the writer thread if there is one, or writes it
+ * out right away */
+static gboolean
+ova_write_out (GovfCopyContext  *ctx,
+               GovfWriter       *writer,
+               gint              out_fd,
+               const gchar      *buf,
+               gsize             size,
+               gint64            hole,
+               GError          **error)
+{
+	GovfWriteBlock *block;
+
+	if (writer == NULL) {
+		if (hole > 0)
+			return copy_context_hole (ctx, out_fd, hole, error);
+		if (!copy_context_write (ctx, out_fd, buf, size, error))
+			return FALSE;
+		copy_context_progress (ctx, size);
+		return TRUE;
+	}
+
+	block = g_slice_new0 (GovfWriteBlock);
+	block->hole = hole;
+	if (hole == 0)
+		block->bytes = g_bytes_new (buf, size);
+	if (govf_channel_push (writer->channel, block, size))
+		return TRUE;
+
+	/* the writer stopped on an error */
+	write_block_free (block);
+	return writer_finish (writer, error);
+}
+
+/* like archive_read_data_into_fd(), but cancellable and reporting progress */
+static gboolean
+ova_read_data_into_fd (struct archive        *a,
+                       struct archive_entry  *entry,
+                       gint                   out_fd,
+                       GovfCopyContext       *ctx,
+                       GError               **error)
+{
+	GovfWriter *writer = NULL;
+	gboolean ret = TRUE;
+	gint64 position = 0;
+	int r;
+
+	ctx->total = archive_entry_size (entry);
+	if (ctx->convert_raw) {
+		GovfMemberReader reader = { ctx, a, NULL, -1, 0, 0 };
+		return copy_context_convert (ctx, &reader, out_fd, error);
+	}
+	copy_context_preallocate (ctx, out_fd, archive_entry_size (entry));
+
+	/* inflating is what holds up a compressed archive */
+	if (archive_filter_code (a, 0) != ARCHIVE_FILTER_NONE)
+		writer = writer_new (ctx, out_fd);
+
+	for (;;) {
+		const void *buf;
+		size_t size;
+		la_int64_t offset;
+
+		if (g_cancellable_set_error_if_cancelled (ctx->cancellable, error)) {
+			ret = FALSE;
+			goto out;
+		}
+
+		r = archive_read_data_block (a, &buf, &size, &offset);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			/* a cancelled read shows up as a failed one */
+			if (!g_cancellable_set_error_if_cancelled (ctx->cancellable, error))
+				g_set_error (error,
+				             GOVF_PACKAGE_ERROR,
+				             GOVF_PACKAGE_ERROR_FAILED,
+				             "Cannot extract: %s",
+				             archive_error_string (a));
+			ret = FALSE;
+			goto out;
+		}
+
+		/* skip over holes in sparse members */
+		if (offset != position) {
+			if (!ova_write_out (ctx, writer, out_fd, NULL, 0, offset - position, error)) {
+				ret = FALSE;
+				goto out;
+			}
+			position = offset;
+		}
+		if (size > 0 &&
+		    !ova_write_out (ctx, writer, out_fd, buf, size, 0, error)) {
+			ret = FALSE;
+			goto out;
+		}
+		position += size;
+	}
+
+	/* a trailing hole in a sparse member is never handed out; extend the
+	 * file up to its full size in copy_context_finish() */
+	if (position < archive_entry_size (entry) &&
+	    !ova_write_out (ctx, writer, out_fd, NULL, 0, archive_entry_size (entry) - position, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+out:
+	if (writer != NULL) {
+		if (!writer_finish (writer, ret ? error : NULL))
+			ret = FALSE;
+		writer_free (writer);
+	}
+	return ret;
+}
+
+static gboolean
+ova_extract_file_to_fd (GovfPackage      *self,
+                        const gchar      *extract_filename,
+                        gint              out_fd,
+                        GovfCopyContext  *ctx,
+                        GError          **error)
+{
+	gboolean found;
+	gboolean ret = TRUE;
+	int r;
+	struct archive *a = NULL;
+
+	/* open the .ova archive */
+	a = ova_open_archive (self, NULL, ctx->cancellable, error);
+	if (a == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+
+	/* find first matching file and extract it */
+	found = FALSE;
+	for (;;) {
+		const gchar *name;
+		struct archive_entry *entry;
+
+		if (g_cancellable_set_error_if_cancelled (ctx->cancellable, error)) {
+			ret = FALSE;
+			goto out;
+		}
+
+		r = archive_read_next_header (a, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot read header: %s",
+			             archive_error_string (a));
+			ret = FALSE;
+			goto out;
+		}
+		stats_add (self, GOVF_PACKAGE_STAT_HEADERS_SCANNED, 1);
+
+		/* did we find a match? */
+		name = archive_entry_pathname (entry);
+		if (name != NULL && endswith (name, extract_filename)) {
+			if (!ova_read_data_into_fd (a, entry, out_fd, ctx, error)) {
+				ret = FALSE;
+				goto out;
+			}
+			found = TRUE;
+			break;
+		}
+	}
+
+	if (!found) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_NOT_FOUND,
+		             "Could not find any %s files",
+		             extract_filename);
+		ret = FALSE;
+	}
+
+out:
+	if (a != NULL) {
+		ova_drop_source_cache (self, a);
+		ova_close_archive (self, a);
+	}
+	return ret;
+}
+
+static gint
+open_for_writing (const gchar  *save_path,
+                  gboolean     *created,
+                  GError      **error)
+{
+	gint fd;
+
+	/* only a file created here may be removed again on failure; an
+	 * existing one may be the user's, or a block device */
+	fd = g_open (save_path, O_WRONLY | O_CREAT | O_EXCL, 0666);
+	*created = fd != -1;
+	if (fd == -1 && errno == EEXIST)
+		fd = g_open (save_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd == -1) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Failed to open file for writing: %s",
+		             save_path);
+	}
+
+	return fd;
+}
+
+/* opens the output for an extraction, applying the package's extract
+ * options; direct I/O is skipped for VMDK conversion, which writes grains
+ * out of order from its own buffers */
+static gint
+copy_context_open (GovfCopyContext  *ctx,
+                   GovfPackage      *self,
+                   const gchar      *save_path,
+                   GError          **error)
+{
+	gint fd = -1;
+
+	if (self->extract_options != NULL) {
+		ctx->block_size = govf_extract_options_get_block_size (self->extract_options);
+		ctx->io_flags = govf_extract_options_get_flags (self->extract_options);
+		ctx->convert_threads = govf_extract_options_get_convert_threads (self->extract_options);
+	}
+
+	fd = open_for_writing (save_path, &ctx->created, error);
+	if (fd == -1)
+		return -1;
+
+#ifdef O_DIRECT
+	/* set once the file is open, so that a filesystem without direct I/O
+	 * falls back to buffered I/O on the same file */
+	if ((ctx->io_flags & GOVF_IO_FLAGS_DIRECT) != 0 && !ctx->convert_raw) {
+		gint flags = fcntl (fd, F_GETFL);
+
+		if (flags != -1 && fcntl (fd, F_SETFL, flags | O_DIRECT) == 0) {
+			gsize size = GOVF_ROUND_UP (copy_context_block_size (ctx), COPY_BUFFER_ALIGNMENT);
+			ctx->direct_buf = copy_buffer_new (size);
+		}
+	}
+#endif
+
+	copy_context_prepare (ctx, fd);
+	return fd;
+}
+
+/* whether the member's bytes are stored verbatim at its recorded offset */
+static gboolean
+ova_member_is_verbatim (GovfPackage *self, GovfOvaMember *member)
+{
+	return member != NULL &&
+	       self->ova_uncompressed_tar &&
+	       ova_source_is_seekable (self) &&
+	       member->filetype == AE_IFREG &&
+	       !member->sparse;
+}
+
+static gboolean
+ova_extract_file_to_path (GovfPackage      *self,
+                          const gchar      *extract_filename,
+                          const gchar      *save_path,
+                          GovfCopyContext  *ctx,
+                          GError          **error)
+{
+	GovfOvaMember *member;
+	gboolean ret = TRUE;
+	gint fd = -1;
+	gint64 begin = g_get_monotonic_time ();
+
+	GOVF_PROBE2 (extract__start, extract_filename, save_path);
+
+	/* before opening, so that a missing digest leaves the target alone */
+	if (!copy_context_start_verify (ctx, self, extract_filename, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	fd = copy_context_open (ctx, self, save_path, error);
+	if (fd == -1) {
+		ret = FALSE;
+		goto out;
+	}
+
+	/* seek straight to the member if its bytes are stored verbatim */
+	member = ova_find_member (self, extract_filename);
+	stats_add (self, GOVF_PACKAGE_STAT_MEMBERS_VISITED, 1);
+	if (ret && ova_member_is_verbatim (self, member)) {
+		/* reflinked and in-kernel copies are only counted as written */
+		ret = ova_copy_member_to_fd (self, member, fd, ctx, error);
+		stats_add (self, GOVF_PACKAGE_STAT_BYTES_READ, ctx->bytes_read);
+	} else if (ret) {
+		ret = ova_extract_file_to_fd (self, extract_filename, fd, ctx, error);
+	}
+	if (ret)
+		ret = copy_context_finish (ctx, fd, error);
+	if (ret)
+		ret = copy_context_finish_verify (ctx, extract_filename, error);
+	if (!ret) {
+		g_prefix_error (error,
+		                "Failed to extract %s from %s: ",
+		                extract_filename,
+		                ova_source_name (self));
+		goto out;
+	}
+
+out:
+	copy_context_clear (ctx);
+	if (fd != -1) {
+		close (fd);
+		/* don't leave a partially extracted disk behind */
+		if (!ret && ctx->created)
+			g_unlink (save_path);
+	}
+
+	stats_add (self, GOVF_PACKAGE_STAT_BYTES_WRITTEN, ctx->bytes_written);
+	stats_add_time (self, GOVF_PACKAGE_STAT_EXTRACT_USEC, begin);
+	govf_trace_mark (begin, "extract", extract_filename);
+	GOVF_PROBE2 (extract__done, extract_filename, ctx->bytes_written);
+
+	return ret;
+}
+
+static gboolean
+ova_extract_entry_to_path (GovfPackage           *self,
+                           struct archive        *a,
+                           struct archive_entry  *entry,
+                           const gchar           *filename,
+                           const gchar           *save_path,
+                           GovfCopyContext       *ctx,
+                           GError               **error)
+{
+	gboolean ret = TRUE;
+	gint fd = -1;
+	gint64 begin = g_get_monotonic_time ();
+
+	GOVF_PROBE2 (extract__start, filename, save_path);
+	stats_add (self, GOVF_PACKAGE_STAT_MEMBERS_VISITED, 1);
+
+	if (!copy_context_start_verify (ctx, self, filename, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	fd = copy_context_open (ctx, self, save_path, error);
+	if (fd == -1) {
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!ova_read_data_into_fd (a, entry, fd, ctx, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!copy_context_finish (ctx, fd, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!copy_context_finish_verify (ctx, filename, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+out:
+	copy_context_clear (ctx);
+	if (fd != -1) {
+		close (fd);
+		if (!ret && ctx->created)
+			g_unlink (save_path);
+	}
+
+	stats_add (self, GOVF_PACKAGE_STAT_BYTES_WRITTEN, ctx->bytes_written);
+	stats_add_time (self, GOVF_PACKAGE_STAT_EXTRACT_USEC, begin);
+	govf_trace_mark (begin, "extract", filename);
+	GOVF_PROBE2 (extract__done, filename, ctx->bytes_written);
+
+	return ret;
+}
+
+/* reads the current member into memory, refusing anything too large to be
+ * a sensible descriptor or manifest */
+static GByteArray *
+ova_read_member (struct archive        *a,
+                 struct archive_entry  *entry,
+                 GError               **error)
+{
+	g_autoptr(GByteArray) buf = NULL;
+	gint64 reserve = 0;
+
+	if (archive_entry_size_is_set (entry))
+		reserve = archive_entry_size (entry);
+	if (reserve > DESCRIPTOR_MAX_SIZE) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Member %s is too large",
+		             archive_entry_pathname (entry));
+		return NULL;
+	}
+
+	buf = g_byte_array_sized_new (reserve);
+	while (reserve == 0 || buf->len < reserve) {
+		gsize len = buf->len;
+		gsize want = reserve > 0 ? reserve - len : DESCRIPTOR_READ_CHUNK_SIZE;
+		la_ssize_t n;
+
+		g_byte_array_set_size (buf, len + want);
+		n = archive_read_data (a, buf->data + len, want);
+		if (n < 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot extract: %s",
+			             archive_error_string (a));
+			return NULL;
+		}
+		g_byte_array_set_size (buf, len + n);
+		if (n == 0)
+			break;
+		if (buf->len > DESCRIPTOR_MAX_SIZE) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Member %s is too large",
+			             archive_entry_pathname (entry));
+			return NULL;
+		}
+	}
+
+	return g_steal_pointer (&buf);
+}
+
+static gboolean
+ova_read_manifest (GovfPackage           *self,
+                   struct archive        *a,
+                   struct archive_entry  *entry,
+                   GError               **error)
+{
+	g_autoptr(GByteArray) buf = NULL;
+
+	buf = ova_read_member (a, entry, error);
+	if (buf == NULL)
+		return FALSE;
+	stats_add (self, GOVF_PACKAGE_STAT_MEMBERS_VISITED, 1);
+
+	g_clear_pointer (&self->manifest, g_hash_table_unref);
+	self->manifest = manifest_parse ((const gchar *) buf->data, buf->len);
+
+	return TRUE;
+}
+
+/* extracts several members in one forward pass over the archive, so that
+ * a compressed or non-seekable archive is only read once; the outcome for
+ * each member is recorded in its extraction */
+static gboolean
+ova_extract_files_single_pass (GovfPackage  *self,
+                               GPtrArray    *extractions,
+                               GPtrArray    *filenames,
+                               GError      **error)
+{
+	g_autofree gboolean *done = NULL;
+	g_autoptr(GError) error_archive = NULL;
+	guint remaining = extractions->len;
+	guint i;
+	int r;
+	struct archive *a = NULL;
+
+	done = g_new0 (gboolean, extractions->len);
+
+	/* open the .ova archive */
+	a = ova_open_archive (self, NULL, NULL, &error_archive);
+	if (a == NULL)
+		goto out;
+
+	while (remaining > 0) {
+		const gchar *name;
+		struct archive_entry *entry;
+
+		r = archive_read_next_header (a, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (&error_archive,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot read header: %s",
+			             archive_error_string (a));
+			goto out;
+		}
+		stats_add (self, GOVF_PACKAGE_STAT_HEADERS_SCANNED, 1);
+
+		name = archive_entry_pathname (entry);
+		if (name == NULL)
+			continue;
+
+		/* a non-seekable archive is only indexed up to the descriptor,
+		 * and the manifest follows right after it */
+		if (self->manifest == NULL && endswith (name, ".mf")) {
+			if (!ova_read_manifest (self, a, entry, &error_archive))
+				goto out;
+			continue;
+		}
+
+		for (i = 0; i < extractions->len; i++) {
+			GovfExtraction *extraction = g_ptr_array_index (extractions, i);
+			const gchar *filename = g_ptr_array_index (filenames, i);
+			g_autoptr(GError) error_local = NULL;
+			GovfCopyContext ctx = { NULL, };
+
+			if (done[i] || !endswith (name, filename))
+				continue;
+
+			copy_context_init_for_extraction (&ctx, extraction);
+			if (!ova_extract_entry_to_path (self,
+			                                a,
+			                                entry,
+			                                filename,
+			                                govf_extraction_get_save_path (extraction),
+			                                &ctx,
+			                                &error_local)) {
+				g_prefix_error (&error_local,
+				                "Failed to extract %s from %s: ",
+				                filename,
+				                ova_source_name (self));
+				govf_extraction_set_error (extraction, error_local);
+			}
+			copy_context_update_extraction (&ctx, extraction);
+			done[i] = TRUE;
+			remaining--;
+			break;
+		}
+	}
+
+out:
+	for (i = 0; i < extractions->len; i++) {
+		GovfExtraction *extraction = g_ptr_array_index (extractions, i);
+		g_autoptr(GError) error_local = NULL;
+
+		if (done[i])
+			continue;
+
+		if (error_archive != NULL) {
+			govf_extraction_set_error (extraction, error_archive);
+			continue;
+		}
+
+		g_set_error (&error_local,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_NOT_FOUND,
+		             "Could not find any %s files",
+		             (const gchar *) g_ptr_array_index (filenames, i));
+		govf_extraction_set_error (extraction, error_local);
+	}
+	if (a != NULL) {
+		ova_drop_source_cache (self, a);
+		ova_close_archive (self, a);
+	}
+	if (error_archive != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_archive));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* walks the archive headers once, recording where every member lives, and
+ * reads the first .ovf descriptor into memory on the way */
+static gboolean
+ova_read_index (GovfPackage    *self,
+                GByteArray    **descriptor,
+                GCancellable   *cancellable,
+                GError        **error)
+{
+	gboolean found = FALSE;
+	gboolean ret = TRUE;
+	guint members_after_descriptor = 0;
+	int r;
+	struct archive *a = NULL;
+
+	g_clear_pointer (&self->ova_members, g_ptr_array_unref);
+	self->ova_members = g_ptr_array_new_with_free_func ((GDestroyNotify) govf_ova_member_free);
+	self->ova_uncompressed_tar = FALSE;
+	self->ova_compressed = FALSE;
+	g_clear_pointer (&self->ova_descriptor_name, g_free);
+	g_clear_pointer (&self->manifest, g_hash_table_unref);
+	self->bytes_read = 0;
+
+	/* open the .ova archive */
+	a = ova_open_archive (self, &self->bytes_read, cancellable, error);
+	if (a == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+
+	for (;;) {
+		GovfOvaMember *member;
+		const gchar *name;
+		struct archive_entry *entry;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			ret = FALSE;
+			goto out;
+		}
+
+		r = archive_read_next_header (a, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot read header: %s",
+			             archive_error_string (a));
+			ret = FALSE;
+			goto out;
+		}
+		stats_add (self, GOVF_PACKAGE_STAT_HEADERS_SCANNED, 1);
+
+		/* only members of a plain tar file can be seeked to later on */
+		self->ova_uncompressed_tar =
+			archive_filter_code (a, 0) == ARCHIVE_FILTER_NONE &&
+			(archive_format (a) & ARCHIVE_FORMAT_BASE_MASK) == ARCHIVE_FORMAT_TAR;
+		self->ova_compressed = archive_filter_code (a, 0) != ARCHIVE_FILTER_NONE;
+
+		name = archive_entry_pathname (entry);
+		if (name == NULL)
+			continue;
+
+		member = g_slice_new0 (GovfOvaMember);
+		member->name = g_strdup (name);
+		member->header_offset = archive_read_header_position (a);
+		member->data_offset = archive_filter_bytes (a, 0);
+		member->size = archive_entry_size (entry);
+		member->filetype = archive_entry_filetype (entry);
+		member->sparse = archive_entry_sparse_count (entry) > 0;
+		g_ptr_array_add (self->ova_members, member);
+
+		/* without a way to seek, stepping over the data of a member
+		 * in front of the descriptor means reading it */
+		if (!found &&
+		    (self->load_flags & GOVF_LOAD_FLAGS_METADATA_ONLY) != 0 &&
+		    !endswith (name, ".ovf") &&
+		    !endswith (name, ".mf") &&
+		    archive_entry_size (entry) > 0 &&
+		    !(self->ova_uncompressed_tar && ova_source_is_seekable (self))) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot step over %s without reading it",
+			             name);
+			ret = FALSE;
+			goto out;
+		}
+
+		if (!found && endswith (name, ".ovf")) {
+			*descriptor = ova_read_member (a, entry, error);
+			if (*descriptor == NULL) {
+				ret = FALSE;
+				goto out;
+			}
+			stats_add (self, GOVF_PACKAGE_STAT_MEMBERS_VISITED, 1);
+			self->ova_descriptor_name = g_strdup (name);
+			found = TRUE;
+		} else if (self->manifest == NULL && endswith (name, ".mf")) {
+			if (!ova_read_manifest (self, a, entry, error)) {
+				ret = FALSE;
+				goto out;
+			}
+		}
+
+		/* stepping over members of a compressed archive means
+		 * decompressing them, and a non-seekable stream would have to
+		 * be read all the way through, so stop once we have the
+		 * descriptor; the manifest usually comes right after it, and
+		 * can be peeked at as long as the archive can be reopened */
+		if (found && (!self->ova_uncompressed_tar || !ova_source_is_seekable (self))) {
+			if (!ova_source_is_seekable (self) ||
+			    self->manifest != NULL ||
+			    members_after_descriptor++ > 0)
+				break;
+		}
+	}
+
+	if (!found) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_NOT_FOUND,
+		             "Could not find any .ovf files");
+		ret = FALSE;
+	}
+
+out:
+	if (a != NULL)
+		ova_close_archive (self, a);
+	return ret;
+}
+
+static void
+clear_model (GovfPackage *self)
+{
+	g_clear_pointer (&self->ctx, xmlXPathFreeContext);
+	g_clear_pointer (&self->doc, xmlFreeDoc);
+	g_clear_pointer (&self->descriptor, g_bytes_unref);
+	g_clear_pointer (&self->files, g_ptr_array_unref);
+	g_clear_pointer (&self->files_by_id, g_hash_table_unref);
+	g_clear_pointer (&self->disks, g_ptr_array_unref);
+	g_clear_pointer (&self->disks_by_id, g_hash_table_unref);
+	g_clear_pointer (&self->name, g_free);
+	g_clear_pointer (&self->description, g_free);
+	self->os_id = NULL;
+}
+
+/* like an XPath lookup, the first File or Disk with a given id wins */
+static void
+build_indexes (GovfPackage *self)
+{
+	guint i;
+
+	self->files_by_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	for (i = 0; self->files != NULL && i < self->files->len; i++) {
+		GovfFile *file = g_ptr_array_index (self->files, i);
+		const gchar *id = govf_file_get_id (file);
+
+		if (id != NULL && !g_hash_table_contains (self->files_by_id, id))
+			g_hash_table_insert (self->files_by_id, g_strdup (id), g_object_ref (file));
+	}
+
+	self->disks_by_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	for (i = 0; self->disks != NULL && i < self->disks->len; i++) {
+		GovfDisk *disk = g_ptr_array_index (self->disks, i);
+		const gchar *id = govf_disk_get_disk_id (disk);
+
+		if (id != NULL && !g_hash_table_contains (self->disks_by_id, id))
+			g_hash_table_insert (self->disks_by_id, g_strdup (id), g_object_ref (disk));
+	}
+}
+
+/* what a scan of an .ova file and a parse of its descriptor leave
+ * behind: the descriptor checksum, the member index, the descriptor and
+ * manifest, and the model picked out of the descriptor */
+#define CACHE_ENTRY_TYPE "(sa(sxxxub)bbsayma{s(us)}msmsmsa(msmsmsmsms)a(msmsmsms))"
+
+static GVariant *
+cache_entry_new (GovfPackage *self)
+{
+	GVariantBuilder disks;
+	GVariantBuilder files;
+	GVariantBuilder members;
+	GVariant *manifest = NULL;
+	g_autofree gchar *checksum = NULL;
+	guint i;
+
+	g_variant_builder_init (&members, G_VARIANT_TYPE ("a(sxxxub)"));
+	for (i = 0; i < self->ova_members->len; i++) {
+		GovfOvaMember *member = g_ptr_array_index (self->ova_members, i);
+
+		g_variant_builder_add (&members, "(sxxxub)",
+		                       member->name,
+		                       member->header_offset,
+		                       member->data_offset,
+		                       member->size,
+		                       (guint32) member->filetype,
+		                       member->sparse);
+	}
+
+	if (self->manifest != NULL) {
+		GVariantBuilder entries;
+		GHashTableIter iter;
+		gpointer key;
+		gpointer value;
+
+		g_variant_builder_init (&entries, G_VARIANT_TYPE ("a{s(us)}"));
+		g_hash_table_iter_init (&iter, self->manifest);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			GovfManifestEntry *entry = value;
+
+			g_variant_builder_add (&entries, "{s(us)}",
+			                       key,
+			                       (guint32) entry->type,
+			                       entry->digest);
+		}
+		manifest = g_variant_builder_end (&entries);
+	}
+
+	g_variant_builder_init (&files, G_VARIANT_TYPE ("a(msmsmsmsms)"));
+	for (i = 0; self->files != NULL && i < self->files->len; i++) {
+		GovfFile *file = g_ptr_array_index (self->files, i);
+
+		g_variant_builder_add (&files, "(msmsmsmsms)",
+		                       govf_file_get_id (file),
+		                       govf_file_get_href (file),
+		                       govf_file_get_size (file),
+		                       govf_file_get_compression (file),
+		                       govf_file_get_chunk_size (file));
+	}
+
+	g_variant_builder_init (&disks, G_VARIANT_TYPE ("a(msmsmsms)"));
+	for (i = 0; self->disks != NULL && i < self->disks->len; i++) {
+		GovfDisk *disk = g_ptr_array_index (self->disks, i);
+
+		g_variant_builder_add (&disks, "(msmsmsms)",
+		                       govf_disk_get_capacity (disk),
+		                       govf_disk_get_disk_id (disk),
+		                       govf_disk_get_file_ref (disk),
+		                       govf_disk_get_format (disk));
+	}
+
+	checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, self->ova_descriptor);
+	return g_variant_new ("(s@a(sxxxub)bbs@aym@a{s(us)}msmsms@a(msmsmsmsms)@a(msmsmsms))",
+	                      checksum,
+	                      g_variant_builder_end (&members),
+	                      self->ova_uncompressed_tar,
+	                      self->ova_compressed,
+	                      self->ova_descriptor_name,
+	                      g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING,
+	                                                self->ova_descriptor,
+	                                                TRUE),
+	                      manifest,
+	                      self->name,
+	                      self->description,
+	                      self->os_id,
+	                      g_variant_builder_end (&files),
+	                      g_variant_builder_end (&disks));
+}
+
+/* reads the descriptor back from where the index says it is stored, to
+ * catch a file rewritten within the granularity of its mtime */
+static gboolean
+cache_check_descriptor (GovfPackage *self,
+                        GPtrArray   *members,
+                        const gchar *descriptor_name,
+                        const gchar *checksum)
+{
+	GovfOvaMember *member = NULL;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *digest = NULL;
+	gint fd;
+	gint64 done = 0;
+	guint i;
+
+	for (i = 0; i < members->len && member == NULL; i++) {
+		GovfOvaMember *m = g_ptr_array_index (members, i);
+
+		if (g_strcmp0 (m->name, descriptor_name) == 0)
+			member = m;
+	}
+	if (member == NULL || member->size < 0 || member->size > DESCRIPTOR_MAX_SIZE)
+		return FALSE;
+
+	fd = g_open (self->ova_filename, O_RDONLY, 0);
+	if (fd < 0)
+		return FALSE;
+
+	buf = g_malloc (member->size);
+	while (done < member->size) {
+		gssize n;
+
+		n = pread (fd, buf + done, member->size - done, member->data_offset + done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		done += n;
+	}
+	close (fd);
+	if (done != member->size)
+		return FALSE;
+
+	stats_add (self, GOVF_PACKAGE_STAT_BYTES_READ, done);
+	digest = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) buf, done);
+	return g_strcmp0 (digest, checksum) == 0;
+}
+
+/* fills in the package from a cache entry, with the descriptor left in
+ * the mapped entry; the document tree is only built if it is needed */
+static gboolean
+load_from_cache (GovfPackage        *self,
+                 const GovfCacheKey *key)
+{
+	const gchar *checksum;
+	const gchar *descriptor_name;
+	const gchar *description;
+	const gchar *name;
+	const gchar *os_id;
+	g_autofree gchar *digest = NULL;
+	g_autoptr(GBytes) descriptor = NULL;
+	g_autoptr(GHashTable) manifest = NULL;
+	g_autoptr(GPtrArray) members = NULL;
+	g_autoptr(GVariant) descriptor_variant = NULL;
+	g_autoptr(GVariant) entry = NULL;
+	g_autoptr(GVariant) manifest_variant = NULL;
+	g_autoptr(GVariantIter) disks_iter = NULL;
+	g_autoptr(GVariantIter) files_iter = NULL;
+	g_autoptr(GVariantIter) members_iter = NULL;
+	gboolean compressed;
+	gboolean uncompressed_tar;
+	gint64 begin = g_get_monotonic_time ();
+
+	entry = govf_cache_lookup (self->cache_dir, key, G_VARIANT_TYPE (CACHE_ENTRY_TYPE));
+	if (entry == NULL)
+		return FALSE;
+
+	g_variant_get (entry,
+	               "(&sa(sxxxub)bb&s@aym@a{s(us)}m&sm&sm&sa(msmsmsmsms)a(msmsmsms))",
+	               &checksum,
+	               &members_iter,
+	               &uncompressed_tar,
+	               &compressed,
+	               &descriptor_name,
+	               &descriptor_variant,
+	               &manifest_variant,
+	               &name,
+	               &description,
+	               &os_id,
+	               &files_iter,
+	               &disks_iter);
+
+	/* the descriptor stays in the mapping */
+	descriptor = g_variant_get_data_as_bytes (descriptor_variant);
+	digest = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, descriptor);
+	if (g_strcmp0 (digest, checksum) != 0) {
+		g_debug ("Ignoring corrupt cache entry for %s", self->ova_filename);
+		return FALSE;
+	}
+
+	members = g_ptr_array_new_with_free_func ((GDestroyNotify) govf_ova_member_free);
+	for (;;) {
+		GovfOvaMember *member;
+		const gchar *member_name;
+		gint64 header_offset;
+		gint64 data_offset;
+		gint64 size;
+		guint32 filetype;
+		gboolean sparse;
+
+		if (!g_variant_iter_next (members_iter, "(&sxxxub)",
+		                          &member_name,
+		                          &header_offset,
+		                          &data_offset,
+		                          &size,
+		                          &filetype,
+		                          &sparse))
+			break;
+
+		member = g_slice_new0 (GovfOvaMember);
+		member->name = g_strdup (member_name);
+		member->header_offset = header_offset;
+		member->data_offset = data_offset;
+		member->size = size;
+		member->filetype = filetype;
+		member->sparse = sparse;
+		g_ptr_array_add (members, member);
+	}
+
+	/* the data of a compressed archive can't be read back cheaply, so
+	 * the stat key alone has to do for those */
+	if (uncompressed_tar &&
+	    !cache_check_descriptor (self, members, descriptor_name, checksum)) {
+		g_debug ("Ignoring cache entry for %s, its descriptor changed", self->ova_filename);
+		return FALSE;
+	}
+
+	if (manifest_variant != NULL) {
+		GVariantIter iter;
+		const gchar *member_name;
+		const gchar *digest_str;
+		guint32 type;
+
+		manifest = g_hash_table_new_full (g_str_hash,
+		                                  g_str_equal,
+		                                  g_free,
+		                                  (GDestroyNotify) govf_manifest_entry_free);
+		g_variant_iter_init (&iter, manifest_variant);
+		while (g_variant_iter_next (&iter, "{&s(u&s)}", &member_name, &type, &digest_str)) {
+			GovfManifestEntry *manifest_entry;
+
+			manifest_entry = g_slice_new (GovfManifestEntry);
+			manifest_entry->type = type;
+			manifest_entry->digest = g_strdup (digest_str);
+			g_hash_table_insert (manifest, g_strdup (member_name), manifest_entry);
+		}
+	}
+
+	g_clear_pointer (&self->ova_members, g_ptr_array_unref);
+	self->ova_members = g_steal_pointer (&members);
+	self->ova_uncompressed_tar = uncompressed_tar;
+	self->ova_compressed = compressed;
+	g_clear_pointer (&self->ova_descriptor_name, g_free);
+	self->ova_descriptor_name = g_strdup (descriptor_name);
+	g_clear_pointer (&self->ova_descriptor, g_bytes_unref);
+	self->ova_descriptor = g_steal_pointer (&descriptor);
+	g_clear_pointer (&self->manifest, g_hash_table_unref);
+	self->manifest = g_steal_pointer (&manifest);
+	self->bytes_read = 0;
+
+	clear_model (self);
+	self->descriptor = g_bytes_ref (self->ova_descriptor);
+	self->name = g_strdup (name);
+	self->description = g_strdup (description);
+	self->os_id = g_intern_string (os_id);
+
+	self->files = g_ptr_array_new_with_free_func (g_object_unref);
+	for (;;) {
+		GovfFile *file;
+		const gchar *id;
+		const gchar *href;
+		const gchar *size;
+		const gchar *compression;
+		const gchar *chunk_size;
+
+		if (!g_variant_iter_next (files_iter, "(m&sm&sm&sm&sm&s)",
+		                          &id, &href, &size, &compression, &chunk_size))
+			break;
+
+		file = govf_file_new ();
+		govf_file_set_id (file, id);
+		govf_file_set_href (file, href);
+		govf_file_set_size (file, size);
+		govf_file_set_compression (file, compression);
+		govf_file_set_chunk_size (file, chunk_size);
+		g_ptr_array_add (self->files, file);
+	}
+	if (self->files->len == 0)
+		g_clear_pointer (&self->files, g_ptr_array_unref);
+
+	self->disks = g_ptr_array_new_with_free_func (g_object_unref);
+	for (;;) {
+		GovfDisk *disk;
+		const gchar *capacity;
+		const gchar *disk_id;
+		const gchar *file_ref;
+		const gchar *format;
+
+		if (!g_variant_iter_next (disks_iter, "(m&sm&sm&sm&s)",
+		                          &capacity, &disk_id, &file_ref, &format))
+			break;
+
+		disk = govf_disk_new ();
+		govf_disk_set_capacity (disk, capacity);
+		govf_disk_set_disk_id (disk, disk_id);
+		govf_disk_set_file_ref (disk, file_ref);
+		govf_disk_set_format (disk, format);
+		g_ptr_array_add (self->disks, disk);
+	}
+	if (self->disks->len == 0)
+		g_clear_pointer (&self->disks, g_ptr_array_unref);
+
+	build_indexes (self);
+
+	stats_add (self, GOVF_PACKAGE_STAT_CACHE_HITS, 1);
+	stats_add_time (self, GOVF_PACKAGE_STAT_SCAN_USEC, begin);
+	govf_trace_mark (begin, "cache", self->ova_filename);
+
+	return TRUE;
+}
+
+/* the cache is only an optimization, so failing to update it is not an
+ * error; neither is the file changing while it was being scanned, which
+ * only means the entry would be stale from the start */
+static void
+store_in_cache (GovfPackage        *self,
+                const GovfCacheKey *key)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) entry = NULL;
+	GovfCacheKey now;
+
+	if (!govf_cache_key_init (&now, self->ova_filename) ||
+	    !govf_cache_key_equal (key, &now))
+		return;
+
+	entry = g_variant_ref_sink (cache_entry_new (self));
+	if (!govf_cache_store (self->cache_dir, key, entry, &error))
+		g_debug ("Cannot cache %s: %s", self->ova_filename, error->message);
+}
+
+static gboolean
+load_from_ova_source (GovfPackage   *self,
+                      GCancellable  *cancellable,
+                      GError       **error)
+{
+	g_autoptr(GByteArray) descriptor = NULL;
+	gboolean ret;
+	gint64 begin = g_get_monotonic_time ();
+
+	/* index the archive and read in the .ovf file */
+	ret = ova_read_index (self, &descriptor, cancellable, error);
+	stats_add_time (self, GOVF_PACKAGE_STAT_SCAN_USEC, begin);
+	govf_trace_mark (begin, "scan", ova_source_name (self));
+	if (!ret)
+		return FALSE;
+
+	/* kept for verifying, as a non-seekable archive can't be reread */
+	g_clear_pointer (&self->ova_descriptor, g_bytes_unref);
+	self->ova_descriptor = g_byte_array_free_to_bytes (g_steal_pointer (&descriptor));
+
+	return govf_package_load_from_data (self,
+	                                    g_bytes_get_data (self->ova_descriptor, NULL),
+	                                    g_bytes_get_size (self->ova_descriptor),
+	                                    error);
+}
+
+static gboolean
+load_from_ova_file (GovfPackage   *self,
+                    const gchar   *filename,
+                    GCancellable  *cancellable,
+                    GError       **error)
+{
+	gboolean cacheable;
+
+	ova_clear_source (self);
+	self->ova_filename = g_strdup (filename);
+
+	/* also kept to check later opens of the file against */
+	self->ova_key_valid = govf_cache_key_init (&self->ova_key, filename);
+	cacheable = self->cache_dir != NULL && self->ova_key_valid;
+	if (cacheable && load_from_cache (self, &self->ova_key))
+		return TRUE;
+
+	if (!load_from_ova_source (self, cancellable, error))
+		return FALSE;
+
+	if (cacheable)
+		store_in_cache (self, &self->ova_key);
+
+	return TRUE;
+}
+
+/**
+ * govf_package_load_from_ova_file:
+ * @self: a #GovfPackage
+ * @filename: an .ova file name
+ * @error: a #GError or %NULL
+ *
+ * Loads an OVF package from a compressed .ova file. The location of every
+ * archive member is recorded so that disks can later be extracted without
+ * rescanning the archive.
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_load_from_ova_file (GovfPackage  *self,
+                                 const gchar  *filename,
+                                 GError      **error)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	return load_from_ova_file (self, filename, NULL, error);
+}
+
+/* @name is what errors call the stream, or %NULL for an anonymous one */
+static gboolean
+load_from_stream (GovfPackage   *self,
+                  GInputStream  *stream,
+                  const gchar   *name,
+                  GCancellable  *cancellable,
+                  GError       **error)
+{
+	ova_clear_source (self);
+	self->ova_stream = g_object_ref (stream);
+	self->ova_stream_name = g_strdup (name);
+
+	return load_from_ova_source (self, cancellable, error);
+}
+
+/**
+ * govf_package_load_from_stream:
+ * @self: a #GovfPackage
+ * @stream: a #GInputStream with the contents of an .ova file
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @error: a #GError or %NULL
+ *
+ * Loads an OVF package from a stream holding a compressed .ova file. The
+ * package keeps a reference to @stream for extracting disks later on.
+ *
+ * If @stream is a #GSeekable that can seek, disks can be extracted in any
+ * order. Otherwise the stream is only read once: loading stops right after
+ * the descriptor, and only disks stored after it can be extracted, in
+ * archive order. govf_package_extract_disks() is the best fit for that.
+ *
+ * As @stream has a single read position, only one operation reads it at a
+ * time: while a disk is extracted or the package verified, another
+ * extraction or verification on the same package fails with
+ * %GOVF_PACKAGE_ERROR_FAILED instead of waiting. Packages loaded from a
+ * file have no such limit.
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_load_from_stream (GovfPackage   *self,
+                               GInputStream  *stream,
+                               GCancellable  *cancellable,
+                               GError       **error)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (G_IS_INPUT_STREAM (stream), FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+
+	return load_from_stream (self, stream, NULL, cancellable, error);
+}
+
+/**
+ * govf_package_load_from_gfile:
+ * @self: a #GovfPackage
+ * @file: a #GFile pointing to a compressed .ova file
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @error: a #GError or %NULL
+ *
+ * Loads an OVF package from a compressed .ova file that may live on any
+ * GIO backed filesystem. See govf_package_load_from_stream().
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_load_from_gfile (GovfPackage   *self,
+                              GFile         *file,
+                              GCancellable  *cancellable,
+                              GError       **error)
+{
+	g_autoptr(GFileInputStream) stream = NULL;
+	g_autofree gchar *name = NULL;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (G_IS_FILE (file), FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+
+	stream = g_file_read (file, cancellable, error);
+	if (stream == NULL)
+		return FALSE;
+
+	name = g_file_get_parse_name (file);
+	return load_from_stream (self,
+	                         G_INPUT_STREAM (stream),
+	                         name,
+	                         cancellable,
+	                         error);
+}
+
+/**
+ * govf_package_load_from_file:
+ * @self: a #GovfPackage
+ * @filename: an .ovf file name
+ * @error: a #GError or %NULL
+ *
+ * Loads an OVF package from an uncompressed .ovf file.
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_load_from_file (GovfPackage  *self,
+                             const gchar  *filename,
+                             GError      **error)
+{
+	g_autofree gchar *data = NULL;
+	gsize length;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (!g_file_get_contents (filename, &data, &length, error))
+		return FALSE;
+
+	return govf_package_load_from_data (self, data, length, error);
+}
+
+static gboolean
+load_doc (GovfPackage  *self,
+          const gchar  *data,
+          gsize         length,
+          GError      **error)
+{
+	gint64 begin = g_get_monotonic_time ();
+
+	self->doc = xmlParseMemory (data, length);
+	stats_add_time (self, GOVF_PACKAGE_STAT_PARSE_USEC, begin);
+	if (self->doc == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not parse XML");
+		return FALSE;
+	}
+
+	self->ctx = xmlXPathNewContext (self->doc);
+	xmlXPathRegisterNs (self->ctx,
+	                    (const xmlChar *) "ovf",
+	                    (const xmlChar *) OVF_NS_ENVELOPE);
+
+	return TRUE;
+}
+
+/* a streaming load only keeps the descriptor around, and builds the
+ * document tree from it the first time it's needed */
+static gboolean
+ensure_doc (GovfPackage *self, GError **error)
+{
+	const gchar *data;
+	gsize length;
+
+	if (self->doc != NULL)
+		return TRUE;
+
+	if (self->descriptor == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "No OVF package loaded");
+		return FALSE;
+	}
+
+	data = g_bytes_get_data (self->descriptor, &length);
+	return load_doc (self, data, length, error);
+}
+
+/* client data for serializing the document straight into a stream */
+typedef struct
+{
+	GOutputStream		 *stream;
+	GCancellable		 *cancellable;
+	GError			 *error;
+} GovfSaveWriter;
+
+static int
+save_writer_write_cb (void        *context,
+                      const char  *buffer,
+                      int          len)
+{
+	GovfSaveWriter *writer = context;
+
+	if (writer->error != NULL)
+		return -1;
+	if (!g_output_stream_write_all (writer->stream,
+	                                buffer,
+	                                len,
+	                                NULL,
+	                                writer->cancellable,
+	                                &writer->error))
+		return -1;
+
+	return len;
+}
+
+static int
+save_writer_close_cb (void *context)
+{
+	return 0;
+}
+
+/**
+ * govf_package_save_to_stream:
+ * @self: a #GovfPackage
+ * @stream: a #GOutputStream to write the .ovf descriptor to
+ * @cancellable: a #GCancellable or %NULL
+ * @error: a #GError or %NULL
+ *
+ * Writes the OVF descriptor of the package to @stream. The descriptor is
+ * serialized a few kilobytes at a time, so that no copy of the whole of
+ * it is made in memory. @stream is left open.
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_save_to_stream (GovfPackage    *self,
+                             GOutputStream  *stream,
+                             GCancellable   *cancellable,
+                             GError        **error)
+{
+	GovfSaveWriter writer = { stream, cancellable, NULL };
+	xmlSaveCtxt *save;
+	int r;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (G_IS_OUTPUT_STREAM (stream), FALSE);
+
+	if (!ensure_doc (self, error))
+		return FALSE;
+
+	save = xmlSaveToIO (save_writer_write_cb,
+	                    save_writer_close_cb,
+	                    &writer,
+	                    NULL,
+	                    0);
+	if (save == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not save XML");
+		return FALSE;
+	}
+	xmlSaveDoc (save, self->doc);
+	r = xmlSaveClose (save);
+
+	if (writer.error != NULL) {
+		g_propagate_error (error, writer.error);
+		return FALSE;
+	}
+	if (r < 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not save XML");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * govf_package_save_file:
+ * @self: a #GovfPackage
+ * @filename: an .ovf file name
+ * @error: a #GError or %NULL
+ *
+ * Saves the OVF package to an uncompressed .ovf file. The file is only
+ * replaced once the whole descriptor has been written out.
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_save_file (GovfPackage  *self,
+                        const gchar  *filename,
+                        GError      **error)
+{
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFileOutputStream) stream = NULL;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (!ensure_doc (self, error))
+		return FALSE;
+
+	file = g_file_new_for_path (filename);
+	stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (stream == NULL)
+		return FALSE;
+
+	if (!govf_package_save_to_stream (self, G_OUTPUT_STREAM (stream), NULL, error)) {
+		g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+
+		/* closing a cancelled stream leaves the original file alone */
+		g_cancellable_cancel (cancellable);
+		g_output_stream_close (G_OUTPUT_STREAM (stream), cancellable, NULL);
+		return FALSE;
+	}
+
+	return g_output_stream_close (G_OUTPUT_STREAM (stream), NULL, error);
+}
+
+/* the expressions are compiled once and shared between all packages and
+ * threads; namespace prefixes are only resolved against the context at
+ * evaluation time */
+static xmlXPathCompExpr *
+ovf_xpath_get (OvfXPath path)
+{
+	static gsize initialized = 0;
+	static xmlXPathCompExpr *compiled[OVF_XPATH_LAST];
+
+	if (g_once_init_enter (&initialized)) {
+		guint i;
+
+		for (i = 0; i < OVF_XPATH_LAST; i++) {
+			compiled[i] = xmlXPathCompile ((const xmlChar *) ovf_xpath_exprs[i]);
+			g_assert (compiled[i] != NULL);
+		}
+		g_once_init_leave (&initialized, 1);
+	}
+
+	return compiled[path];
+}
+
+static gboolean
+xpath_section_exists (xmlXPathContext *ctx, OvfXPath path)
+{
+	gboolean ret = TRUE;
+	xmlXPathObject *obj;
+
+	obj = xmlXPathCompiledEval (ovf_xpath_get (path), ctx);
+	if (obj == NULL ||
+	    obj->type != XPATH_NODESET ||
+	    obj->nodesetval == NULL ||
+	    obj->nodesetval->nodeNr == 0) {
+		ret = FALSE;
+		goto out;
+	}
+
+out:
+	if (obj != NULL)
+		xmlXPathFreeObject (obj);
+
+	return ret;
+}
+
+static gchar *
+xpath_str (xmlXPathContext *ctx, OvfXPath path)
+{
+	xmlChar *content = NULL;
+	xmlXPathObject *obj;
+	gchar *ret;
+
+	obj = xmlXPathCompiledEval (ovf_xpath_get (path), ctx);
+	if (obj == NULL ||
+	    obj->type != XPATH_NODESET ||
+	    obj->nodesetval == NULL ||
+	    obj->nodesetval->nodeNr == 0) {
+		ret = NULL;
+		goto out;
+	}
+
+	content = xmlNodeGetContent (obj->nodesetval->nodeTab[0]);
+	ret = g_strdup ((const gchar *) content);
+
+out:
+	if (content != NULL)
+		xmlFree (content);
+	if (obj != NULL)
+		xmlXPathFreeObject (obj);
+
+	return ret;
+}
+
+static GPtrArray *
+parse_files (xmlXPathContext *ctx)
+{
+	gint i;
+	g_autoptr(GPtrArray) files = NULL;
+	xmlXPathObject *obj;
+
+	obj = xmlXPathCompiledEval (ovf_xpath_get (OVF_XPATH_FILES), ctx);
+	if (obj == NULL ||
+	    obj->type != XPATH_NODESET ||
+	    obj->nodesetval == NULL ||
+	    obj->nodesetval->nodeNr == 0) {
+		goto out;
+	}
+
+	files = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < obj->nodesetval->nodeNr; i++) {
+		GovfFile *file = govf_file_new ();
+		xmlNode *node = obj->nodesetval->nodeTab[i];
+		xmlChar *str;
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "id",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_file_set_id (file, (const gchar *) str);
+		xmlFree (str);
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "href",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_file_set_href (file, (const gchar *) str);
+		xmlFree (str);
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "size",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_file_set_size (file, (const gchar *) str);
+		xmlFree (str);
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "compression",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_file_set_compression (file, (const gchar *) str);
+		xmlFree (str);
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "chunkSize",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_file_set_chunk_size (file, (const gchar *) str);
+		xmlFree (str);
+
+		g_ptr_array_add (files, file);
+	}
+
+out:
+	if (obj != NULL)
+		xmlXPathFreeObject (obj);
+
+	return g_steal_pointer (&files);
+}
+
+static GPtrArray *
+parse_disks (xmlXPathContext *ctx)
+{
+	gint i;
+	g_autoptr(GPtrArray) disks = NULL;
+	xmlXPathObject *obj;
+
+	obj = xmlXPathCompiledEval (ovf_xpath_get (OVF_XPATH_DISKS), ctx);
+	if (obj == NULL ||
+	    obj->type != XPATH_NODESET ||
+	    obj->nodesetval == NULL ||
+	    obj->nodesetval->nodeNr == 0) {
+		goto out;
+	}
+
+	disks = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < obj->nodesetval->nodeNr; i++) {
+		GovfDisk *disk = govf_disk_new ();
+		xmlNode *node = obj->nodesetval->nodeTab[i];
+		xmlChar *str;
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "capacity",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_disk_set_capacity (disk, (const gchar *) str);
+		xmlFree (str);
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "diskId",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_disk_set_disk_id (disk, (const gchar *) str);
+		xmlFree (str);
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "fileRef",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_disk_set_file_ref (disk, (const gchar *) str);
+		xmlFree (str);
+
+		str = xmlGetNsProp (node,
+		                    (const xmlChar *) "format",
+		                    (const xmlChar *) OVF_NS_ENVELOPE);
+		govf_disk_set_format (disk, (const gchar *) str);
+		xmlFree (str);
+
+		g_ptr_array_add (disks, disk);
+	}
+
+out:
+	if (obj != NULL)
+		xmlXPathFreeObject (obj);
+
+	return g_steal_pointer (&disks);
+}
+
+static gboolean
+reader_is_ovf_element (xmlTextReader *reader, const gchar *name)
+{
+	const xmlChar *ns = xmlTextReaderConstNamespaceUri (reader);
+
+	return ns != NULL &&
+	       g_strcmp0 ((const gchar *) ns, OVF_NS_ENVELOPE) == 0 &&
+	       g_strcmp0 ((const gchar *) xmlTextReaderConstLocalName (reader), name) == 0;
+}
+
+static gchar *
+reader_get_ovf_attribute (xmlTextReader *reader, const gchar *name)
+{
+	xmlChar *str;
+	gchar *ret;
+
+	str = xmlTextReaderGetAttributeNs (reader,
+	                                   (const xmlChar *) name,
+	                                   (const xmlChar *) OVF_NS_ENVELOPE);
+	ret = g_strdup ((const gchar *) str);
+	xmlFree (str);
+
+	return ret;
+}
+
+/* the text content of the current element, like xmlNodeGetContent() */
+static gchar *
+reader_get_content (xmlTextReader *reader)
+{
+	xmlChar *content;
+	xmlNode *node;
+	gchar *ret;
+
+	node = xmlTextReaderExpand (reader);
+	if (node == NULL)
+		return NULL;
+
+	content = xmlNodeGetContent (node);
 	ret = g_strdup ((const gchar *) content);
+	xmlFree (content);
+
+	return ret;
+}
+
+static GovfFile *
+reader_parse_file (xmlTextReader *reader)
+{
+	GovfFile *file = govf_file_new ();
+	gchar *str;
+
+	str = reader_get_ovf_attribute (reader, "id");
+	govf_file_set_id (file, str);
+	g_free (str);
+
+	str = reader_get_ovf_attribute (reader, "href");
+	govf_file_set_href (file, str);
+	g_free (str);
+
+	str = reader_get_ovf_attribute (reader, "size");
+	govf_file_set_size (file, str);
+	g_free (str);
+
+	str = reader_get_ovf_attribute (reader, "compression");
+	govf_file_set_compression (file, str);
+	g_free (str);
+
+	str = reader_get_ovf_attribute (reader, "chunkSize");
+	govf_file_set_chunk_size (file, str);
+	g_free (str);
+
+	return file;
+}
+
+static GovfDisk *
+reader_parse_disk (xmlTextReader *reader)
+{
+	GovfDisk *disk = govf_disk_new ();
+	gchar *str;
+
+	str = reader_get_ovf_attribute (reader, "capacity");
+	govf_disk_set_capacity (disk, str);
+	g_free (str);
+
+	str = reader_get_ovf_attribute (reader, "diskId");
+	govf_disk_set_disk_id (disk, str);
+	g_free (str);
+
+	str = reader_get_ovf_attribute (reader, "fileRef");
+	govf_disk_set_file_ref (disk, str);
+	g_free (str);
+
+	str = reader_get_ovf_attribute (reader, "format");
+	govf_disk_set_format (disk, str);
+	g_free (str);
+
+	return disk;
+}
+
+typedef enum
+{
+	OVF_SECTION_NONE,
+	OVF_SECTION_REFERENCES,
+	OVF_SECTION_DISKSECTION,
+	OVF_SECTION_VIRTUALSYSTEM
+} OvfSection;
+
+/* keeps the descriptor to build the document tree from later on, sharing
+ * the copy read from an .ova file */
+static void
+keep_descriptor (GovfPackage  *self,
+                 const gchar  *data,
+                 gsize         length)
+{
+	if (self->ova_descriptor != NULL &&
+	    g_bytes_get_data (self->ova_descriptor, NULL) == (gconstpointer) data &&
+	    g_bytes_get_size (self->ova_descriptor) == length)
+		self->descriptor = g_bytes_ref (self->ova_descriptor);
+	else
+		self->descriptor = g_bytes_new (data, length);
+}
+
+/* walks the Envelope once with an xmlTextReader, picking out the same
+ * things as the XPath queries in govf_package_load_from_data(); any other
+ * subtree, such as vendor extensions, is skipped without building nodes */
+static gboolean
+load_streaming (GovfPackage  *self,
+                const gchar  *data,
+                gsize         length,
+                GError      **error)
+{
+	g_autofree gchar *desc = NULL;
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *os_id = NULL;
+	g_autofree gchar *system_id = NULL;
+	g_autoptr(GPtrArray) disks = NULL;
+	g_autoptr(GPtrArray) files = NULL;
+	gboolean has_virtual_system = FALSE;
+	gboolean has_operating_system = FALSE;
+	gboolean has_virtual_hardware = FALSE;
+	gboolean ret = TRUE;
+	OvfSection section = OVF_SECTION_NONE;
+	xmlTextReader *reader;
+	int r;
+
+	reader = xmlReaderForMemory (data, length, NULL, NULL, 0);
+	if (reader == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not parse XML");
+		return FALSE;
+	}
+
+	files = g_ptr_array_new_with_free_func (g_object_unref);
+	disks = g_ptr_array_new_with_free_func (g_object_unref);
+
+	r = xmlTextReaderRead (reader);
+	while (r == 1) {
+		gboolean descend = FALSE;
+		int depth;
+
+		if (xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT) {
+			r = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		depth = xmlTextReaderDepth (reader);
+		if (depth == 0) {
+			descend = reader_is_ovf_element (reader, "Envelope");
+		} else if (depth == 1) {
+			section = OVF_SECTION_NONE;
+			if (reader_is_ovf_element (reader, "References")) {
+				section = OVF_SECTION_REFERENCES;
+			} else if (reader_is_ovf_element (reader, "DiskSection")) {
+				section = OVF_SECTION_DISKSECTION;
+			} else if (reader_is_ovf_element (reader, "VirtualSystem")) {
+				section = OVF_SECTION_VIRTUALSYSTEM;
+				has_virtual_system = TRUE;
+				if (system_id == NULL)
+					system_id = reader_get_ovf_attribute (reader, "id");
+			}
+			descend = section != OVF_SECTION_NONE;
+		} else if (depth == 2 && section == OVF_SECTION_REFERENCES) {
+			if (reader_is_ovf_element (reader, "File"))
+				g_ptr_array_add (files, reader_parse_file (reader));
+		} else if (depth == 2 && section == OVF_SECTION_DISKSECTION) {
+			if (reader_is_ovf_element (reader, "Disk"))
+				g_ptr_array_add (disks, reader_parse_disk (reader));
+		} else if (depth == 2 && section == OVF_SECTION_VIRTUALSYSTEM) {
+			if (reader_is_ovf_element (reader, "OperatingSystemSection") && !has_operating_system) {
+				has_operating_system = TRUE;
+				os_id = reader_get_ovf_attribute (reader, "id");
+			}
+			else if (reader_is_ovf_element (reader, "VirtualHardwareSection"))
+				has_virtual_hardware = TRUE;
+			else if (reader_is_ovf_element (reader, "Name") && name == NULL)
+				name = reader_get_content (reader);
+			else if (reader_is_ovf_element (reader, "AnnotationSection"))
+				descend = TRUE;
+		} else if (depth == 3 && section == OVF_SECTION_VIRTUALSYSTEM) {
+			/* only AnnotationSection is descended into */
+			if (reader_is_ovf_element (reader, "Annotation") && desc == NULL)
+				desc = reader_get_content (reader);
+		}
+
+		r = descend ? xmlTextReaderRead (reader) : xmlTextReaderNext (reader);
+	}
+	xmlFreeTextReader (reader);
+
+	if (r != 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not parse XML");
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!has_virtual_system) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not find VirtualSystem section");
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!has_operating_system) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not find OperatingSystem section");
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!has_virtual_hardware) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not find VirtualHardware section");
+		ret = FALSE;
+		goto out;
+	}
+
+	g_debug ("name: %s, desc: %s", name != NULL ? name : system_id, desc);
+
+	self->name = name != NULL ? g_steal_pointer (&name) : g_steal_pointer (&system_id);
+	self->description = g_steal_pointer (&desc);
+	self->os_id = g_intern_string (os_id);
+	self->files = files->len > 0 ? g_steal_pointer (&files) : NULL;
+	self->disks = disks->len > 0 ? g_steal_pointer (&disks) : NULL;
+	build_indexes (self);
+
+	keep_descriptor (self, data, length);
+
+out:
+	return ret;
+}
+
+
+/**
+ * govf_package_load_from_data:
+ * @self: a #GovfPackage
+ * @data: OVF data
+ * @length: size of the OVF data
+ * @error: a #GError or %NULL
+ *
+ * Loads an OVF package from a memory buffer that holds an .ovf file.
+ * How the data is parsed depends on the package's #GovfLoadFlags, see
+ * govf_package_set_load_flags().
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_load_from_data (GovfPackage  *self,
+                             const gchar  *data,
+                             gssize        length,
+                             GError      **error)
+{
+	g_autofree gchar *os_id = NULL;
+	gboolean ret;
+	gint64 begin = g_get_monotonic_time ();
+	gint64 xpath_begin = 0;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (data != NULL, FALSE);
+
+	if (length < 0)
+		length = strlen (data);
+	GOVF_PROBE1 (load__start, length);
+
+	clear_model (self);
+
+	if (self->load_flags & GOVF_LOAD_FLAGS_STREAMING) {
+		ret = load_streaming (self, data, length, error);
+		stats_add_time (self, GOVF_PACKAGE_STAT_PARSE_USEC, begin);
+		goto out;
+	}
+
+	if (!load_doc (self, data, length, error)) {
+		ret = FALSE;
+		goto out;
+	}
+	xpath_begin = g_get_monotonic_time ();
+
+	if (!xpath_section_exists (self->ctx, OVF_XPATH_VIRTUALSYSTEM)) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not find VirtualSystem section");
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!xpath_section_exists (self->ctx, OVF_XPATH_OPERATINGSYSTEM)) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not find OperatingSystem section");
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!xpath_section_exists (self->ctx, OVF_XPATH_VIRTUALHARDWARE)) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_XML,
+		             "Could not find VirtualHardware section");
+		ret = FALSE;
+		goto out;
+	}
+
+	self->name = xpath_str (self->ctx, OVF_XPATH_NAME);
+	if (self->name == NULL)
+		self->name = xpath_str (self->ctx, OVF_XPATH_SYSTEM_ID);
+	self->description = xpath_str (self->ctx, OVF_XPATH_ANNOTATION);
+	os_id = xpath_str (self->ctx, OVF_XPATH_OS_ID);
+	self->os_id = g_intern_string (os_id);
+
+	g_debug ("name: %s, desc: %s", self->name, self->description);
+
+	self->files = parse_files (self->ctx);
+	self->disks = parse_disks (self->ctx);
+	build_indexes (self);
+	stats_add_time (self, GOVF_PACKAGE_STAT_XPATH_USEC, xpath_begin);
+	xpath_begin = 0;
+
+	/* everything is picked out of the tree by now; it is parsed again
+	 * from the descriptor if it is needed for saving */
+	if (self->load_flags & GOVF_LOAD_FLAGS_DETACHED) {
+		keep_descriptor (self, data, length);
+		g_clear_pointer (&self->ctx, xmlXPathFreeContext);
+		g_clear_pointer (&self->doc, xmlFreeDoc);
+	}
+
+	ret = TRUE;
+out:
+	if (xpath_begin != 0)
+		stats_add_time (self, GOVF_PACKAGE_STAT_XPATH_USEC, xpath_begin);
+	govf_trace_mark (begin, "load", NULL);
+	GOVF_PROBE1 (load__done, ret);
+
+	return ret;
+}
+
+/**
+ * govf_package_get_name:
+ * @self: a #GovfPackage
+ *
+ * Returns the name of the virtual system in the OVF package, or its id if
+ * it has no name.
+ *
+ * Returns: (transfer none) (nullable): the name
+ */
+const gchar *
+govf_package_get_name (GovfPackage *self)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
+
+	return self->name;
+}
+
+/**
+ * govf_package_get_description:
+ * @self: a #GovfPackage
+ *
+ * Returns the annotation of the virtual system in the OVF package.
+ *
+ * Returns: (transfer none) (nullable): the description
+ */
+const gchar *
+govf_package_get_description (GovfPackage *self)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
+
+	return self->description;
+}
+
+/**
+ * govf_package_get_os_id:
+ * @self: a #GovfPackage
+ *
+ * Returns the id of the guest operating system in the OVF package, as
+ * listed in the CIM_OperatingSystem OsType enumeration.
+ *
+ * Returns: (transfer none) (nullable): the operating system id
+ */
+const gchar *
+govf_package_get_os_id (GovfPackage *self)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
+
+	return self->os_id;
+}
+
+/**
+ * govf_package_get_disks:
+ * @self: a #GovfPackage
+ *
+ * Returns an array with all the disks associated with the OVF package.
+ *
+ * Returns: (element-type GovfDisk) (transfer full): an array
+ */
+GPtrArray *
+govf_package_get_disks (GovfPackage *self)
+{
+	if (self->disks == NULL)
+		return NULL;
+
+	return g_ptr_array_ref (self->disks);
+}
+
+/**
+ * govf_package_get_files:
+ * @self: a #GovfPackage
+ *
+ * Returns an array with all the files referenced by the OVF package.
+ *
+ * Returns: (element-type GovfFile) (transfer full): an array
+ */
+GPtrArray *
+govf_package_get_files (GovfPackage *self)
+{
+	if (self->files == NULL)
+		return NULL;
+
+	return g_ptr_array_ref (self->files);
+}
+
+/**
+ * govf_package_lookup_file:
+ * @self: a #GovfPackage
+ * @file_id: a file id
+ *
+ * Finds the file referenced by the OVF package with the given id, such as
+ * the file ref of a #GovfDisk.
+ *
+ * Returns: (transfer none) (nullable): a #GovfFile, or %NULL if not found
+ */
+GovfFile *
+govf_package_lookup_file (GovfPackage *self, const gchar *file_id)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
+	g_return_val_if_fail (file_id != NULL, NULL);
+
+	if (self->files_by_id == NULL)
+		return NULL;
+
+	return g_hash_table_lookup (self->files_by_id, file_id);
+}
+
+/**
+ * govf_package_lookup_disk:
+ * @self: a #GovfPackage
+ * @disk_id: a disk id
+ *
+ * Finds the disk in the OVF package with the given id.
+ *
+ * Returns: (transfer none) (nullable): a #GovfDisk, or %NULL if not found
+ */
+GovfDisk *
+govf_package_lookup_disk (GovfPackage *self, const gchar *disk_id)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
+	g_return_val_if_fail (disk_id != NULL, NULL);
+
+	if (self->disks_by_id == NULL)
+		return NULL;
+
+	return g_hash_table_lookup (self->disks_by_id, disk_id);
+}
+
+static gchar *
+disk_get_filename (GovfPackage  *self,
+                   GovfDisk     *disk,
+                   GError      **error)
+{
+	const gchar *file_ref;
+	const gchar *filename = NULL;
+	GovfFile *file;
+
+	file_ref = govf_disk_get_file_ref (disk);
+	if (file_ref == NULL || file_ref[0] == '\0') {
+		g_set_error (error,
+			     GOVF_PACKAGE_ERROR,
+			     GOVF_PACKAGE_ERROR_FAILED,
+			     "Disk is missing a file ref");
+		return NULL;
+	}
+
+	file = govf_package_lookup_file (self, file_ref);
+	if (file != NULL)
+		filename = govf_file_get_href (file);
+	if (filename == NULL || filename[0] == '\0') {
+		g_set_error (error,
+			     GOVF_PACKAGE_ERROR,
+			     GOVF_PACKAGE_ERROR_FAILED,
+			     "Could not find a filename for a disk");
+		return NULL;
+	}
+
+	return g_strdup (filename);
+}
+
+static gboolean
+extract_disk (GovfPackage      *self,
+              GovfDisk         *disk,
+              const gchar      *save_path,
+              GovfCopyContext  *ctx,
+              GError          **error)
+{
+	g_autofree gchar *filename = NULL;
+
+	if (self->ova_filename == NULL && self->ova_stream == NULL) {
+		g_set_error (error,
+			     GOVF_PACKAGE_ERROR,
+			     GOVF_PACKAGE_ERROR_FAILED,
+			     "No OVA package specified");
+		return FALSE;
+	}
+
+	filename = disk_get_filename (self, disk, error);
+	if (filename == NULL)
+		return FALSE;
+
+	if (!ova_extract_file_to_path (self,
+	                               filename,
+	                               save_path,
+	                               ctx,
+	                               error)) {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * govf_package_extract_disk:
+ * @self: a #GovfPackage
+ * @disk: a #GovfDisk to extract
+ * @save_path: full path to extract to
+ * @error: a #GError or %NULL
+ *
+ * Extracts a disk image to the specified path.
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_extract_disk (GovfPackage  *self,
+                           GovfDisk     *disk,
+                           const gchar  *save_path,
+                           GError      **error)
+{
+	GovfCopyContext ctx = { NULL, };
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (GOVF_IS_DISK (disk), FALSE);
+	g_return_val_if_fail (save_path != NULL, FALSE);
+
+	return extract_disk (self, disk, save_path, &ctx, error);
+}
+
+/**
+ * govf_package_open_disk:
+ * @self: a #GovfPackage
+ * @disk: a #GovfDisk to open
+ * @error: a #GError or %NULL
+ *
+ * Opens a disk image for reading in place, without extracting it. The
+ * returned stream is a #GSeekable, and reads map straight onto the bytes
+ * of the disk in the .ova file, so looking at a partition table or an
+ * image header only reads those few blocks.
+ *
+ * The stream has the bytes of the disk as stored in the archive; no
+ * conversion is done. It works only for packages loaded from an
+ * uncompressed .ova file with govf_package_load_from_ova_file(), and
+ * stays usable after @self is freed.
+ *
+ * Returns: (transfer full): a #GInputStream, or %NULL on error
+ */
+GInputStream *
+govf_package_open_disk (GovfPackage  *self,
+                        GovfDisk     *disk,
+                        GError      **error)
+{
+	g_autofree gchar *filename = NULL;
+	GovfOvaMember *member;
+	gint fd;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
+	g_return_val_if_fail (GOVF_IS_DISK (disk), NULL);
+
+	if (self->ova_filename == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "No OVA file specified");
+		return NULL;
+	}
+
+	filename = disk_get_filename (self, disk, error);
+	if (filename == NULL)
+		return NULL;
+
+	member = ova_find_member (self, filename);
+	if (member == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_NOT_FOUND,
+		             "Could not find %s in %s",
+		             filename,
+		             self->ova_filename);
+		return NULL;
+	}
+
+	/* data that has to be decompressed or reassembled can't be read at
+	 * an offset of its own */
+	if (!ova_member_is_verbatim (self, member)) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot open %s in %s without extracting it",
+		             filename,
+		             self->ova_filename);
+		return NULL;
+	}
+
+	fd = g_open (self->ova_filename, O_RDONLY, 0);
+	if (fd == -1) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot open %s: %s",
+		             self->ova_filename,
+		             g_strerror (errno));
+		return NULL;
+	}
+	if (!ova_check_unchanged (self, fd, error)) {
+		close (fd);
+		return NULL;
+	}
+	stats_add (self, GOVF_PACKAGE_STAT_MEMBERS_VISITED, 1);
+
+	return govf_member_stream_new (fd, member->data_offset, member->size);
+}
+
+typedef struct
+{
+	GovfPackage		 *self;
+	GovfExtraction		 *extraction;
+	gchar			 *filename;
+} GovfExtractJob;
+
+/* each job opens the archive and its output on file descriptors of its
+ * own, and copies with positional reads, so jobs can run side by side */
+static void
+extract_job_func (gpointer data, gpointer user_data)
+{
+	GovfExtractJob *job = data;
+	g_autoptr(GError) error_local = NULL;
+	GovfCopyContext ctx = { NULL, };
+
+	copy_context_init_for_extraction (&ctx, job->extraction);
+	if (!ova_extract_file_to_path (job->self,
+	                               job->filename,
+	                               govf_extraction_get_save_path (job->extraction),
+	                               &ctx,
+	                               &error_local))
+		govf_extraction_set_error (job->extraction, error_local);
+	copy_context_update_extraction (&ctx, job->extraction);
+
+	g_free (job->filename);
+	g_slice_free (GovfExtractJob, job);
+}
+
+/**
+ * govf_package_extract_disks:
+ * @self: a #GovfPackage
+ * @extractions: (element-type GovfExtraction): disks to extract, paired
+ *   with where to extract them to
+ * @error: a #GError or %NULL
+ *
+ * Extracts several disk images at once. Unlike calling
+ * govf_package_extract_disk() for each disk, this reads compressed or
+ * non-seekable .ova files only once, and copies disks that are stored
+ * uncompressed in an .ova file concurrently, see
+ * govf_package_set_extract_threads().
+ *
+ * The outcome for each disk is recorded in its #GovfExtraction, see
+ * govf_extraction_get_error() and govf_extraction_get_bytes_written().
+ * Disks are extracted according to their #GovfExtractFlags, see
+ * govf_extraction_set_flags(). A disk that doesn't match the digest in the
+ * manifest of the .ova file fails with
+ * %GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH when verifying.
+ *
+ * Returns: %TRUE if all the disks were extracted successfully
+ */
+gboolean
+govf_package_extract_disks (GovfPackage  *self,
+                            GPtrArray    *extractions,
+                            GError      **error)
+{
+	g_autoptr(GPtrArray) pending = NULL;
+	g_autoptr(GPtrArray) pending_filenames = NULL;
+	GThreadPool *pool = NULL;
+	guint failed = 0;
+	guint i;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (extractions != NULL, FALSE);
+
+	if (self->ova_filename == NULL && self->ova_stream == NULL) {
+		g_set_error (error,
+			     GOVF_PACKAGE_ERROR,
+			     GOVF_PACKAGE_ERROR_FAILED,
+			     "No OVA package specified");
+		return FALSE;
+	}
+
+	pending = g_ptr_array_new ();
+	pending_filenames = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < extractions->len; i++) {
+		GovfExtraction *extraction = g_ptr_array_index (extractions, i);
+		g_autofree gchar *filename = NULL;
+		g_autoptr(GError) error_local = NULL;
+		GovfOvaMember *member;
+		guint j;
+
+		govf_extraction_set_error (extraction, NULL);
+
+		filename = disk_get_filename (self,
+		                              govf_extraction_get_disk (extraction),
+		                              &error_local);
+		if (filename == NULL) {
+			govf_extraction_set_error (extraction, error_local);
+			continue;
+		}
+
+		/* members we know the location of are copied right away; a
+		 * stream can only be read from one place at a time */
+		member = ova_find_member (self, filename);
+		if (ova_member_is_verbatim (self, member)) {
+			GovfExtractJob *job = g_slice_new (GovfExtractJob);
+
+			job->self = self;
+			job->extraction = extraction;
+			job->filename = g_steal_pointer (&filename);
+			if (self->ova_stream == NULL && self->extract_threads > 1) {
+				if (pool == NULL) {
+					pool = g_thread_pool_new (extract_job_func,
+					                          NULL,
+					                          self->extract_threads,
+					                          FALSE,
+					                          NULL);
+				}
+				g_thread_pool_push (pool, job, NULL);
+			} else {
+				extract_job_func (job, NULL);
+			}
+			continue;
+		}
+
+		/* member data can only be read once per pass */
+		for (j = 0; j < pending_filenames->len; j++) {
+			if (g_strcmp0 (g_ptr_array_index (pending_filenames, j), filename) == 0) {
+				g_set_error (&error_local,
+				             GOVF_PACKAGE_ERROR,
+				             GOVF_PACKAGE_ERROR_FAILED,
+				             "%s is extracted more than once",
+				             filename);
+				govf_extraction_set_error (extraction, error_local);
+				break;
+			}
+		}
+		if (error_local != NULL)
+			continue;
+
+		g_ptr_array_add (pending, extraction);
+		g_ptr_array_add (pending_filenames, g_steal_pointer (&filename));
+	}
+
+	/* the single pass may still fill in package state, such as the
+	 * manifest, that the jobs read */
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	if (pending->len > 0 &&
+	    !ova_extract_files_single_pass (self, pending, pending_filenames, error))
+		return FALSE;
+
+	for (i = 0; i < extractions->len; i++) {
+		if (govf_extraction_get_error (g_ptr_array_index (extractions, i)) != NULL)
+			failed++;
+	}
+	if (failed > 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Failed to extract %u of %u disks",
+		             failed,
+		             extractions->len);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* hashes a member as libarchive hands it out, holes included */
+static gboolean
+ova_digest_entry (struct archive        *a,
+                  struct archive_entry  *entry,
+                  GovfHasher            *hasher,
+                  GCancellable          *cancellable,
+                  GError               **error)
+{
+	gint64 position = 0;
+	int r;
+
+	for (;;) {
+		const void *buf;
+		size_t size;
+		la_int64_t offset;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return FALSE;
+
+		r = archive_read_data_block (a, &buf, &size, &offset);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot extract: %s",
+			             archive_error_string (a));
+			return FALSE;
+		}
+
+		if (offset > position)
+			govf_hasher_update_zeros (hasher, offset - position);
+		govf_hasher_update (hasher, buf, size);
+		position = offset + size;
+	}
+
+	if (position < archive_entry_size (entry))
+		govf_hasher_update_zeros (hasher, archive_entry_size (entry) - position);
+
+	return TRUE;
+}
+
+/**
+ * govf_package_verify:
+ * @self: a #GovfPackage
+ * @cancellable: (nullable): a #GCancellable
+ * @error: a #GError or %NULL
+ *
+ * Checks all the files listed in the manifest of the .ova file against
+ * their digests, in a single pass over the archive and without extracting
+ * anything.
+ *
+ * Returns: %TRUE if the .ova file has a manifest and all the files listed
+ *   in it match their digests
+ */
+gboolean
+govf_package_verify (GovfPackage   *self,
+                     GCancellable  *cancellable,
+                     GError       **error)
+{
+	g_autoptr(GHashTable) verified = NULL;
+	GovfManifestEntry *manifest_entry;
+	GHashTableIter iter;
+	const gchar *name;
+	gboolean ret = TRUE;
+	int r;
+	struct archive *a = NULL;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+
+	if (self->ova_filename == NULL && self->ova_stream == NULL) {
+		g_set_error (error,
+			     GOVF_PACKAGE_ERROR,
+			     GOVF_PACKAGE_ERROR_FAILED,
+			     "No OVA package specified");
+		return FALSE;
+	}
+
+	verified = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	a = ova_open_archive (self, NULL, cancellable, error);
+	if (a == NULL) {
+		ret = FALSE;
+		goto out;
+	}
+
+	for (;;) {
+		struct archive_entry *entry;
+		GovfHasher *hasher;
+
+		r = archive_read_next_header (a, &entry);
+		if (r == ARCHIVE_EOF)
+			break;
+		if (r != ARCHIVE_OK) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot read header: %s",
+			             archive_error_string (a));
+			ret = FALSE;
+			goto out;
+		}
+		stats_add (self, GOVF_PACKAGE_STAT_HEADERS_SCANNED, 1);
+
+		name = archive_entry_pathname (entry);
+		if (name == NULL)
+			continue;
+
+		if (self->manifest == NULL && endswith (name, ".mf")) {
+			if (!ova_read_manifest (self, a, entry, error)) {
+				ret = FALSE;
+				goto out;
+			}
+			continue;
+		}
+
+		manifest_entry = manifest_lookup (self, name);
+		if (manifest_entry == NULL)
+			continue;
+
+		hasher = govf_hasher_new (manifest_entry->type);
+		stats_add (self, GOVF_PACKAGE_STAT_MEMBERS_VISITED, 1);
+		if (!ova_digest_entry (a, entry, hasher, cancellable, error)) {
+			govf_hasher_free (hasher);
+			ret = FALSE;
+			goto out;
+		}
+		if (g_ascii_strcasecmp (govf_hasher_get_digest (hasher), manifest_entry->digest) != 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH,
+			             "Digest of %s does not match the manifest",
+			             name);
+			govf_hasher_free (hasher);
+			ret = FALSE;
+			goto out;
+		}
+		govf_hasher_free (hasher);
+		g_hash_table_add (verified, manifest_entry);
+	}
+
+	if (self->manifest == NULL) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_NOT_FOUND,
+		             "Could not find any .mf files");
+		ret = FALSE;
+		goto out;
+	}
+
+	/* a non-seekable archive is only read once, so the descriptor has
+	 * already gone by when loading */
+	manifest_entry = self->ova_descriptor_name != NULL ?
+		manifest_lookup (self, self->ova_descriptor_name) : NULL;
+	if (manifest_entry != NULL &&
+	    self->ova_descriptor != NULL &&
+	    !g_hash_table_contains (verified, manifest_entry)) {
+		g_autofree gchar *digest = NULL;
+
+		digest = g_compute_checksum_for_bytes (manifest_entry->type, self->ova_descriptor);
+		if (g_ascii_strcasecmp (digest, manifest_entry->digest) != 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH,
+			             "Digest of %s does not match the manifest",
+			             self->ova_descriptor_name);
+			ret = FALSE;
+			goto out;
+		}
+		g_hash_table_add (verified, manifest_entry);
+	}
+
+	g_hash_table_iter_init (&iter, self->manifest);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &name, (gpointer *) &manifest_entry)) {
+		if (!g_hash_table_contains (verified, manifest_entry)) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_NOT_FOUND,
+			             "Could not find %s listed in the manifest",
+			             name);
+			ret = FALSE;
+			goto out;
+		}
+	}
+
+out:
+	if (a != NULL)
+		ova_close_archive (self, a);
+	return ret;
+}
+
+static gboolean
+ova_write_header (struct archive  *a,
+                  const gchar     *name,
+                  gint64           size,
+                  GError         **error)
+{
+	struct archive_entry *entry;
+	int r;
+
+	entry = archive_entry_new ();
+	archive_entry_set_pathname (entry, name);
+	archive_entry_set_filetype (entry, AE_IFREG);
+	archive_entry_set_perm (entry, 0644);
+	archive_entry_set_size (entry, size);
+	archive_entry_set_mtime (entry, g_get_real_time () / G_USEC_PER_SEC, 0);
+	r = archive_write_header (a, entry);
+	archive_entry_free (entry);
+	if (r != ARCHIVE_OK) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot write header for %s: %s",
+		             name,
+		             archive_error_string (a));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+ova_write_data (struct archive  *a,
+                const gchar     *buf,
+                gsize            len,
+                GError         **error)
+{
+	while (len > 0) {
+		la_ssize_t n = archive_write_data (a, buf, len);
+		if (n <= 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot write: %s",
+			             archive_error_string (a));
+			return FALSE;
+		}
+		buf += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+/* streams a file into the archive, hashing it on the side */
+static gboolean
+ova_write_file (struct archive  *a,
+                const gchar     *name,
+                const gchar     *path,
+                GChecksumType    type,
+                gchar          **digest,
+                GCancellable    *cancellable,
+                GError         **error)
+{
+	GovfHasher *hasher = NULL;
+	gboolean ret = TRUE;
+	gchar *buf = NULL;
+	gint64 remaining;
+	gint fd = -1;
+	struct stat st;
+
+	fd = g_open (path, O_RDONLY, 0);
+	if (fd == -1 || fstat (fd, &st) != 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_NOT_FOUND,
+		             "Cannot open %s: %s",
+		             path,
+		             g_strerror (errno));
+		ret = FALSE;
+		goto out;
+	}
+	if (!S_ISREG (st.st_mode)) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "%s is not a regular file",
+		             path);
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!ova_write_header (a, name, st.st_size, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	hasher = govf_hasher_new (type);
+	buf = copy_buffer_new (COPY_BUFFER_SIZE);
+	remaining = st.st_size;
+	while (remaining > 0) {
+		gssize n;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+			ret = FALSE;
+			goto out;
+		}
+
+		n = read (fd, buf, MIN (remaining, COPY_BUFFER_SIZE));
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot read %s: %s",
+			             path,
+			             g_strerror (errno));
+			ret = FALSE;
+			goto out;
+		}
+		if (n == 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "%s was truncated while writing",
+			             path);
+			ret = FALSE;
+			goto out;
+		}
+		govf_hasher_update (hasher, buf, n);
+		if (!ova_write_data (a, buf, n, error)) {
+			ret = FALSE;
+			goto out;
+		}
+		remaining -= n;
+	}
+
+	*digest = g_strdup (govf_hasher_get_digest (hasher));
+
+out:
+	if (hasher != NULL)
+		govf_hasher_free (hasher);
+	free (buf);
+	if (fd != -1)
+		close (fd);
+	return ret;
+}
+
+/* hrefs come from the descriptor, and are used both as paths below the
+ * source directory and as member names, so they must stay below it */
+static gboolean
+href_is_relative (const gchar *href)
+{
+	g_auto(GStrv) components = NULL;
+	guint i;
+
+	if (href[0] == '\0' || g_path_is_absolute (href))
+		return FALSE;
+
+	components = g_strsplit (href, G_DIR_SEPARATOR_S, -1);
+	for (i = 0; components[i] != NULL; i++) {
+		if (g_strcmp0 (components[i], "..") == 0)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static void
+manifest_append (GString        *manifest,
+                 GChecksumType   type,
+                 const gchar    *name,
+                 const gchar    *digest)
+{
+	g_string_append_printf (manifest,
+	                        "%s(%s)= %s\n",
+	                        type == G_CHECKSUM_SHA1 ? "SHA1" :
+	                        type == G_CHECKSUM_SHA512 ? "SHA512" : "SHA256",
+	                        name,
+	                        digest);
+}
+
+/**
+ * govf_package_write_ova:
+ * @self: a #GovfPackage
+ * @filename: an .ova file name
+ * @source_dir: the directory the files referenced by the package are in
+ * @cancellable: (nullable): a #GCancellable
+ * @error: a #GError or %NULL
+ *
+ * Packs the OVF descriptor and all the files it references into an
+ * uncompressed .ova file. The descriptor comes first, followed by a
+ * manifest with SHA256 digests of the descriptor and the files, and then
+ * the files in the order they are referenced.
+ *
+ * The files are only read once; their digests are filled into the
+ * manifest after all of them have been written.
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_write_ova (GovfPackage   *self,
+                        const gchar   *filename,
+                        const gchar   *source_dir,
+                        GCancellable  *cancellable,
+                        GError       **error)
+{
+	const GChecksumType type = G_CHECKSUM_SHA256;
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *descriptor_digest = NULL;
+	g_autofree gchar *descriptor_name = NULL;
+	g_autofree gchar *manifest_name = NULL;
+	g_autofree gchar *placeholder = NULL;
+	g_autoptr(GBytes) descriptor = NULL;
+	g_autoptr(GOutputStream) descriptor_stream = NULL;
+	g_autoptr(GPtrArray) digests = NULL;
+	g_autoptr(GString) manifest = NULL;
+	g_autoptr(GString) manifest_head = NULL;
+	const gchar *data;
+	gboolean created = FALSE;
+	gboolean ret = TRUE;
+	gint64 manifest_offset;
+	gsize length;
+	gsize written;
+	gint fd = -1;
+	guint i;
+	struct archive *a = NULL;
+
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (source_dir != NULL, FALSE);
+
+	if (!ensure_doc (self, error))
+		return FALSE;
+
+	basename = g_path_get_basename (filename);
+	if (endswith (basename, ".ova"))
+		basename[strlen (basename) - 4] = '\0';
+	descriptor_name = g_strconcat (basename, ".ovf", NULL);
+	manifest_name = g_strconcat (basename, ".mf", NULL);
+
+	/* the tar header and the manifest need the length and digest of the
+	 * descriptor up front, so it is serialized into memory once */
+	descriptor_stream = g_memory_output_stream_new_resizable ();
+	if (!govf_package_save_to_stream (self, descriptor_stream, cancellable, error) ||
+	    !g_output_stream_close (descriptor_stream, cancellable, error)) {
+		ret = FALSE;
+		goto out;
+	}
+	descriptor = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (descriptor_stream));
+	data = g_bytes_get_data (descriptor, &length);
+
+	/* the manifest goes before the files, so room is made for it with
+	 * placeholder digests of the same length */
+	descriptor_digest = g_compute_checksum_for_data (type, (const guchar *) data, length);
+	manifest_head = g_string_new (NULL);
+	manifest_append (manifest_head, type, descriptor_name, descriptor_digest);
+	manifest = g_string_new (manifest_head->str);
+	placeholder = g_strnfill (g_checksum_type_get_length (type) * 2, '0');
+	for (i = 0; self->files != NULL && i < self->files->len; i++) {
+		GovfFile *file = g_ptr_array_index (self->files, i);
+
+		if (govf_file_get_href (file) == NULL) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "File %s has no href",
+			             govf_file_get_id (file));
+			ret = FALSE;
+			goto out;
+		}
+		if (!href_is_relative (govf_file_get_href (file))) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "File %s has an href outside the package: %s",
+			             govf_file_get_id (file),
+			             govf_file_get_href (file));
+			ret = FALSE;
+			goto out;
+		}
+		manifest_append (manifest, type, govf_file_get_href (file), placeholder);
+	}
+
+	fd = open_for_writing (filename, &created, error);
+	if (fd == -1) {
+		ret = FALSE;
+		goto out;
+	}
+
+	a = archive_write_new ();
+	/* plain ustar headers, except for members over 8 GiB or with long
+	 * names, which need a pax extended header */
+	archive_write_set_format_pax_restricted (a);
+	/* hand the large data buffers straight to write() */
+	archive_write_set_bytes_per_block (a, 0);
+	if (archive_write_open_fd (a, fd) != ARCHIVE_OK) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot open archive: %s",
+		             archive_error_string (a));
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!ova_write_header (a, descriptor_name, length, error) ||
+	    !ova_write_data (a, data, length, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	if (!ova_write_header (a, manifest_name, manifest->len, error)) {
+		ret = FALSE;
+		goto out;
+	}
+	manifest_offset = archive_filter_bytes (a, -1);
+	if (!ova_write_data (a, manifest->str, manifest->len, error)) {
+		ret = FALSE;
+		goto out;
+	}
+
+	digests = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; self->files != NULL && i < self->files->len; i++) {
+		GovfFile *file = g_ptr_array_index (self->files, i);
+		g_autofree gchar *path = NULL;
+		gchar *digest = NULL;
+
+		path = g_build_filename (source_dir, govf_file_get_href (file), NULL);
+		if (!ova_write_file (a,
+		                     govf_file_get_href (file),
+		                     path,
+		                     type,
+		                     &digest,
+		                     cancellable,
+		                     error)) {
+			ret = FALSE;
+			goto out;
+		}
+		g_ptr_array_add (digests, digest);
+	}
+
+	if (archive_write_close (a) != ARCHIVE_OK) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot write: %s",
+		             archive_error_string (a));
+		ret = FALSE;
+		goto out;
+	}
+
+	/* same names and digest lengths, so the manifest keeps its size */
+	g_string_assign (manifest, manifest_head->str);
+	for (i = 0; i < digests->len; i++) {
+		GovfFile *file = g_ptr_array_index (self->files, i);
+		manifest_append (manifest,
+		                 type,
+		                 govf_file_get_href (file),
+		                 g_ptr_array_index (digests, i));
+	}
+	for (written = 0; written < manifest->len; ) {
+		gssize n = pwrite (fd,
+		                   manifest->str + written,
+		                   manifest->len - written,
+		                   manifest_offset + written);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot write: %s",
+			             g_strerror (errno));
+			ret = FALSE;
+			goto out;
+		}
+		written += n;
+	}
+
+out:
+	if (a != NULL)
+		archive_write_free (a);
+	if (fd != -1) {
+		close (fd);
+		/* don't leave a partially written package behind */
+		if (!ret && created)
+			g_unlink (filename);
+	}
+
+	return ret;
+}
+
+typedef struct
+{
+	GTask			 *task;
+	GTaskThreadFunc		  func;
+} GovfWorkerJob;
+
+static void
+worker_pool_func (gpointer data, gpointer user_data)
+{
+	GovfWorkerJob *job = data;
+
+	job->func (job->task,
+	           g_task_get_source_object (job->task),
+	           g_task_get_task_data (job->task),
+	           g_task_get_cancellable (job->task));
+
+	g_object_unref (job->task);
+	g_slice_free (GovfWorkerJob, job);
+}
+
+/* like g_task_run_in_thread(), but on a bounded pool of our own so that
+ * long running extractions can't starve the shared GIO worker threads */
+static void
+run_in_worker_pool (GTask *task, GTaskThreadFunc func)
+{
+	static gsize pool_initialized = 0;
+	static GThreadPool *pool = NULL;
+	GovfWorkerJob *job;
+
+	if (g_once_init_enter (&pool_initialized)) {
+		pool = g_thread_pool_new (worker_pool_func,
+		                          NULL,
+		                          WORKER_POOL_MAX_THREADS,
+		                          FALSE,
+		                          NULL);
+		g_once_init_leave (&pool_initialized, 1);
+	}
+
+	job = g_slice_new (GovfWorkerJob);
+	job->task = g_object_ref (task);
+	job->func = func;
+	g_thread_pool_push (pool, job, NULL);
+}
+
+static void
+load_from_ova_file_thread (GTask         *task,
+                           gpointer       source_object,
+                           gpointer       task_data,
+                           GCancellable  *cancellable)
+{
+	GovfPackage *self = GOVF_PACKAGE (source_object);
+	const gchar *filename = task_data;
+	GError *error = NULL;
+
+	if (!load_from_ova_file (self, filename, cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * govf_package_load_from_ova_file_async:
+ * @self: a #GovfPackage
+ * @filename: an .ova file name
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the
+ *   operation is finished
+ * @user_data: (closure): the data to pass to @callback
+ *
+ * Asynchronously loads an OVF package from a compressed .ova file. See
+ * govf_package_load_from_ova_file() for the synchronous version.
+ *
+ * The package must not be used until the operation has finished.
+ */
+void
+govf_package_load_from_ova_file_async (GovfPackage          *self,
+                                       const gchar          *filename,
+                                       GCancellable         *cancellable,
+                                       GAsyncReadyCallback   callback,
+                                       gpointer              user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (GOVF_IS_PACKAGE (self));
+	g_return_if_fail (filename != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, govf_package_load_from_ova_file_async);
+	g_task_set_task_data (task, g_strdup (filename), g_free);
+	run_in_worker_pool (task, load_from_ova_file_thread);
+}
+
+/**
+ * govf_package_load_from_ova_file_finish:
+ * @self: a #GovfPackage
+ * @result: a #GAsyncResult
+ * @error: a #GError or %NULL
+ *
+ * Finishes an operation started with govf_package_load_from_ova_file_async().
+ *
+ * Returns: %TRUE if the operation succeeded
+ */
+gboolean
+govf_package_load_from_ova_file_finish (GovfPackage   *self,
+                                        GAsyncResult  *result,
+                                        GError       **error)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+typedef struct
+{
+	GovfDisk		 *disk;
+	gchar			 *save_path;
+	GFileProgressCallback	  progress_callback;
+	gpointer		  progress_data;
+	gint64			  progress_time;
+} ExtractDiskData;
 
-out:
-	if (content != NULL)
-		xmlFree (content);
-	if (obj != NULL)
-		xmlXPathFreeObject (obj);
+static void
+extract_disk_data_free (ExtractDiskData *data)
+{
+	g_object_unref (data->disk);
+	g_free (data->save_path);
+	g_slice_free (ExtractDiskData, data);
+}
 
-	return ret;
+typedef struct
+{
+	GFileProgressCallback	  progress_callback;
+	gpointer		  progress_data;
+	goffset			  current;
+	goffset			  total;
+} ProgressData;
+
+static void
+progress_data_free (ProgressData *data)
+{
+	g_slice_free (ProgressData, data);
 }
 
-static GPtrArray *
-parse_disks (xmlXPathContext *ctx)
+static gboolean
+progress_idle_cb (gpointer user_data)
 {
-	gint i;
-	g_autoptr(GPtrArray) disks = NULL;
-	xmlXPathObject *obj;
+	ProgressData *data = user_data;
 
-	obj = xmlXPathEval ((const xmlChar *) OVF_PATH_DISKSECTION "/ovf:Disk", ctx);
-	if (obj == NULL ||
-	    obj->type != XPATH_NODESET ||
-	    obj->nodesetval == NULL ||
-	    obj->nodesetval->nodeNr == 0) {
-		goto out;
-	}
+	data->progress_callback (data->current, data->total, data->progress_data);
+	return G_SOURCE_REMOVE;
+}
 
-	disks = g_ptr_array_new_with_free_func (g_object_unref);
-	for (i = 0; i < obj->nodesetval->nodeNr; i++) {
-		GovfDisk *disk = govf_disk_new ();
-		xmlNode *node = obj->nodesetval->nodeTab[i];
-		xmlChar *str;
+/* called in the worker thread; hands the progress over to the main context
+ * the operation was started from, at a rate the caller can keep up with */
+static void
+extract_disk_progress_cb (goffset   current,
+                          goffset   total,
+                          gpointer  user_data)
+{
+	GTask *task = G_TASK (user_data);
+	ExtractDiskData *data = g_task_get_task_data (task);
+	ProgressData *progress;
+	g_autoptr(GSource) source = NULL;
+	gint64 now;
 
-		str = xmlGetNsProp (node,
-		                    (const xmlChar *) "capacity",
-		                    (const xmlChar *) OVF_NS_ENVELOPE);
-		govf_disk_set_capacity (disk, (const gchar *) str);
-		xmlFree (str);
+	now = g_get_monotonic_time ();
+	if (current < total && now - data->progress_time < PROGRESS_INTERVAL_USEC)
+		return;
+	data->progress_time = now;
 
-		str = xmlGetNsProp (node,
-		                    (const xmlChar *) "diskId",
-		                    (const xmlChar *) OVF_NS_ENVELOPE);
-		govf_disk_set_disk_id (disk, (const gchar *) str);
-		xmlFree (str);
+	progress = g_slice_new (ProgressData);
+	progress->progress_callback = data->progress_callback;
+	progress->progress_data = data->progress_data;
+	progress->current = current;
+	progress->total = total;
 
-		str = xmlGetNsProp (node,
-		                    (const xmlChar *) "fileRef",
-		                    (const xmlChar *) OVF_NS_ENVELOPE);
-		govf_disk_set_file_ref (disk, (const gchar *) str);
-		xmlFree (str);
+	/* same priority as the task completion, so that the last progress
+	 * report is always delivered before the callback */
+	source = g_idle_source_new ();
+	g_source_set_priority (source, G_PRIORITY_DEFAULT);
+	g_source_set_callback (source,
+	                       progress_idle_cb,
+	                       progress,
+	                       (GDestroyNotify) progress_data_free);
+	g_source_attach (source, g_task_get_context (task));
+}
 
-		str = xmlGetNsProp (node,
-		                    (const xmlChar *) "format",
-		                    (const xmlChar *) OVF_NS_ENVELOPE);
-		govf_disk_set_format (disk, (const gchar *) str);
-		xmlFree (str);
+static void
+extract_disk_thread (GTask         *task,
+                     gpointer       source_object,
+                     gpointer       task_data,
+                     GCancellable  *cancellable)
+{
+	GovfPackage *self = GOVF_PACKAGE (source_object);
+	ExtractDiskData *data = task_data;
+	GovfCopyContext ctx = { NULL, };
+	GError *error = NULL;
 
-		g_ptr_array_add (disks, disk);
+	ctx.cancellable = cancellable;
+	if (data->progress_callback != NULL) {
+		ctx.progress_callback = extract_disk_progress_cb;
+		ctx.progress_data = task;
 	}
 
-out:
-	if (obj != NULL)
-		xmlXPathFreeObject (obj);
+	if (!extract_disk (self, data->disk, data->save_path, &ctx, &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
 
-	return g_steal_pointer (&disks);
+	g_task_return_boolean (task, TRUE);
 }
 
-static gchar *
-disk_filename_by_file_ref (xmlXPathContext *ctx, const gchar *file_ref)
+/**
+ * govf_package_extract_disk_async:
+ * @self: a #GovfPackage
+ * @disk: a #GovfDisk to extract
+ * @save_path: full path to extract to
+ * @cancellable: (nullable): a #GCancellable or %NULL
+ * @progress_callback: (nullable) (scope call) (closure progress_data):
+ *   a function to call with the number of bytes extracted so far
+ * @progress_data: the data to pass to @progress_callback
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the
+ *   operation is finished
+ * @user_data: (closure): the data to pass to @callback
+ *
+ * Asynchronously extracts a disk image to the specified path. See
+ * govf_package_extract_disk() for the synchronous version.
+ *
+ * @progress_callback is called in the thread-default main context of the
+ * caller. If the operation is cancelled or fails, the partially extracted
+ * file is removed, unless it existed before.
+ */
+void
+govf_package_extract_disk_async (GovfPackage            *self,
+                                 GovfDisk               *disk,
+                                 const gchar            *save_path,
+                                 GCancellable           *cancellable,
+                                 GFileProgressCallback   progress_callback,
+                                 gpointer                progress_data,
+                                 GAsyncReadyCallback     callback,
+                                 gpointer                user_data)
 {
-	g_autofree gchar *xpath = NULL;
+	g_autoptr(GTask) task = NULL;
+	ExtractDiskData *data;
 
-	g_assert (file_ref != NULL);
+	g_return_if_fail (GOVF_IS_PACKAGE (self));
+	g_return_if_fail (GOVF_IS_DISK (disk));
+	g_return_if_fail (save_path != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
-	xpath = g_strdup_printf (OVF_PATH_REFERENCES "/ovf:File[@ovf:id='%s']/@ovf:href", file_ref);
-	return xpath_str (ctx, xpath);
-}
+	data = g_slice_new0 (ExtractDiskData);
+	data->disk = g_object_ref (disk);
+	data->save_path = g_strdup (save_path);
+	data->progress_callback = progress_callback;
+	data->progress_data = progress_data;
 
+	task = g_task_new (self, cancellable, callback, user_data);
+	g_task_set_source_tag (task, govf_package_extract_disk_async);
+	g_task_set_task_data (task, data, (GDestroyNotify) extract_disk_data_free);
+	run_in_worker_pool (task, extract_disk_thread);
+}
 
 /**
- * govf_package_load_from_data:
+ * govf_package_extract_disk_finish:
  * @self: a #GovfPackage
- * @data: OVF data
- * @length: size of the OVF data
+ * @result: a #GAsyncResult
  * @error: a #GError or %NULL
  *
- * Loads an OVF package from a memory buffer that holds an .ovf file.
+ * Finishes an operation started with govf_package_extract_disk_async().
  *
  * Returns: %TRUE if the operation succeeded
  */
 gboolean
-govf_package_load_from_data (GovfPackage  *self,
-                             const gchar  *data,
-                             gssize        length,
-                             GError      **error)
+govf_package_extract_disk_finish (GovfPackage   *self,
+                                  GAsyncResult  *result,
+                                  GError       **error)
 {
-	g_autofree gchar *desc = NULL;
-	g_autofree gchar *name = NULL;
-	gboolean ret;
-
 	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
-	g_return_val_if_fail (data != NULL, FALSE);
+	g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
 
-	g_clear_pointer (&self->ctx, xmlXPathFreeContext);
-	g_clear_pointer (&self->doc, xmlFreeDoc);
+	return g_task_propagate_boolean (G_TASK (result), error);
+}
 
-	self->doc = xmlParseMemory (data, length);
-	if (self->doc == NULL) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_XML,
-		             "Could not parse XML");
-		ret = FALSE;
-		goto out;
-	}
+/**
+ * govf_package_new:
+ *
+ * Creates a new #GovfPackage.
+ *
+ * Returns: (transfer full): a #GovfPackage
+ */
+GovfPackage *
+govf_package_new (void)
+{
+	return g_object_new (GOVF_TYPE_PACKAGE, NULL);
+}
 
-	self->ctx = xmlXPathNewContext (self->doc);
-	xmlXPathRegisterNs (self->ctx,
-	                    (const xmlChar *) "ovf",
-	                    (const xmlChar *) "http://schemas.dmtf.org/ovf/envelope/1");
+/**
+ * govf_package_get_load_flags:
+ * @self: a #GovfPackage
+ *
+ * Returns the flags used when loading the package.
+ *
+ * Returns: the #GovfLoadFlags
+ */
+GovfLoadFlags
+govf_package_get_load_flags (GovfPackage *self)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), GOVF_LOAD_FLAGS_NONE);
 
-	if (!xpath_section_exists (self->ctx, OVF_PATH_VIRTUALSYSTEM)) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_XML,
-		             "Could not find VirtualSystem section");
-		ret = FALSE;
-		goto out;
-	}
+	return self->load_flags;
+}
 
-	if (!xpath_section_exists (self->ctx, OVF_PATH_OPERATINGSYSTEM)) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_XML,
-		             "Could not find OperatingSystem section");
-		ret = FALSE;
-		goto out;
-	}
+/**
+ * govf_package_set_load_flags:
+ * @self: a #GovfPackage
+ * @flags: the #GovfLoadFlags
+ *
+ * Sets the flags to use for subsequent loads of the package.
+ */
+void
+govf_package_set_load_flags (GovfPackage   *self,
+                             GovfLoadFlags  flags)
+{
+	g_return_if_fail (GOVF_IS_PACKAGE (self));
 
-	if (!xpath_section_exists (self->ctx, OVF_PATH_VIRTUALHARDWARE)) {
-		g_set_error (error,
-		             GOVF_PACKAGE_ERROR,
-		             GOVF_PACKAGE_ERROR_XML,
-		             "Could not find VirtualHardware section");
-		ret = FALSE;
-		goto out;
-	}
+	self->load_flags = flags;
+}
 
-	name = xpath_str (self->ctx, OVF_PATH_VIRTUALSYSTEM "/ovf:Name");
-	if (name == NULL)
-		name = xpath_str (self->ctx, OVF_PATH_VIRTUALSYSTEM "/@ovf:id");
-	desc = xpath_str (self->ctx, OVF_PATH_VIRTUALSYSTEM "/ovf:AnnotationSection/ovf:Annotation");
+/**
+ * govf_package_get_bytes_read:
+ * @self: a #GovfPackage
+ *
+ * Returns how many bytes were read from the .ova file or stream the last
+ * time the package was loaded from one. Member data of an uncompressed
+ * .ova that can be seeked in is stepped over rather than read, so this
+ * stays at a few kilobytes per member however large the disks are.
+ *
+ * Returns: the number of bytes read
+ */
+guint64
+govf_package_get_bytes_read (GovfPackage *self)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), 0);
 
-	g_debug ("name: %s, desc: %s", name, desc);
+	return self->bytes_read;
+}
 
-	if (self->disks != NULL)
-		g_ptr_array_free (self->disks, TRUE);
+/**
+ * govf_package_get_stat:
+ * @self: a #GovfPackage
+ * @stat: the #GovfPackageStat to return
+ *
+ * Returns one of the statistics the package collects while loading and
+ * extracting, to find out where the time goes. They add up over every
+ * operation on the package until govf_package_reset_stats() is called.
+ *
+ * Returns: the value of @stat
+ */
+guint64
+govf_package_get_stat (GovfPackage     *self,
+                       GovfPackageStat  stat)
+{
+	guint64 value;
 
-	self->disks = parse_disks (self->ctx);
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), 0);
+	g_return_val_if_fail (stat < GOVF_PACKAGE_STAT_LAST, 0);
 
-	ret = TRUE;
-out:
+	g_mutex_lock (&self->stats_mutex);
+	value = self->stats[stat];
+	g_mutex_unlock (&self->stats_mutex);
 
-	return ret;
+	return value;
 }
 
 /**
- * govf_package_get_disks:
+ * govf_package_reset_stats:
  * @self: a #GovfPackage
  *
- * Returns an array with all the disks associated with the OVF package.
- *
- * Returns: (element-type GovfDisk) (transfer full): an array
+ * Sets all the statistics returned by govf_package_get_stat() back to 0.
  */
-GPtrArray *
-govf_package_get_disks (GovfPackage *self)
+void
+govf_package_reset_stats (GovfPackage *self)
 {
-	if (self->disks == NULL)
-		return NULL;
+	g_return_if_fail (GOVF_IS_PACKAGE (self));
 
-	return g_ptr_array_ref (self->disks);
+	g_mutex_lock (&self->stats_mutex);
+	memset (self->stats, 0, sizeof (self->stats));
+	g_mutex_unlock (&self->stats_mutex);
 }
 
 /**
- * govf_package_extract_disk:
+ * govf_package_get_extract_options:
  * @self: a #GovfPackage
- * @disk: a #GovfDisk to extract
- * @save_path: full path to extract to
- * @error: a #GError or %NULL
  *
- * Extracts a disk image to the specified path.
+ * Returns the options disks are extracted with.
  *
- * Returns: %TRUE if the operation succeeded
+ * Returns: (transfer none) (nullable): a #GovfExtractOptions, or %NULL for
+ *   the defaults
  */
-gboolean
-govf_package_extract_disk (GovfPackage  *self,
-                           GovfDisk     *disk,
-                           const gchar  *save_path,
-                           GError      **error)
+GovfExtractOptions *
+govf_package_get_extract_options (GovfPackage *self)
 {
-	const gchar *file_ref;
-	g_autofree gchar *filename = NULL;
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
 
-	g_return_val_if_fail (GOVF_IS_PACKAGE (self), FALSE);
-	g_return_val_if_fail (GOVF_IS_DISK (disk), FALSE);
-	g_return_val_if_fail (save_path != NULL, FALSE);
+	return self->extract_options;
+}
 
-	if (self->ova_filename == NULL) {
-		g_set_error (error,
-			     GOVF_PACKAGE_ERROR,
-			     GOVF_PACKAGE_ERROR_FAILED,
-			     "No OVA package specified");
-		return FALSE;
-	}
+/**
+ * govf_package_set_extract_options:
+ * @self: a #GovfPackage
+ * @options: (nullable): a #GovfExtractOptions, or %NULL for the defaults
+ *
+ * Sets the block size and the I/O hints used when extracting disks from
+ * an .ova file. On shared hosts, %GOVF_IO_FLAGS_DROP_CACHE and
+ * %GOVF_IO_FLAGS_DIRECT keep a bulk import from evicting everything else
+ * from the page cache.
+ */
+void
+govf_package_set_extract_options (GovfPackage        *self,
+                                  GovfExtractOptions *options)
+{
+	g_return_if_fail (GOVF_IS_PACKAGE (self));
+	g_return_if_fail (options == NULL || GOVF_IS_EXTRACT_OPTIONS (options));
 
-	file_ref = govf_disk_get_file_ref (disk);
-	if (file_ref == NULL || file_ref[0] == '\0') {
-		g_set_error (error,
-			     GOVF_PACKAGE_ERROR,
-			     GOVF_PACKAGE_ERROR_FAILED,
-			     "Disk is missing a file ref");
-		return FALSE;
-	}
+	g_set_object (&self->extract_options, options);
+}
 
-	filename = disk_filename_by_file_ref (self->ctx, file_ref);
-	if (filename == NULL || filename[0] == '\0') {
-		g_set_error (error,
-			     GOVF_PACKAGE_ERROR,
-			     GOVF_PACKAGE_ERROR_FAILED,
-			     "Could not find a filename for a disk");
-		return FALSE;
-	}
+/**
+ * govf_package_get_extract_threads:
+ * @self: a #GovfPackage
+ *
+ * Returns how many disks govf_package_extract_disks() copies at once.
+ *
+ * Returns: the number of threads
+ */
+guint
+govf_package_get_extract_threads (GovfPackage *self)
+{
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), 0);
 
-	if (!ova_extract_file_to_path (self->ova_filename,
-	                               filename,
-	                               save_path,
-	                               error)) {
-		return FALSE;
-	}
+	return self->extract_threads;
+}
 
-	return TRUE;
+/**
+ * govf_package_set_extract_threads:
+ * @self: a #GovfPackage
+ * @n_threads: the number of threads, or 1 to copy one disk at a time
+ *
+ * Sets how many disks govf_package_extract_disks() copies at once. Only
+ * disks stored uncompressed in an .ova file that was loaded from a
+ * filename are copied concurrently.
+ */
+void
+govf_package_set_extract_threads (GovfPackage *self,
+                                  guint        n_threads)
+{
+	g_return_if_fail (GOVF_IS_PACKAGE (self));
+	g_return_if_fail (n_threads > 0);
+
+	self->extract_threads = n_threads;
 }
 
 /**
- * govf_package_new:
+ * govf_package_get_cache_dir:
+ * @self: a #GovfPackage
  *
- * Creates a new #GovfPackage.
+ * Returns the directory loads from .ova files are cached in.
  *
- * Returns: (transfer full): a #GovfPackage
+ * Returns: (nullable): the cache directory, or %NULL if loads are not
+ *   cached
  */
-GovfPackage *
-govf_package_new (void)
+const gchar *
+govf_package_get_cache_dir (GovfPackage *self)
 {
-	return g_object_new (GOVF_TYPE_PACKAGE, NULL);
+	g_return_val_if_fail (GOVF_IS_PACKAGE (self), NULL);
+
+	return self->cache_dir;
+}
+
+/**
+ * govf_package_set_cache_dir:
+ * @self: a #GovfPackage
+ * @cache_dir: (nullable): a directory, or %NULL to not cache loads
+ *
+ * Sets a directory to cache loads from .ova files in. Loading a file
+ * stores the archive index, the descriptor and the disks and files found
+ * in it in the directory, and loading the same file again maps the entry
+ * in instead of scanning the archive and parsing the descriptor.
+ *
+ * Entries are keyed by the device, inode, size and modification time of
+ * the file and by a checksum of its descriptor, which is read back to
+ * check it where the archive is an uncompressed tar. The directory may
+ * be shared between processes; entries are replaced atomically.
+ *
+ * Only govf_package_load_from_ova_file() and
+ * govf_package_load_from_ova_file_async() use the cache.
+ */
+void
+govf_package_set_cache_dir (GovfPackage *self,
+                            const gchar *cache_dir)
+{
+	g_return_if_fail (GOVF_IS_PACKAGE (self));
+
+	g_free (self->cache_dir);
+	self->cache_dir = g_strdup (cache_dir);
 }
 
 static void
@@ -600,13 +5288,29 @@ govf_package_finalize (GObject *object)
 	GovfPackage *self = GOVF_PACKAGE (object);
 
 	if (self->disks != NULL)
-		g_ptr_array_free (self->disks, TRUE);
+		g_ptr_array_unref (self->disks);
+	if (self->ova_members != NULL)
+		g_ptr_array_unref (self->ova_members);
 	if (self->ctx != NULL)
 		xmlXPathFreeContext (self->ctx);
 	if (self->doc != NULL)
 		xmlFreeDoc (self->doc);
+	if (self->descriptor != NULL)
+		g_bytes_unref (self->descriptor);
+	g_free (self->name);
+	g_free (self->description);
+	if (self->files != NULL)
+		g_ptr_array_unref (self->files);
+	if (self->files_by_id != NULL)
+		g_hash_table_unref (self->files_by_id);
+	if (self->disks_by_id != NULL)
+		g_hash_table_unref (self->disks_by_id);
+	if (self->extract_options != NULL)
+		g_object_unref (self->extract_options);
+	g_free (self->cache_dir);
 
-	g_free (self->ova_filename);
+	ova_clear_source (self);
+	g_mutex_clear (&self->stats_mutex);
 
 	G_OBJECT_CLASS (govf_package_parent_class)->finalize (object);
 }
@@ -622,4 +5326,6 @@ govf_package_class_init (GovfPackageClass *klass)
 static void
 govf_package_init (GovfPackage *self)
 {
+	self->extract_threads = EXTRACT_THREADS_DEFAULT;
+	g_mutex_init (&self->stats_mutex);
 }
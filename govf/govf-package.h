@@ -22,6 +22,9 @@
 #define __GOVF_PACKAGE_H__
 
 #include "govf-disk.h"
+#include "govf-extract-options.h"
+#include "govf-extraction.h"
+#include "govf-file.h"
 
 #include <gio/gio.h>
 #include <glib.h>
@@ -39,15 +42,109 @@ typedef enum
 	GOVF_PACKAGE_ERROR_FAILED,
 	GOVF_PACKAGE_ERROR_NOT_FOUND,
 	GOVF_PACKAGE_ERROR_XML,
+	GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH,
 	GOVF_PACKAGE_ERROR_LAST
 } GovfPackageError;
 
+/**
+ * GovfLoadFlags:
+ * @GOVF_LOAD_FLAGS_NONE: No flags set
+ * @GOVF_LOAD_FLAGS_STREAMING: Parse the OVF descriptor in a single streaming
+ *   pass instead of building a document tree up front; the tree is only
+ *   built when the package is saved
+ * @GOVF_LOAD_FLAGS_METADATA_ONLY: Fail rather than read the data of disks
+ *   stored in front of the descriptor in an .ova that is compressed or
+ *   cannot be seeked in
+ * @GOVF_LOAD_FLAGS_DETACHED: Free the document tree once the disks, files
+ *   and summary have been picked out of it, keeping only the descriptor;
+ *   the tree is built again when the package is saved
+ *
+ * Flags controlling how a package is loaded.
+ */
+typedef enum
+{
+	GOVF_LOAD_FLAGS_NONE		= 0,
+	GOVF_LOAD_FLAGS_STREAMING	= 1 << 0,
+	GOVF_LOAD_FLAGS_METADATA_ONLY	= 1 << 1,
+	GOVF_LOAD_FLAGS_DETACHED	= 1 << 2
+} GovfLoadFlags;
+
+/**
+ * GovfPackageStat:
+ * @GOVF_PACKAGE_STAT_HEADERS_SCANNED: Archive member headers read
+ * @GOVF_PACKAGE_STAT_MEMBERS_VISITED: Archive members whose data was read
+ * @GOVF_PACKAGE_STAT_BYTES_READ: Bytes read from the .ova file or stream
+ * @GOVF_PACKAGE_STAT_BYTES_SKIPPED: Bytes of the .ova file or stream
+ *   seeked over instead of read
+ * @GOVF_PACKAGE_STAT_BYTES_WRITTEN: Bytes written to extracted disks
+ * @GOVF_PACKAGE_STAT_SCAN_USEC: Time spent scanning the archive for the
+ *   descriptor and the location of its members, or looking them up in the
+ *   cache, in microseconds
+ * @GOVF_PACKAGE_STAT_PARSE_USEC: Time spent parsing the descriptor, in
+ *   microseconds
+ * @GOVF_PACKAGE_STAT_XPATH_USEC: Time spent evaluating XPath expressions
+ *   on the parsed descriptor, in microseconds
+ * @GOVF_PACKAGE_STAT_EXTRACT_USEC: Time spent extracting disks, in
+ *   microseconds; disks extracted concurrently add up
+ * @GOVF_PACKAGE_STAT_CACHE_HITS: Loads answered from the cache directory,
+ *   see govf_package_set_cache_dir()
+ * @GOVF_PACKAGE_STAT_LAST: The number of statistics
+ *
+ * Statistics collected by a #GovfPackage, see govf_package_get_stat().
+ */
+typedef enum
+{
+	GOVF_PACKAGE_STAT_HEADERS_SCANNED,
+	GOVF_PACKAGE_STAT_MEMBERS_VISITED,
+	GOVF_PACKAGE_STAT_BYTES_READ,
+	GOVF_PACKAGE_STAT_BYTES_SKIPPED,
+	GOVF_PACKAGE_STAT_BYTES_WRITTEN,
+	GOVF_PACKAGE_STAT_SCAN_USEC,
+	GOVF_PACKAGE_STAT_PARSE_USEC,
+	GOVF_PACKAGE_STAT_XPATH_USEC,
+	GOVF_PACKAGE_STAT_EXTRACT_USEC,
+	GOVF_PACKAGE_STAT_CACHE_HITS,
+	GOVF_PACKAGE_STAT_LAST
+} GovfPackageStat;
+
 GQuark			  govf_package_error_quark		(void);
 
 GovfPackage		 *govf_package_new			(void);
+GovfLoadFlags		  govf_package_get_load_flags		(GovfPackage		 *self);
+void			  govf_package_set_load_flags		(GovfPackage		 *self,
+								 GovfLoadFlags		  flags);
+guint64			  govf_package_get_bytes_read		(GovfPackage		 *self);
+guint64			  govf_package_get_stat			(GovfPackage		 *self,
+								 GovfPackageStat	  stat);
+void			  govf_package_reset_stats		(GovfPackage		 *self);
+GovfExtractOptions	 *govf_package_get_extract_options	(GovfPackage		 *self);
+void			  govf_package_set_extract_options	(GovfPackage		 *self,
+								 GovfExtractOptions	 *options);
+guint			  govf_package_get_extract_threads	(GovfPackage		 *self);
+void			  govf_package_set_extract_threads	(GovfPackage		 *self,
+								 guint			  n_threads);
+const gchar		 *govf_package_get_cache_dir		(GovfPackage		 *self);
+void			  govf_package_set_cache_dir		(GovfPackage		 *self,
+								 const gchar		 *cache_dir);
 gboolean		  govf_package_load_from_ova_file	(GovfPackage		 *self,
 								 const gchar		 *filename,
 								 GError			**error);
+void			  govf_package_load_from_ova_file_async	(GovfPackage		 *self,
+								 const gchar		 *filename,
+								 GCancellable		 *cancellable,
+								 GAsyncReadyCallback	  callback,
+								 gpointer		  user_data);
+gboolean		  govf_package_load_from_ova_file_finish (GovfPackage		 *self,
+								 GAsyncResult		 *result,
+								 GError			**error);
+gboolean		  govf_package_load_from_stream		(GovfPackage		 *self,
+								 GInputStream		 *stream,
+								 GCancellable		 *cancellable,
+								 GError			**error);
+gboolean		  govf_package_load_from_gfile		(GovfPackage		 *self,
+								 GFile			 *file,
+								 GCancellable		 *cancellable,
+								 GError			**error);
 gboolean		  govf_package_load_from_file		(GovfPackage		 *self,
 								 const gchar		 *filename,
 								 GError			**error);
@@ -58,11 +155,48 @@ gboolean		  govf_package_load_from_data		(GovfPackage		 *self,
 gboolean		  govf_package_save_file		(GovfPackage		 *self,
 								 const gchar		 *filename,
 								 GError			**error);
+gboolean		  govf_package_save_to_stream		(GovfPackage		 *self,
+								 GOutputStream		 *stream,
+								 GCancellable		 *cancellable,
+								 GError			**error);
+const gchar		 *govf_package_get_name			(GovfPackage		 *self);
+const gchar		 *govf_package_get_description		(GovfPackage		 *self);
+const gchar		 *govf_package_get_os_id		(GovfPackage		 *self);
 GPtrArray		 *govf_package_get_disks		(GovfPackage		 *self);
+GPtrArray		 *govf_package_get_files		(GovfPackage		 *self);
+GovfFile		 *govf_package_lookup_file		(GovfPackage		 *self,
+								 const gchar		 *file_id);
+GovfDisk		 *govf_package_lookup_disk		(GovfPackage		 *self,
+								 const gchar		 *disk_id);
 gboolean		  govf_package_extract_disk		(GovfPackage		 *self,
 								 GovfDisk		 *disk,
 								 const gchar		 *save_path,
 								 GError			**error);
+GInputStream		 *govf_package_open_disk		(GovfPackage		 *self,
+								 GovfDisk		 *disk,
+								 GError			**error);
+void			  govf_package_extract_disk_async	(GovfPackage		 *self,
+								 GovfDisk		 *disk,
+								 const gchar		 *save_path,
+								 GCancellable		 *cancellable,
+								 GFileProgressCallback	  progress_callback,
+								 gpointer		  progress_data,
+								 GAsyncReadyCallback	  callback,
+								 gpointer		  user_data);
+gboolean		  govf_package_extract_disk_finish	(GovfPackage		 *self,
+								 GAsyncResult		 *result,
+								 GError			**error);
+gboolean		  govf_package_extract_disks		(GovfPackage		 *self,
+								 GPtrArray		 *extractions,
+								 GError			**error);
+gboolean		  govf_package_verify			(GovfPackage		 *self,
+								 GCancellable		 *cancellable,
+								 GError			**error);
+gboolean		  govf_package_write_ova		(GovfPackage		 *self,
+								 const gchar		 *filename,
+								 const gchar		 *source_dir,
+								 GCancellable		 *cancellable,
+								 GError			**error);
 
 G_END_DECLS
 
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_TRACE_PRIVATE_H__
+#define __GOVF_TRACE_PRIVATE_H__
+
+#include "config.h"
+
+#include <glib.h>
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+G_BEGIN_DECLS
+
+/* USDT probes in the "libgovf" provider; each is a single nop until a
+ * tracer attaches to it */
+#ifdef HAVE_SYS_SDT_H
+#define GOVF_PROBE1(name, arg1)			DTRACE_PROBE1 (libgovf, name, arg1)
+#define GOVF_PROBE2(name, arg1, arg2)		DTRACE_PROBE2 (libgovf, name, arg1, arg2)
+#else
+#define GOVF_PROBE1(name, arg1)			G_STMT_START { } G_STMT_END
+#define GOVF_PROBE2(name, arg1, arg2)		G_STMT_START { } G_STMT_END
+#endif
+
+/* adds a mark spanning from @begin, a g_get_monotonic_time() timestamp,
+ * until now to a running sysprof capture */
+static inline void
+govf_trace_mark (gint64       begin,
+                 const gchar *name,
+                 const gchar *message)
+{
+#ifdef HAVE_SYSPROF
+	sysprof_collector_mark (begin * 1000,
+	                        (g_get_monotonic_time () - begin) * 1000,
+	                        "libgovf",
+	                        name,
+	                        message);
+#endif
+}
+
+G_END_DECLS
+
+#endif /* __GOVF_TRACE_PRIVATE_H__ */
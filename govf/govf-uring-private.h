@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_URING_PRIVATE_H__
+#define __GOVF_URING_PRIVATE_H__
+
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "govf-hasher-private.h"
+
+G_BEGIN_DECLS
+
+/* copies a byte range between two files with io_uring; only built with
+ * liburing */
+typedef struct _GovfUring GovfUring;
+
+/* called with the length of every block once it has been written */
+typedef void		(*GovfUringWrittenFunc)		(gsize			  len,
+							 gpointer		  user_data);
+
+GovfUring		 *govf_uring_new		(gint			  in_fd,
+							 gint64			  offset,
+							 gint64			  size,
+							 gint			  out_fd,
+							 gsize			  block_size);
+gboolean		  govf_uring_copy		(GovfUring		 *uring,
+							 GovfHasher		 *hasher,
+							 GovfUringWrittenFunc	  written_func,
+							 gpointer		  written_data,
+							 goffset		 *bytes_read,
+							 GCancellable		 *cancellable,
+							 GError			**error);
+void			  govf_uring_free		(GovfUring		 *uring);
+
+G_END_DECLS
+
+#endif /* __GOVF_URING_PRIVATE_H__ */
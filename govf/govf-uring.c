@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "govf-uring-private.h"
+#include "govf-package.h"
+
+#ifdef HAVE_LIBURING
+#include <errno.h>
+#include <liburing.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define URING_QUEUE_DEPTH 8
+#define URING_BUFFER_ALIGNMENT 4096
+
+/* one block of the member, read into a buffer and written back out; slot
+ * k carries blocks k, k + URING_QUEUE_DEPTH, ... so that they can be
+ * hashed in order */
+typedef struct
+{
+	gchar			 *buf;
+	guint64			  block;
+	gsize			  len;
+	gsize			  done;
+	gboolean		  writing;
+	gboolean		  ready;
+	gboolean		  busy;
+} GovfUringSlot;
+
+struct _GovfUring
+{
+	struct io_uring		  ring;
+	GovfUringSlot		  slots[URING_QUEUE_DEPTH];
+	gboolean		  fixed;
+	gint			  in_fd;
+	gint			  out_fd;
+	gint64			  in_offset;
+	gint64			  out_offset;
+	gint64			  size;
+	gsize			  block_size;
+	guint			  in_flight;
+};
+
+/* page aligned, like the buffers of the other copy engines */
+static gchar *
+uring_buffer_new (gsize size)
+{
+	void *buf;
+
+	if (posix_memalign (&buf, URING_BUFFER_ALIGNMENT, size) != 0)
+		g_error ("Failed to allocate %" G_GSIZE_FORMAT " bytes", size);
+
+	return buf;
+}
+
+static void
+uring_submit (GovfUring *uring, guint index)
+{
+	GovfUringSlot *slot = &uring->slots[index];
+	struct io_uring_sqe *sqe;
+	gint64 pos = slot->block * uring->block_size + slot->done;
+	gchar *buf = slot->buf + slot->done;
+	gsize len = slot->len - slot->done;
+
+	/* the ring has room for every slot */
+	sqe = io_uring_get_sqe (&uring->ring);
+	g_assert (sqe != NULL);
+
+	if (slot->writing && uring->fixed)
+		io_uring_prep_write_fixed (sqe, uring->out_fd, buf, len, uring->out_offset + pos, index);
+	else if (slot->writing)
+		io_uring_prep_write (sqe, uring->out_fd, buf, len, uring->out_offset + pos);
+	else if (uring->fixed)
+		io_uring_prep_read_fixed (sqe, uring->in_fd, buf, len, uring->in_offset + pos, index);
+	else
+		io_uring_prep_read (sqe, uring->in_fd, buf, len, uring->in_offset + pos);
+	io_uring_sqe_set_data (sqe, slot);
+
+	slot->busy = TRUE;
+	uring->in_flight++;
+}
+
+/* starts reading the next block that belongs to the slot, if any */
+static void
+uring_read_block (GovfUring *uring, guint index, guint64 block)
+{
+	GovfUringSlot *slot = &uring->slots[index];
+	gint64 pos = block * uring->block_size;
+
+	if (pos >= uring->size)
+		return;
+
+	slot->block = block;
+	slot->len = MIN ((gint64) uring->block_size, uring->size - pos);
+	slot->done = 0;
+	slot->writing = FALSE;
+	slot->ready = FALSE;
+	uring_submit (uring, index);
+}
+
+static struct io_uring_cqe *
+uring_wait (GovfUring *uring, GError **error)
+{
+	struct io_uring_cqe *cqe = NULL;
+	int r;
+
+	io_uring_submit (&uring->ring);
+	do {
+		r = io_uring_wait_cqe (&uring->ring, &cqe);
+	} while (r == -EINTR);
+	if (r < 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot copy: %s",
+		             g_strerror (-r));
+		return NULL;
+	}
+
+	return cqe;
+}
+
+/* the kernel may still be using the buffers of whatever is in flight */
+static void
+uring_drain (GovfUring *uring)
+{
+	while (uring->in_flight > 0) {
+		struct io_uring_cqe *cqe = uring_wait (uring, NULL);
+
+		if (cqe == NULL)
+			break;
+		io_uring_cqe_seen (&uring->ring, cqe);
+		uring->in_flight--;
+	}
+}
+
+/* copies the byte range keeping several reads and writes in flight,
+ * hashing the blocks in order as they come in */
+gboolean
+govf_uring_copy (GovfUring             *uring,
+                 GovfHasher            *hasher,
+                 GovfUringWrittenFunc   written_func,
+                 gpointer               written_data,
+                 goffset               *bytes_read,
+                 GCancellable          *cancellable,
+                 GError               **error)
+{
+	guint64 next_hashed = 0;
+	guint i;
+
+	for (i = 0; i < URING_QUEUE_DEPTH; i++)
+		uring_read_block (uring, i, i);
+
+	while (uring->in_flight > 0) {
+		struct io_uring_cqe *cqe;
+		GovfUringSlot *slot;
+		gint res;
+
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return FALSE;
+
+		cqe = uring_wait (uring, error);
+		if (cqe == NULL)
+			return FALSE;
+		slot = io_uring_cqe_get_data (cqe);
+		res = cqe->res;
+		io_uring_cqe_seen (&uring->ring, cqe);
+		uring->in_flight--;
+		slot->busy = FALSE;
+
+		if (res == -EINTR || res == -EAGAIN) {
+			uring_submit (uring, slot - uring->slots);
+			continue;
+		}
+		if (res < 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             slot->writing ? "Cannot write: %s" : "Cannot read: %s",
+			             g_strerror (-res));
+			return FALSE;
+		}
+		if (res == 0 && !slot->writing) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Unexpected end of archive");
+			return FALSE;
+		}
+
+		/* short reads and writes carry on where they stopped */
+		slot->done += res;
+		if (slot->done < slot->len) {
+			uring_submit (uring, slot - uring->slots);
+			continue;
+		}
+
+		if (slot->writing) {
+			written_func (slot->len, written_data);
+			uring_read_block (uring,
+			                  slot - uring->slots,
+			                  slot->block + URING_QUEUE_DEPTH);
+			continue;
+		}
+
+		/* write out every block that is next in line */
+		*bytes_read += slot->len;
+		slot->ready = TRUE;
+		for (;;) {
+			guint index = next_hashed % URING_QUEUE_DEPTH;
+			GovfUringSlot *next = &uring->slots[index];
+
+			if (next->busy || !next->ready || next->block != next_hashed)
+				break;
+			if (hasher != NULL)
+				govf_hasher_update (hasher, next->buf, next->len);
+			next->ready = FALSE;
+			next->writing = TRUE;
+			next->done = 0;
+			uring_submit (uring, index);
+			next_hashed++;
+		}
+	}
+
+	if (lseek (uring->out_fd, uring->out_offset + uring->size, SEEK_SET) < 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot seek: %s",
+		             g_strerror (errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* sets up a ring with a buffer per slot, registered with the kernel where
+ * the locked memory limit allows; fails if io_uring isn't available */
+GovfUring *
+govf_uring_new (gint    in_fd,
+                gint64  offset,
+                gint64  size,
+                gint    out_fd,
+                gsize   block_size)
+{
+	GovfUring *uring;
+	struct iovec iovecs[URING_QUEUE_DEPTH];
+	off_t out_offset;
+	guint i;
+
+	out_offset = lseek (out_fd, 0, SEEK_CUR);
+	if (out_offset < 0)
+		return NULL;
+
+	uring = g_slice_new0 (GovfUring);
+	if (io_uring_queue_init (URING_QUEUE_DEPTH, &uring->ring, 0) < 0) {
+		g_slice_free (GovfUring, uring);
+		return NULL;
+	}
+
+	uring->in_fd = in_fd;
+	uring->out_fd = out_fd;
+	uring->in_offset = offset;
+	uring->out_offset = out_offset;
+	uring->size = size;
+	uring->block_size = block_size;
+	for (i = 0; i < URING_QUEUE_DEPTH; i++) {
+		uring->slots[i].buf = uring_buffer_new (block_size);
+		iovecs[i].iov_base = uring->slots[i].buf;
+		iovecs[i].iov_len = uring->block_size;
+	}
+	uring->fixed = io_uring_register_buffers (&uring->ring, iovecs, URING_QUEUE_DEPTH) == 0;
+
+	return uring;
+}
+
+void
+govf_uring_free (GovfUring *uring)
+{
+	guint i;
+
+	uring_drain (uring);
+	io_uring_queue_exit (&uring->ring);
+	for (i = 0; i < URING_QUEUE_DEPTH; i++)
+		free (uring->slots[i].buf);
+	g_slice_free (GovfUring, uring);
+}
+#endif /* HAVE_LIBURING */
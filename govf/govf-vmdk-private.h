@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __GOVF_VMDK_PRIVATE_H__
+#define __GOVF_VMDK_PRIVATE_H__
+
+#include <gio/gio.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* reads up to count bytes of the VMDK, returning 0 at the end and -1 on
+ * error */
+typedef gssize		(*GovfVmdkReadFunc)		(gpointer		  user_data,
+							 gpointer		  buf,
+							 gsize			  count,
+							 GError			**error);
+
+gboolean		  govf_vmdk_convert_to_raw	(GovfVmdkReadFunc	  read_func,
+							 gpointer		  read_data,
+							 gint			  out_fd,
+							 gboolean		  sparse,
+							 guint			  n_threads,
+							 guint64		 *size,
+							 guint64		 *bytes_written,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __GOVF_VMDK_PRIVATE_H__ */
@@ -0,0 +1,530 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "govf-vmdk-private.h"
+#include "govf-package.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define VMDK_SECTOR_SIZE 512
+#define VMDK_MAGIC 0x564d444b /* "KDMV" */
+#define VMDK_FLAG_COMPRESSED (1 << 16)
+#define VMDK_FLAG_MARKERS (1 << 17)
+#define VMDK_COMPRESSION_DEFLATE 1
+#define VMDK_MARKER_HEADER_SIZE 12
+#define VMDK_MARKER_EOS 0
+#define VMDK_MAX_GRAIN_SIZE (16 * 1024 * 1024)
+#define VMDK_GRAINS_IN_FLIGHT_PER_THREAD 4
+#define VMDK_SKIP_BUFFER_SIZE (64 * 1024)
+
+/* state shared between the parsing thread and the inflating workers */
+typedef struct
+{
+	guint64			  capacity;
+	gsize			  grain_size;
+	gint			  out_fd;
+	gboolean		  sparse;
+	GAsyncQueue		 *decompressors;
+	GMutex			  mutex;
+	GCond			  cond;
+	guint			  in_flight;
+	guint			  max_in_flight;
+	guint64			  bytes_written;
+	GError			 *error;
+} GovfVmdkConverter;
+
+/* a compressed grain waiting to be inflated */
+typedef struct
+{
+	guint64			  offset;
+	gchar			 *data;
+	gsize			  size;
+} GovfVmdkGrain;
+
+static void
+vmdk_grain_free (GovfVmdkGrain *grain)
+{
+	g_free (grain->data);
+	g_slice_free (GovfVmdkGrain, grain);
+}
+
+static gboolean
+read_exact (GovfVmdkReadFunc   read_func,
+            gpointer           read_data,
+            gpointer           buf,
+            gsize              count,
+            GError           **error)
+{
+	while (count > 0) {
+		gssize n = read_func (read_data, buf, count, error);
+		if (n < 0)
+			return FALSE;
+		if (n == 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Unexpected end of VMDK disk image");
+			return FALSE;
+		}
+		buf = (gchar *) buf + n;
+		count -= n;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+read_skip (GovfVmdkReadFunc   read_func,
+           gpointer           read_data,
+           guint64            count,
+           GError           **error)
+{
+	g_autofree gchar *buf = NULL;
+
+	buf = g_malloc (VMDK_SKIP_BUFFER_SIZE);
+	while (count > 0) {
+		gsize n = MIN (count, VMDK_SKIP_BUFFER_SIZE);
+		if (!read_exact (read_func, read_data, buf, n, error))
+			return FALSE;
+		count -= n;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+pwrite_all (gint          fd,
+            const gchar  *buf,
+            gsize         count,
+            guint64       offset,
+            GError      **error)
+{
+	while (count > 0) {
+		gssize n = pwrite (fd, buf, count, offset);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Cannot write: %s",
+			             g_strerror (errno));
+			return FALSE;
+		}
+		buf += n;
+		count -= n;
+		offset += n;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+grain_is_zero (const gchar *buf, gsize len)
+{
+	return len == 0 || (buf[0] == 0 && memcmp (buf, buf + 1, len - 1) == 0);
+}
+
+static gboolean
+inflate_grain (GConverter     *decompressor,
+               const gchar    *in,
+               gsize           in_size,
+               gchar          *out,
+               gsize           out_size,
+               GError        **error)
+{
+	gsize in_total = 0;
+	gsize out_total = 0;
+
+	for (;;) {
+		GConverterResult res;
+		gsize bytes_read;
+		gsize bytes_written;
+
+		res = g_converter_convert (decompressor,
+		                           in + in_total,
+		                           in_size - in_total,
+		                           out + out_total,
+		                           out_size - out_total,
+		                           G_CONVERTER_INPUT_AT_END,
+		                           &bytes_read,
+		                           &bytes_written,
+		                           error);
+		if (res == G_CONVERTER_ERROR)
+			return FALSE;
+		in_total += bytes_read;
+		out_total += bytes_written;
+		if (res == G_CONVERTER_FINISHED)
+			break;
+		if (bytes_read == 0 && bytes_written == 0) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Corrupt grain in VMDK disk image");
+			return FALSE;
+		}
+	}
+
+	/* a short grain is padded with zeros */
+	memset (out + out_total, 0, out_size - out_total);
+
+	return TRUE;
+}
+
+/* runs on the thread pool; grains are independent of each other, so any
+ * idle worker picks up the next one and writes it at its own offset */
+static void
+grain_inflate_func (gpointer data, gpointer user_data)
+{
+	GovfVmdkGrain *grain = data;
+	GovfVmdkConverter *conv = user_data;
+	g_autoptr(GError) error = NULL;
+	g_autofree gchar *buf = NULL;
+	GConverter *decompressor;
+	gboolean failed;
+	gsize len = 0;
+
+	g_mutex_lock (&conv->mutex);
+	failed = conv->error != NULL;
+	g_mutex_unlock (&conv->mutex);
+	if (failed)
+		goto out;
+
+	decompressor = g_async_queue_try_pop (conv->decompressors);
+	if (decompressor == NULL)
+		decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB));
+
+	buf = g_malloc (conv->grain_size);
+	len = MIN (conv->grain_size, conv->capacity - grain->offset);
+	if (!inflate_grain (decompressor, grain->data, grain->size, buf, conv->grain_size, &error))
+		len = 0;
+	else if (conv->sparse && grain_is_zero (buf, len))
+		len = 0;
+	else if (!pwrite_all (conv->out_fd, buf, len, grain->offset, &error))
+		len = 0;
+
+	g_converter_reset (decompressor);
+	g_async_queue_push (conv->decompressors, decompressor);
+
+out:
+	g_mutex_lock (&conv->mutex);
+	if (error != NULL && conv->error == NULL)
+		conv->error = g_steal_pointer (&error);
+	conv->bytes_written += len;
+	conv->in_flight--;
+	g_cond_signal (&conv->cond);
+	g_mutex_unlock (&conv->mutex);
+
+	vmdk_grain_free (grain);
+}
+
+/* holds back the parser so that only a bounded number of compressed grains
+ * are kept in memory; returns FALSE once a worker has failed */
+static gboolean
+converter_reserve (GovfVmdkConverter *conv)
+{
+	gboolean ret;
+
+	g_mutex_lock (&conv->mutex);
+	while (conv->in_flight >= conv->max_in_flight && conv->error == NULL)
+		g_cond_wait (&conv->cond, &conv->mutex);
+	ret = conv->error == NULL;
+	if (ret)
+		conv->in_flight++;
+	g_mutex_unlock (&conv->mutex);
+
+	return ret;
+}
+
+/* grains that are missing from the stream read back as zeros; they only
+ * need writing out when the output shouldn't have holes */
+static gboolean
+converter_fill_gaps (GovfVmdkConverter  *conv,
+                     const guint8       *present,
+                     GError            **error)
+{
+	g_autofree gchar *zeros = NULL;
+	guint64 offset;
+	guint64 i;
+
+	zeros = g_malloc0 (conv->grain_size);
+	for (i = 0, offset = 0; offset < conv->capacity; i++, offset += conv->grain_size) {
+		gsize len;
+
+		if (present[i / 8] & (1 << (i % 8)))
+			continue;
+		len = MIN (conv->grain_size, conv->capacity - offset);
+		if (!pwrite_all (conv->out_fd, zeros, len, offset, error))
+			return FALSE;
+		conv->bytes_written += len;
+	}
+
+	return TRUE;
+}
+
+/**
+ * govf_vmdk_convert_to_raw:
+ * @read_func: function reading the VMDK sequentially
+ * @read_data: data for @read_func
+ * @out_fd: file descriptor to write the raw image to
+ * @sparse: whether to leave holes instead of writing zeros
+ * @n_threads: the number of threads inflating grains, or 0 for one per
+ *   processor
+ * @size: (out): return location for the size of the raw image
+ * @bytes_written: (out): return location for the number of bytes written
+ * @error: a #GError or %NULL
+ *
+ * Converts a streamOptimized VMDK disk image to a raw image. The VMDK is
+ * parsed in a single forward pass, while the grains are inflated and
+ * written out on a pool of threads.
+ *
+ * Returns: %TRUE if the conversion succeeded
+ */
+gboolean
+govf_vmdk_convert_to_raw (GovfVmdkReadFunc   read_func,
+                          gpointer           read_data,
+                          gint               out_fd,
+                          gboolean           sparse,
+                          guint              n_threads,
+                          guint64           *size,
+                          guint64           *bytes_written,
+                          GError           **error)
+{
+	GovfVmdkConverter conv = { 0, };
+	GThreadPool *pool = NULL;
+	g_autofree guint8 *present = NULL;
+	guchar header[VMDK_SECTOR_SIZE];
+	guint32 magic;
+	guint32 flags;
+	guint16 compression;
+	guint64 capacity;
+	guint64 grain_sectors;
+	guint64 overhead;
+	gboolean ret = TRUE;
+	struct stat st;
+
+	/* the fields of the little endian sparse extent header are packed */
+	if (!read_exact (read_func, read_data, header, sizeof (header), error))
+		return FALSE;
+	memcpy (&magic, header, 4);
+	memcpy (&flags, header + 8, 4);
+	memcpy (&capacity, header + 12, 8);
+	memcpy (&grain_sectors, header + 20, 8);
+	memcpy (&overhead, header + 64, 8);
+	memcpy (&compression, header + 77, 2);
+	magic = GUINT32_FROM_LE (magic);
+	flags = GUINT32_FROM_LE (flags);
+	capacity = GUINT64_FROM_LE (capacity);
+	grain_sectors = GUINT64_FROM_LE (grain_sectors);
+	overhead = GUINT64_FROM_LE (overhead);
+	compression = GUINT16_FROM_LE (compression);
+
+	if (magic != VMDK_MAGIC) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Not a VMDK disk image");
+		return FALSE;
+	}
+	if ((flags & VMDK_FLAG_COMPRESSED) == 0 ||
+	    (flags & VMDK_FLAG_MARKERS) == 0 ||
+	    compression != VMDK_COMPRESSION_DEFLATE) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Not a streamOptimized VMDK disk image");
+		return FALSE;
+	}
+	if (grain_sectors == 0 ||
+	    grain_sectors > VMDK_MAX_GRAIN_SIZE / VMDK_SECTOR_SIZE ||
+	    capacity > G_MAXUINT64 / VMDK_SECTOR_SIZE ||
+	    overhead == 0 ||
+	    overhead > G_MAXUINT64 / VMDK_SECTOR_SIZE) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Invalid VMDK header");
+		return FALSE;
+	}
+
+	conv.capacity = capacity * VMDK_SECTOR_SIZE;
+	conv.grain_size = grain_sectors * VMDK_SECTOR_SIZE;
+	conv.out_fd = out_fd;
+	conv.sparse = sparse;
+
+	if (!sparse) {
+		guint64 n_grains = (capacity + grain_sectors - 1) / grain_sectors;
+		present = g_try_malloc0 (n_grains / 8 + 1);
+		if (present == NULL) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "VMDK disk image is too large");
+			return FALSE;
+		}
+	}
+
+	/* the embedded descriptor is of no use for the raw image */
+	if (!read_skip (read_func, read_data, (overhead - 1) * VMDK_SECTOR_SIZE, error))
+		return FALSE;
+
+	if (n_threads == 0)
+		n_threads = MAX (g_get_num_processors (), 1);
+	conv.max_in_flight = n_threads * VMDK_GRAINS_IN_FLIGHT_PER_THREAD;
+	conv.decompressors = g_async_queue_new_full (g_object_unref);
+	g_mutex_init (&conv.mutex);
+	g_cond_init (&conv.cond);
+	pool = g_thread_pool_new (grain_inflate_func, &conv, n_threads, FALSE, NULL);
+
+	for (;;) {
+		guchar marker[VMDK_SECTOR_SIZE];
+		GovfVmdkGrain *grain;
+		guint64 value;
+		guint32 marker_size;
+		gsize padded_size;
+
+		if (!read_exact (read_func, read_data, marker, VMDK_MARKER_HEADER_SIZE, error)) {
+			ret = FALSE;
+			goto out;
+		}
+		memcpy (&value, marker, 8);
+		memcpy (&marker_size, marker + 8, 4);
+		value = GUINT64_FROM_LE (value);
+		marker_size = GUINT32_FROM_LE (marker_size);
+
+		/* metadata markers take up a sector of their own and are
+		 * followed by value sectors of grain tables or directories */
+		if (marker_size == 0) {
+			guint32 type;
+
+			if (!read_exact (read_func,
+			                 read_data,
+			                 marker + VMDK_MARKER_HEADER_SIZE,
+			                 VMDK_SECTOR_SIZE - VMDK_MARKER_HEADER_SIZE,
+			                 error)) {
+				ret = FALSE;
+				goto out;
+			}
+			memcpy (&type, marker + VMDK_MARKER_HEADER_SIZE, 4);
+			if (GUINT32_FROM_LE (type) == VMDK_MARKER_EOS)
+				break;
+			if (value > G_MAXUINT64 / VMDK_SECTOR_SIZE) {
+				g_set_error (error,
+				             GOVF_PACKAGE_ERROR,
+				             GOVF_PACKAGE_ERROR_FAILED,
+				             "Invalid VMDK marker");
+				ret = FALSE;
+				goto out;
+			}
+			if (!read_skip (read_func, read_data, value * VMDK_SECTOR_SIZE, error)) {
+				ret = FALSE;
+				goto out;
+			}
+			continue;
+		}
+
+		/* grain markers hold the grain's first sector and are padded
+		 * to a sector boundary */
+		if (value >= capacity ||
+		    value % grain_sectors != 0 ||
+		    marker_size > 2 * conv.grain_size) {
+			g_set_error (error,
+			             GOVF_PACKAGE_ERROR,
+			             GOVF_PACKAGE_ERROR_FAILED,
+			             "Invalid VMDK grain marker");
+			ret = FALSE;
+			goto out;
+		}
+
+		padded_size = VMDK_MARKER_HEADER_SIZE + marker_size;
+		padded_size = (padded_size + VMDK_SECTOR_SIZE - 1) / VMDK_SECTOR_SIZE * VMDK_SECTOR_SIZE;
+		padded_size -= VMDK_MARKER_HEADER_SIZE;
+
+		grain = g_slice_new (GovfVmdkGrain);
+		grain->offset = value * VMDK_SECTOR_SIZE;
+		grain->size = marker_size;
+		grain->data = g_malloc (padded_size);
+		if (!read_exact (read_func, read_data, grain->data, padded_size, error)) {
+			vmdk_grain_free (grain);
+			ret = FALSE;
+			goto out;
+		}
+
+		if (present != NULL) {
+			guint64 i = value / grain_sectors;
+			present[i / 8] |= 1 << (i % 8);
+		}
+
+		/* a failed worker stores its error for after the pool drains */
+		if (!converter_reserve (&conv)) {
+			vmdk_grain_free (grain);
+			break;
+		}
+		g_thread_pool_push (pool, grain, NULL);
+	}
+
+out:
+	/* wait for the grains already handed out */
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	if (!ret)
+		goto cleanup;
+	if (conv.error != NULL) {
+		g_propagate_error (error, g_steal_pointer (&conv.error));
+		ret = FALSE;
+		goto cleanup;
+	}
+
+	if (present != NULL && !converter_fill_gaps (&conv, present, error)) {
+		ret = FALSE;
+		goto cleanup;
+	}
+
+	/* trailing holes only show up in the size of a regular file */
+	if (fstat (out_fd, &st) == 0 && S_ISREG (st.st_mode) &&
+	    (guint64) st.st_size < conv.capacity &&
+	    ftruncate (out_fd, conv.capacity) != 0) {
+		g_set_error (error,
+		             GOVF_PACKAGE_ERROR,
+		             GOVF_PACKAGE_ERROR_FAILED,
+		             "Cannot write: %s",
+		             g_strerror (errno));
+		ret = FALSE;
+		goto cleanup;
+	}
+
+	if (size != NULL)
+		*size = conv.capacity;
+	if (bytes_written != NULL)
+		*bytes_written = conv.bytes_written;
+
+cleanup:
+	g_clear_error (&conv.error);
+	g_async_queue_unref (conv.decompressors);
+	g_mutex_clear (&conv.mutex);
+	g_cond_clear (&conv.cond);
+
+	return ret;
+}
@@ -21,7 +21,12 @@
 #ifndef __GOVF_H__
 #define __GOVF_H__
 
+#include <govf/govf-catalog.h>
+#include <govf/govf-catalog-entry.h>
 #include <govf/govf-disk.h>
+#include <govf/govf-extract-options.h>
+#include <govf/govf-extraction.h>
+#include <govf/govf-file.h>
 #include <govf/govf-package.h>
 
 #endif /* __GOVF_H__ */
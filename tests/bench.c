@@ -0,0 +1,1077 @@
+/*
+ * Copyright (C) 2016 Kalev Lember <klember@redhat.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/* Measures parsing descriptors, loading .ova files, extracting disks
+ * from them, converting streamOptimized VMDK disks to raw images, the
+ * memory kept by loaded packages and scanning a catalog of them, on a
+ * package generated to the shape given on the command line. The XPath
+ * queries run on each load are timed over a corpus of descriptors of
+ * several shapes instead, or over the .ovf files in --corpus. Every result
+ * is printed as a JSON object on a line of its own, along with the peak
+ * RSS of the process so far; run a single benchmark with --benchmark to
+ * see the peak RSS of just that one.
+ *
+ * Disks are verified against the manifest when extracting, as reflinks
+ * and in-kernel copies would otherwise take over from the copy engines.
+ * The disks converted are VMDKs of --disk-size each, inflated with a
+ * doubling number of threads up to the number of processors. The catalog
+ * is made of distinct packages with small disks, which --drop-cache evicts
+ * from the page cache before each scan. */
+
+#include "config.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <govf/govf-catalog.h>
+#include <govf/govf-disk.h>
+#include <govf/govf-extract-options.h>
+#include <govf/govf-extraction.h>
+#include <govf/govf-package.h>
+#include <libxml/parser.h>
+#include <libxml/xpath.h>
+#include <libxml/xpathInternals.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define BENCH_CHUNK_SIZE (1024 * 1024)
+#define BENCH_CATALOG_DISK_SIZE (64 * 1024)
+#define BENCH_GRAIN_SIZE (64 * 1024)
+#define BENCH_GRAIN_VARIANTS 64
+#define BENCH_XPATH_ROUNDS 100
+
+static gint n_disks = 1;
+static gint n_hardware_items = 16;
+static gint descriptor_size_kib = 0;
+static gint disk_size_mib = 64;
+static gboolean compressed = FALSE;
+static gint iterations = 3;
+static gboolean drop_cache = FALSE;
+static gint n_packages = 1000;
+static gchar *corpus_dir = NULL;
+static gchar **benchmarks = NULL;
+
+static GOptionEntry entries[] = {
+	{ "disks", 'd', 0, G_OPTION_ARG_INT, &n_disks, "Number of disks in the package", "N" },
+	{ "hardware-items", 0, 0, G_OPTION_ARG_INT, &n_hardware_items, "Number of virtual hardware items", "N" },
+	{ "descriptor-size", 0, 0, G_OPTION_ARG_INT, &descriptor_size_kib, "Pad the descriptor to at least this size in KiB", "KIB" },
+	{ "disk-size", 's', 0, G_OPTION_ARG_INT, &disk_size_mib, "Size of each disk in MiB", "MIB" },
+	{ "compressed", 'z', 0, G_OPTION_ARG_NONE, &compressed, "Compress the .ova file with gzip", NULL },
+	{ "iterations", 'i', 0, G_OPTION_ARG_INT, &iterations, "Number of runs of each benchmark", "N" },
+	{ "drop-cache", 0, 0, G_OPTION_ARG_NONE, &drop_cache, "Drop the files from the page cache after extracting, and before scanning a catalog", NULL },
+	{ "packages", 'p', 0, G_OPTION_ARG_INT, &n_packages, "Number of packages kept loaded, or scanned in a catalog", "N" },
+	{ "corpus", 0, 0, G_OPTION_ARG_FILENAME, &corpus_dir, "Time XPath queries on the .ovf files in this directory", "DIR" },
+	{ "benchmark", 'b', 0, G_OPTION_ARG_STRING_ARRAY, &benchmarks, "Only run this benchmark: parse, xpath, load, extract, convert, memory or catalog", "NAME" },
+	{ NULL }
+};
+
+static const struct {
+	const gchar	*name;
+	GovfLoadFlags	 flags;
+} load_modes[] = {
+	{ "xpath", GOVF_LOAD_FLAGS_NONE },
+	{ "streaming", GOVF_LOAD_FLAGS_STREAMING },
+	{ "detached", GOVF_LOAD_FLAGS_DETACHED },
+	{ "metadata-only", GOVF_LOAD_FLAGS_METADATA_ONLY },
+};
+
+static const struct {
+	const gchar	*name;
+	GovfIoFlags	 flags;
+} engines[] = {
+	{ "readwrite", GOVF_IO_FLAGS_NONE },
+	{ "io_uring", GOVF_IO_FLAGS_IO_URING },
+};
+
+/* the queries govf-package.c runs on every load */
+static const gchar *xpath_exprs[] = {
+	"/ovf:Envelope[1]/ovf:VirtualSystem",
+	"/ovf:Envelope[1]/ovf:VirtualSystem/ovf:OperatingSystemSection",
+	"/ovf:Envelope[1]/ovf:VirtualSystem/ovf:VirtualHardwareSection",
+	"/ovf:Envelope[1]/ovf:VirtualSystem/ovf:Name",
+	"/ovf:Envelope[1]/ovf:VirtualSystem/@ovf:id",
+	"/ovf:Envelope[1]/ovf:VirtualSystem/ovf:AnnotationSection/ovf:Annotation",
+	"/ovf:Envelope[1]/ovf:VirtualSystem/ovf:OperatingSystemSection/@ovf:id",
+	"/ovf:Envelope[1]/ovf:References/ovf:File",
+	"/ovf:Envelope[1]/ovf:DiskSection/ovf:Disk",
+};
+
+/* the shapes of the generated corpus */
+static const gint corpus_disks[] = { 1, 4, 16, 64 };
+static const gint corpus_hardware_items[] = { 4, 16, 64, 256 };
+
+static glong
+get_max_rss_kib (void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		return -1;
+
+	return usage.ru_maxrss;
+}
+
+/* the current RSS, unlike getrusage() which only has the peak */
+static glong
+get_rss_kib (void)
+{
+	g_autofree gchar *status = NULL;
+	const gchar *line;
+
+	if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+		return -1;
+
+	line = strstr (status, "VmRSS:");
+	if (line == NULL)
+		return -1;
+
+	return strtol (line + strlen ("VmRSS:"), NULL, 10);
+}
+
+static gboolean
+benchmark_enabled (const gchar *name)
+{
+	return benchmarks == NULL || g_strv_contains ((const gchar * const *) benchmarks, name);
+}
+
+/* prints a result, adding the time taken and the peak RSS; @fields is
+ * the rest of the JSON object */
+static void
+print_result (const gchar *benchmark,
+              gint64       start,
+              const gchar *fields)
+{
+	gdouble seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+	g_print ("{\"benchmark\": \"%s\", %s, \"seconds\": %.6f, \"max_rss_kib\": %ld}\n",
+	         benchmark,
+	         fields,
+	         seconds,
+	         get_max_rss_kib ());
+}
+
+/* @name names the virtual system; @vmdk_size is the size of the disk
+ * files when they are streamOptimized VMDKs, or 0 for raw disk files of
+ * @disk_size */
+static gchar *
+create_descriptor (const gchar *name, goffset disk_size, goffset vmdk_size)
+{
+	GString *str;
+	gint i;
+
+	str = g_string_new ("<?xml version=\"1.0\"?>\n"
+	                    "<Envelope ovf:version=\"1.0\" xml:lang=\"en-US\""
+	                    " xmlns=\"http://schemas.dmtf.org/ovf/envelope/1\""
+	                    " xmlns:ovf=\"http://schemas.dmtf.org/ovf/envelope/1\""
+	                    " xmlns:rasd=\"http://schemas.dmtf.org/wbem/wscim/1/cim-schema/2/CIM_ResourceAllocationSettingData\">\n"
+	                    "  <References>\n");
+	for (i = 0; i < n_disks; i++) {
+		g_string_append_printf (str,
+		                        "    <File ovf:href=\"disk%d.img\" ovf:id=\"file%d\" ovf:size=\"%" G_GOFFSET_FORMAT "\"/>\n",
+		                        i, i, vmdk_size > 0 ? vmdk_size : disk_size);
+	}
+	g_string_append (str,
+	                 "  </References>\n"
+	                 "  <DiskSection>\n"
+	                 "    <Info>Virtual disk information</Info>\n");
+	for (i = 0; i < n_disks; i++) {
+		g_string_append_printf (str,
+		                        "    <Disk ovf:capacity=\"%" G_GOFFSET_FORMAT "\" ovf:diskId=\"disk%d\" ovf:fileRef=\"file%d\"%s/>\n",
+		                        disk_size, i, i,
+		                        vmdk_size > 0 ? " ovf:format=\"http://www.vmware.com/interfaces/specifications/vmdk.html#streamOptimized\"" : "");
+	}
+	g_string_append_printf (str,
+	                        "  </DiskSection>\n"
+	                        "  <VirtualSystem ovf:id=\"%s\">\n"
+	                        "    <Info>A virtual machine</Info>\n"
+	                        "    <Name>%s</Name>\n",
+	                        name, name);
+	g_string_append (str,
+	                 "    <AnnotationSection>\n"
+	                 "      <Info>A human-readable annotation</Info>\n"
+	                 "      <Annotation>Generated by the libgovf benchmarks</Annotation>\n"
+	                 "    </AnnotationSection>\n"
+	                 "    <OperatingSystemSection ovf:id=\"80\">\n"
+	                 "      <Info>The kind of installed guest operating system</Info>\n"
+	                 "    </OperatingSystemSection>\n"
+	                 "    <VirtualHardwareSection>\n"
+	                 "      <Info>Virtual hardware requirements</Info>\n");
+	for (i = 0; i < n_hardware_items; i++) {
+		g_string_append_printf (str,
+		                        "      <Item>\n"
+		                        "        <rasd:Description>Hardware item %d</rasd:Description>\n"
+		                        "        <rasd:ElementName>item%d</rasd:ElementName>\n"
+		                        "        <rasd:InstanceID>%d</rasd:InstanceID>\n"
+		                        "        <rasd:ResourceType>%d</rasd:ResourceType>\n"
+		                        "      </Item>\n",
+		                        i, i, i + 1, 10 + i % 10);
+	}
+	g_string_append (str, "    </VirtualHardwareSection>\n");
+
+	/* product properties make up the bulk of some real world descriptors */
+	if ((gsize) descriptor_size_kib * 1024 > str->len) {
+		g_string_append (str,
+		                 "    <ProductSection>\n"
+		                 "      <Info>Information about the installed software</Info>\n");
+		for (i = 0; (gsize) descriptor_size_kib * 1024 > str->len; i++) {
+			g_string_append_printf (str,
+			                        "      <Property ovf:key=\"property%d\" ovf:type=\"string\" ovf:value=\"value%d\">\n"
+			                        "        <Description>Product property number %d</Description>\n"
+			                        "      </Property>\n",
+			                        i, i, i);
+		}
+		g_string_append (str, "    </ProductSection>\n");
+	}
+
+	g_string_append (str,
+	                 "  </VirtualSystem>\n"
+	                 "</Envelope>\n");
+
+	return g_string_free (str, FALSE);
+}
+
+static void
+write_header (struct archive *a, const gchar *name, goffset size)
+{
+	struct archive_entry *entry;
+
+	entry = archive_entry_new ();
+	archive_entry_set_pathname (entry, name);
+	archive_entry_set_size (entry, size);
+	archive_entry_set_filetype (entry, AE_IFREG);
+	archive_entry_set_perm (entry, 0644);
+	g_assert_cmpint (archive_write_header (a, entry), ==, ARCHIVE_OK);
+	archive_entry_free (entry);
+}
+
+static void
+write_member (struct archive *a, const gchar *name, const gchar *contents)
+{
+	write_header (a, name, strlen (contents));
+	g_assert_cmpint (archive_write_data (a, contents, strlen (contents)), ==, strlen (contents));
+}
+
+/* pax headers, as ustar can't hold disks of 8 GiB and more */
+static struct archive *
+open_archive (const gchar *filename)
+{
+	struct archive *a;
+
+	a = archive_write_new ();
+	archive_write_set_format_pax_restricted (a);
+	if (compressed)
+		archive_write_add_filter_gzip (a);
+	g_assert_cmpint (archive_write_open_filename (a, filename), ==, ARCHIVE_OK);
+
+	return a;
+}
+
+/* the digests of the disks are only known once they are written, so the
+ * manifest comes last */
+static void
+create_ova (const gchar *filename,
+            const gchar *descriptor,
+            goffset      disk_size)
+{
+	g_autofree gchar *chunk = NULL;
+	g_autoptr(GRand) rand = NULL;
+	g_autoptr(GString) manifest = NULL;
+	struct archive *a;
+	gsize i;
+	gint j;
+
+	a = open_archive (filename);
+	write_member (a, "bench.ovf", descriptor);
+
+	rand = g_rand_new_with_seed (0);
+	chunk = g_malloc (BENCH_CHUNK_SIZE);
+	for (i = 0; i < BENCH_CHUNK_SIZE / sizeof (guint32); i++)
+		((guint32 *) chunk)[i] = g_rand_int (rand);
+
+	manifest = g_string_new (NULL);
+	for (j = 0; j < n_disks; j++) {
+		g_autofree gchar *name = g_strdup_printf ("disk%d.img", j);
+		g_autoptr(GChecksum) checksum = g_checksum_new (G_CHECKSUM_SHA256);
+		goffset left;
+
+		write_header (a, name, disk_size);
+		for (left = disk_size; left > 0; left -= BENCH_CHUNK_SIZE) {
+			gsize n = MIN (left, BENCH_CHUNK_SIZE);
+
+			/* keep the disks apart */
+			((guint32 *) chunk)[0] = j;
+			g_assert_cmpint (archive_write_data (a, chunk, n), ==, n);
+			g_checksum_update (checksum, (const guchar *) chunk, n);
+		}
+		g_string_append_printf (manifest, "SHA256(%s)= %s\n", name, g_checksum_get_string (checksum));
+	}
+	write_member (a, "bench.mf", manifest->str);
+
+	g_assert_cmpint (archive_write_close (a), ==, ARCHIVE_OK);
+	archive_write_free (a);
+}
+
+static void
+vmdk_put_le32 (guint8 *buf, guint32 value)
+{
+	value = GUINT32_TO_LE (value);
+	memcpy (buf, &value, sizeof (value));
+}
+
+static void
+vmdk_put_le64 (guint8 *buf, guint64 value)
+{
+	value = GUINT64_TO_LE (value);
+	memcpy (buf, &value, sizeof (value));
+}
+
+/* a grain marker followed by the deflated grain, padded to a sector; the
+ * marker is filled in with the offset of each grain it is written for */
+static GByteArray *
+vmdk_grain_new (const guint8 *data)
+{
+	static const guint8 zeros[512] = { 0, };
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GZlibCompressor) compressor = NULL;
+	GByteArray *grain;
+	gsize bytes_read;
+	gsize bytes_written;
+
+	grain = g_byte_array_sized_new (12 + 2 * BENCH_GRAIN_SIZE);
+	g_byte_array_set_size (grain, 12 + 2 * BENCH_GRAIN_SIZE);
+	compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1);
+	if (g_converter_convert (G_CONVERTER (compressor),
+	                         data,
+	                         BENCH_GRAIN_SIZE,
+	                         grain->data + 12,
+	                         2 * BENCH_GRAIN_SIZE,
+	                         G_CONVERTER_INPUT_AT_END,
+	                         &bytes_read,
+	                         &bytes_written,
+	                         &error) != G_CONVERTER_FINISHED)
+		g_error ("Cannot compress a grain: %s", error != NULL ? error->message : "short output");
+
+	g_byte_array_set_size (grain, 12 + bytes_written);
+	vmdk_put_le32 (grain->data + 8, bytes_written);
+	if (grain->len % 512 != 0)
+		g_byte_array_append (grain, zeros, 512 - grain->len % 512);
+
+	return grain;
+}
+
+/* writes a streamOptimized VMDK of @disk_size, with grains that are half
+ * random and half text so that inflating them does real work, and every
+ * eighth grain left out as if it were all zeros; the grain tables are
+ * left out too, as converting only follows the grain markers. Returns
+ * the size of the VMDK. */
+static goffset
+create_vmdk (const gchar *filename, goffset disk_size)
+{
+	static const gchar descriptor[] = "# Disk DescriptorFile\ncreateType=\"streamOptimized\"\n";
+	g_autofree guint8 *data = NULL;
+	g_autoptr(GPtrArray) grains = NULL;
+	g_autoptr(GRand) rand = NULL;
+	guint8 sector[512] = { 0, };
+	goffset offset;
+	goffset vmdk_size = 0;
+	gboolean failed;
+	FILE *f;
+	gsize i;
+	gsize j;
+
+	rand = g_rand_new_with_seed (0);
+	data = g_malloc (BENCH_GRAIN_SIZE);
+	grains = g_ptr_array_new_with_free_func ((GDestroyNotify) g_byte_array_unref);
+	for (i = 0; i < BENCH_GRAIN_VARIANTS; i++) {
+		for (j = 0; j < BENCH_GRAIN_SIZE / 2; j++)
+			data[j] = g_rand_int (rand);
+		for (; j < BENCH_GRAIN_SIZE; j++)
+			data[j] = "libgovf benchmark grain "[(i + j) % 24];
+		g_ptr_array_add (grains, vmdk_grain_new (data));
+	}
+
+	f = g_fopen (filename, "wb");
+	if (f == NULL)
+		g_error ("Cannot create %s: %s", filename, g_strerror (errno));
+
+	vmdk_put_le32 (sector, 0x564d444b);
+	vmdk_put_le32 (sector + 4, 3);
+	vmdk_put_le32 (sector + 8, (1 << 16) | (1 << 17));
+	vmdk_put_le64 (sector + 12, disk_size / 512);
+	vmdk_put_le64 (sector + 20, BENCH_GRAIN_SIZE / 512);
+	vmdk_put_le64 (sector + 28, 1);
+	vmdk_put_le64 (sector + 36, 1);
+	vmdk_put_le64 (sector + 64, 2);
+	memcpy (sector + 73, "\n \r\n", 4);
+	sector[77] = 1;
+	fwrite (sector, sizeof (sector), 1, f);
+	memset (sector, 0, sizeof (sector));
+	memcpy (sector, descriptor, strlen (descriptor));
+	fwrite (sector, sizeof (sector), 1, f);
+	vmdk_size += 2 * sizeof (sector);
+
+	for (offset = 0, i = 0; offset < disk_size; offset += BENCH_GRAIN_SIZE, i++) {
+		GByteArray *grain;
+
+		if (i % 8 == 7)
+			continue;
+
+		grain = g_ptr_array_index (grains, i % BENCH_GRAIN_VARIANTS);
+		vmdk_put_le64 (grain->data, offset / 512);
+		fwrite (grain->data, grain->len, 1, f);
+		vmdk_size += grain->len;
+	}
+
+	/* end of stream marker */
+	memset (sector, 0, sizeof (sector));
+	fwrite (sector, sizeof (sector), 1, f);
+	vmdk_size += sizeof (sector);
+
+	failed = ferror (f);
+	if (fclose (f) != 0 || failed)
+		g_error ("Cannot write %s", filename);
+
+	return vmdk_size;
+}
+
+/* a package of --disks copies of the VMDK at @vmdk_filename */
+static void
+create_vmdk_ova (const gchar *filename,
+                 const gchar *descriptor,
+                 const gchar *vmdk_filename)
+{
+	g_autofree gchar *chunk = NULL;
+	g_autoptr(GString) manifest = NULL;
+	struct archive *a;
+	gint j;
+
+	a = open_archive (filename);
+	write_member (a, "bench.ovf", descriptor);
+
+	chunk = g_malloc (BENCH_CHUNK_SIZE);
+	manifest = g_string_new (NULL);
+	for (j = 0; j < n_disks; j++) {
+		g_autofree gchar *name = g_strdup_printf ("disk%d.img", j);
+		g_autoptr(GChecksum) checksum = g_checksum_new (G_CHECKSUM_SHA256);
+		GStatBuf st;
+		gsize n;
+		FILE *f;
+
+		f = g_fopen (vmdk_filename, "rb");
+		if (f == NULL || g_stat (vmdk_filename, &st) != 0)
+			g_error ("Cannot open %s: %s", vmdk_filename, g_strerror (errno));
+
+		write_header (a, name, st.st_size);
+		while ((n = fread (chunk, 1, BENCH_CHUNK_SIZE, f)) > 0) {
+			g_assert_cmpint (archive_write_data (a, chunk, n), ==, n);
+			g_checksum_update (checksum, (const guchar *) chunk, n);
+		}
+		fclose (f);
+		g_string_append_printf (manifest, "SHA256(%s)= %s\n", name, g_checksum_get_string (checksum));
+	}
+	write_member (a, "bench.mf", manifest->str);
+
+	g_assert_cmpint (archive_write_close (a), ==, ARCHIVE_OK);
+	archive_write_free (a);
+}
+
+/* parsing the descriptor alone, without any archive around it */
+static void
+bench_parse (const gchar *descriptor)
+{
+	guint i;
+	gint j;
+
+	for (i = 0; i < G_N_ELEMENTS (load_modes); i++) {
+		if (load_modes[i].flags == GOVF_LOAD_FLAGS_METADATA_ONLY)
+			continue;
+
+		for (j = 0; j < iterations; j++) {
+			g_autofree gchar *fields = NULL;
+			g_autoptr(GError) error = NULL;
+			g_autoptr(GPtrArray) disks = NULL;
+			g_autoptr(GovfPackage) package = NULL;
+			gint64 start;
+
+			package = govf_package_new ();
+			govf_package_set_load_flags (package, load_modes[i].flags);
+
+			start = g_get_monotonic_time ();
+			if (!govf_package_load_from_data (package, descriptor, -1, &error))
+				g_error ("Cannot parse the descriptor: %s", error->message);
+			disks = govf_package_get_disks (package);
+			g_assert_cmpint (disks->len, ==, n_disks);
+
+			fields = g_strdup_printf ("\"mode\": \"%s\", \"iteration\": %d, \"bytes\": %" G_GSIZE_FORMAT,
+			                          load_modes[i].name, j, strlen (descriptor));
+			print_result ("parse", start, fields);
+		}
+	}
+}
+
+/* the descriptors in --corpus, or ones generated with each combination of
+ * the corpus shapes */
+static GPtrArray *
+create_corpus (goffset disk_size)
+{
+	GPtrArray *corpus;
+	gint saved_disks = n_disks;
+	gint saved_hardware_items = n_hardware_items;
+	guint i;
+	guint j;
+
+	corpus = g_ptr_array_new_with_free_func (g_free);
+
+	if (corpus_dir != NULL) {
+		g_autoptr(GDir) dir = NULL;
+		g_autoptr(GError) error = NULL;
+		const gchar *name;
+
+		dir = g_dir_open (corpus_dir, 0, &error);
+		if (dir == NULL)
+			g_error ("Cannot open %s: %s", corpus_dir, error->message);
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			g_autofree gchar *path = NULL;
+			gchar *contents;
+
+			if (!g_str_has_suffix (name, ".ovf"))
+				continue;
+			path = g_build_filename (corpus_dir, name, NULL);
+			if (!g_file_get_contents (path, &contents, NULL, &error))
+				g_error ("Cannot read %s: %s", path, error->message);
+			g_ptr_array_add (corpus, contents);
+		}
+		if (corpus->len == 0)
+			g_error ("No .ovf files in %s", corpus_dir);
+		return corpus;
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (corpus_disks); i++) {
+		for (j = 0; j < G_N_ELEMENTS (corpus_hardware_items); j++) {
+			n_disks = corpus_disks[i];
+			n_hardware_items = corpus_hardware_items[j];
+			g_ptr_array_add (corpus, create_descriptor ("bench", disk_size, 0));
+		}
+	}
+	n_disks = saved_disks;
+	n_hardware_items = saved_hardware_items;
+
+	return corpus;
+}
+
+/* the queries evaluated from their strings with xmlXPathEval(), which
+ * compiles them every time, against the same queries compiled once and
+ * shared, as the library does */
+static void
+bench_xpath (GPtrArray *corpus)
+{
+	g_autofree xmlXPathCompExpr **compiled = NULL;
+	g_autofree xmlXPathContext **contexts = NULL;
+	g_autofree xmlDoc **docs = NULL;
+	gboolean use_compiled;
+	gsize total_bytes = 0;
+	guint i;
+	gint j;
+
+	docs = g_new0 (xmlDoc *, corpus->len);
+	contexts = g_new0 (xmlXPathContext *, corpus->len);
+	for (i = 0; i < corpus->len; i++) {
+		const gchar *descriptor = g_ptr_array_index (corpus, i);
+
+		docs[i] = xmlReadMemory (descriptor, strlen (descriptor), NULL, NULL, XML_PARSE_NONET);
+		if (docs[i] == NULL)
+			g_error ("Cannot parse descriptor %u of the corpus", i);
+		contexts[i] = xmlXPathNewContext (docs[i]);
+		xmlXPathRegisterNs (contexts[i],
+		                    (const xmlChar *) "ovf",
+		                    (const xmlChar *) "http://schemas.dmtf.org/ovf/envelope/1");
+		total_bytes += strlen (descriptor);
+	}
+
+	compiled = g_new0 (xmlXPathCompExpr *, G_N_ELEMENTS (xpath_exprs));
+	for (i = 0; i < G_N_ELEMENTS (xpath_exprs); i++) {
+		compiled[i] = xmlXPathCompile ((const xmlChar *) xpath_exprs[i]);
+		g_assert (compiled[i] != NULL);
+	}
+
+	for (use_compiled = FALSE; use_compiled <= TRUE; use_compiled++) {
+		for (j = 0; j < iterations; j++) {
+			g_autofree gchar *fields = NULL;
+			gdouble seconds;
+			gint64 start;
+			guint round;
+			guint k;
+
+			start = g_get_monotonic_time ();
+			for (round = 0; round < BENCH_XPATH_ROUNDS; round++) {
+				for (i = 0; i < corpus->len; i++) {
+					for (k = 0; k < G_N_ELEMENTS (xpath_exprs); k++) {
+						xmlXPathObject *obj;
+
+						if (use_compiled)
+							obj = xmlXPathCompiledEval (compiled[k], contexts[i]);
+						else
+							obj = xmlXPathEval ((const xmlChar *) xpath_exprs[k], contexts[i]);
+						if (obj == NULL)
+							g_error ("Cannot evaluate %s", xpath_exprs[k]);
+						xmlXPathFreeObject (obj);
+					}
+				}
+			}
+			seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+			fields = g_strdup_printf ("\"mode\": \"%s\", \"iteration\": %d, \"descriptors\": %u, "
+			                          "\"bytes\": %" G_GSIZE_FORMAT ", \"evaluations\": %u, "
+			                          "\"usec_per_descriptor\": %.2f",
+			                          use_compiled ? "compiled" : "eval",
+			                          j,
+			                          corpus->len,
+			                          total_bytes,
+			                          (guint) (BENCH_XPATH_ROUNDS * corpus->len * G_N_ELEMENTS (xpath_exprs)),
+			                          seconds * G_USEC_PER_SEC / (BENCH_XPATH_ROUNDS * corpus->len));
+			print_result ("xpath", start, fields);
+		}
+	}
+
+	for (i = 0; i < G_N_ELEMENTS (xpath_exprs); i++)
+		xmlXPathFreeCompExpr (compiled[i]);
+	for (i = 0; i < corpus->len; i++) {
+		xmlXPathFreeContext (contexts[i]);
+		xmlFreeDoc (docs[i]);
+	}
+}
+
+static void
+bench_load (const gchar *ova_filename)
+{
+	guint i;
+	gint j;
+
+	for (i = 0; i < G_N_ELEMENTS (load_modes); i++) {
+		for (j = 0; j < iterations; j++) {
+			g_autofree gchar *fields = NULL;
+			g_autoptr(GError) error = NULL;
+			g_autoptr(GovfPackage) package = NULL;
+			gint64 start;
+
+			package = govf_package_new ();
+			govf_package_set_load_flags (package, load_modes[i].flags);
+
+			start = g_get_monotonic_time ();
+			if (!govf_package_load_from_ova_file (package, ova_filename, &error))
+				g_error ("Cannot load %s: %s", ova_filename, error->message);
+
+			fields = g_strdup_printf ("\"mode\": \"%s\", \"iteration\": %d, \"bytes_read\": %" G_GUINT64_FORMAT,
+			                          load_modes[i].name, j, govf_package_get_bytes_read (package));
+			print_result ("load", start, fields);
+		}
+	}
+}
+
+/* the memory each package keeps once loaded, with many of them loaded
+ * at once as a catalog of appliances would */
+static void
+bench_memory (const gchar *descriptor)
+{
+	guint i;
+	gint j;
+
+	for (i = 0; i < G_N_ELEMENTS (load_modes); i++) {
+		if (load_modes[i].flags == GOVF_LOAD_FLAGS_METADATA_ONLY)
+			continue;
+
+		for (j = 0; j < iterations; j++) {
+			g_autofree gchar *fields = NULL;
+			g_autoptr(GPtrArray) packages = NULL;
+			glong rss_before;
+			glong rss_after;
+			gint64 start;
+			gint k;
+
+			packages = g_ptr_array_new_with_free_func (g_object_unref);
+			rss_before = get_rss_kib ();
+
+			start = g_get_monotonic_time ();
+			for (k = 0; k < n_packages; k++) {
+				g_autoptr(GError) error = NULL;
+				GovfPackage *package;
+
+				package = govf_package_new ();
+				govf_package_set_load_flags (package, load_modes[i].flags);
+				if (!govf_package_load_from_data (package, descriptor, -1, &error))
+					g_error ("Cannot parse the descriptor: %s", error->message);
+				g_ptr_array_add (packages, package);
+			}
+			rss_after = get_rss_kib ();
+
+			fields = g_strdup_printf ("\"mode\": \"%s\", \"iteration\": %d, \"packages\": %d, "
+			                          "\"rss_kib\": %ld, \"kib_per_package\": %.1f",
+			                          load_modes[i].name,
+			                          j,
+			                          n_packages,
+			                          rss_after - rss_before,
+			                          (rss_after - rss_before) / (gdouble) n_packages);
+			print_result ("memory", start, fields);
+		}
+	}
+}
+
+static void
+catalog_count_cb (GovfCatalogEntry *entry, gpointer user_data)
+{
+	guint *n_entries = user_data;
+
+	if (govf_catalog_entry_get_error (entry) != NULL)
+		g_error ("Cannot load %s: %s",
+		         govf_catalog_entry_get_filename (entry),
+		         govf_catalog_entry_get_error (entry)->message);
+	(*n_entries)++;
+}
+
+/* written back first, as dirty pages are not dropped */
+static void
+evict_file (const gchar *filename)
+{
+#ifdef HAVE_POSIX_FADVISE
+	gint fd;
+	gint rc;
+
+	fd = g_open (filename, O_RDONLY, 0);
+	if (fd == -1)
+		g_error ("Cannot open %s: %s", filename, g_strerror (errno));
+	if (fdatasync (fd) != 0)
+		g_error ("Cannot sync %s: %s", filename, g_strerror (errno));
+	rc = posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+	if (rc != 0)
+		g_error ("Cannot drop %s from the page cache: %s", filename, g_strerror (rc));
+	close (fd);
+#else
+	g_error ("Cannot drop %s from the page cache: not supported", filename);
+#endif
+}
+
+/* scanning a directory of distinct packages, with a doubling number of
+ * threads up to the number of processors; with --drop-cache every scan
+ * starts from a cold page cache, the case the inode order is for */
+static void
+bench_catalog (const gchar *tmp_dir)
+{
+	g_autofree gchar *catalog_dir = NULL;
+	g_autoptr(GovfCatalog) catalog = NULL;
+	guint n_threads;
+	gint j;
+	gint k;
+
+	catalog_dir = g_build_filename (tmp_dir, "catalog", NULL);
+	g_assert_cmpint (g_mkdir (catalog_dir, 0755), ==, 0);
+	for (k = 0; k < n_packages; k++) {
+		g_autofree gchar *basename = g_strdup_printf ("%d.ova", k);
+		g_autofree gchar *descriptor = NULL;
+		g_autofree gchar *name = g_strdup_printf ("bench%d", k);
+		g_autofree gchar *path = g_build_filename (catalog_dir, basename, NULL);
+
+		descriptor = create_descriptor (name, BENCH_CATALOG_DISK_SIZE, 0);
+		create_ova (path, descriptor, BENCH_CATALOG_DISK_SIZE);
+	}
+
+	catalog = govf_catalog_new ();
+	for (n_threads = 1; ; n_threads = MIN (n_threads * 2, g_get_num_processors ())) {
+		govf_catalog_set_max_threads (catalog, n_threads);
+
+		for (j = 0; j < iterations; j++) {
+			g_autofree gchar *fields = NULL;
+			g_autoptr(GError) error = NULL;
+			gdouble seconds;
+			gint64 start;
+			guint n_entries = 0;
+
+			if (drop_cache) {
+				for (k = 0; k < n_packages; k++) {
+					g_autofree gchar *basename = g_strdup_printf ("%d.ova", k);
+					g_autofree gchar *path = g_build_filename (catalog_dir, basename, NULL);
+
+					evict_file (path);
+				}
+			}
+
+			start = g_get_monotonic_time ();
+			if (!govf_catalog_scan_dir (catalog, catalog_dir, catalog_count_cb, &n_entries, NULL, &error))
+				g_error ("Cannot scan %s: %s", catalog_dir, error->message);
+			seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+			g_assert_cmpint (n_entries, ==, n_packages);
+
+			fields = g_strdup_printf ("\"threads\": %u, \"iteration\": %d, \"packages\": %d, "
+			                          "\"cache\": \"%s\", \"packages_per_second\": %.1f",
+			                          n_threads,
+			                          j,
+			                          n_packages,
+			                          drop_cache ? "cold" : "warm",
+			                          n_packages / seconds);
+			print_result ("catalog", start, fields);
+		}
+
+		if (n_threads >= g_get_num_processors ())
+			break;
+	}
+
+	for (k = 0; k < n_packages; k++) {
+		g_autofree gchar *basename = g_strdup_printf ("%d.ova", k);
+		g_autofree gchar *path = g_build_filename (catalog_dir, basename, NULL);
+
+		g_unlink (path);
+	}
+	g_rmdir (catalog_dir);
+}
+
+static void
+bench_extract (const gchar *ova_filename,
+               const gchar *tmp_dir,
+               goffset      disk_size)
+{
+	guint i;
+	gint j;
+
+	for (i = 0; i < G_N_ELEMENTS (engines); i++) {
+		for (j = 0; j < iterations; j++) {
+			g_autofree gchar *fields = NULL;
+			g_autoptr(GError) error = NULL;
+			g_autoptr(GPtrArray) disks = NULL;
+			g_autoptr(GPtrArray) extractions = NULL;
+			g_autoptr(GovfExtractOptions) options = NULL;
+			g_autoptr(GovfPackage) package = NULL;
+			goffset total = (goffset) n_disks * disk_size;
+			gdouble seconds;
+			gint64 start;
+			guint k;
+
+			options = govf_extract_options_new ();
+			govf_extract_options_set_flags (options,
+			                                engines[i].flags |
+			                                (drop_cache ? GOVF_IO_FLAGS_DROP_CACHE : 0));
+
+			package = govf_package_new ();
+			govf_package_set_extract_options (package, options);
+			if (!govf_package_load_from_ova_file (package, ova_filename, &error))
+				g_error ("Cannot load %s: %s", ova_filename, error->message);
+
+			disks = govf_package_get_disks (package);
+			extractions = g_ptr_array_new_with_free_func (g_object_unref);
+			for (k = 0; k < disks->len; k++) {
+				GovfDisk *disk = g_ptr_array_index (disks, k);
+				g_autofree gchar *basename = g_strdup_printf ("%s.img", govf_disk_get_disk_id (disk));
+				g_autofree gchar *path = g_build_filename (tmp_dir, basename, NULL);
+				GovfExtraction *extraction;
+
+				extraction = govf_extraction_new (disk, path);
+				govf_extraction_set_flags (extraction, GOVF_EXTRACT_FLAGS_VERIFY);
+				g_ptr_array_add (extractions, extraction);
+			}
+
+			start = g_get_monotonic_time ();
+			if (!govf_package_extract_disks (package, extractions, &error))
+				g_error ("Cannot extract: %s", error->message);
+			seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+
+			fields = g_strdup_printf ("\"engine\": \"%s\", \"compressed\": %s, \"iteration\": %d, "
+			                          "\"bytes\": %" G_GOFFSET_FORMAT ", \"mib_per_second\": %.1f",
+			                          engines[i].name,
+			                          compressed ? "true" : "false",
+			                          j,
+			                          total,
+			                          total / (1024.0 * 1024.0) / seconds);
+			print_result ("extract", start, fields);
+
+			for (k = 0; k < extractions->len; k++)
+				g_unlink (govf_extraction_get_save_path (g_ptr_array_index (extractions, k)));
+		}
+	}
+}
+
+/* inflating the grains of the VMDK disks with a doubling number of
+ * threads up to the number of processors; disks are converted one at a
+ * time, and the speedup is against the best run on a single thread */
+static void
+bench_convert (const gchar *ova_filename,
+               const gchar *tmp_dir,
+               goffset      disk_size)
+{
+	gdouble baseline = 0.0;
+	guint n_threads;
+	gint j;
+
+	for (n_threads = 1; ; n_threads = MIN (n_threads * 2, g_get_num_processors ())) {
+		for (j = 0; j < iterations; j++) {
+			g_autofree gchar *fields = NULL;
+			g_autoptr(GError) error = NULL;
+			g_autoptr(GPtrArray) disks = NULL;
+			g_autoptr(GPtrArray) extractions = NULL;
+			g_autoptr(GovfExtractOptions) options = NULL;
+			g_autoptr(GovfPackage) package = NULL;
+			goffset total = (goffset) n_disks * disk_size;
+			gdouble mib_per_second;
+			gdouble seconds;
+			gint64 start;
+			guint k;
+
+			options = govf_extract_options_new ();
+			govf_extract_options_set_convert_threads (options, n_threads);
+			govf_extract_options_set_flags (options, drop_cache ? GOVF_IO_FLAGS_DROP_CACHE : 0);
+
+			package = govf_package_new ();
+			govf_package_set_extract_options (package, options);
+			govf_package_set_extract_threads (package, 1);
+			if (!govf_package_load_from_ova_file (package, ova_filename, &error))
+				g_error ("Cannot load %s: %s", ova_filename, error->message);
+
+			disks = govf_package_get_disks (package);
+			extractions = g_ptr_array_new_with_free_func (g_object_unref);
+			for (k = 0; k < disks->len; k++) {
+				GovfDisk *disk = g_ptr_array_index (disks, k);
+				g_autofree gchar *basename = g_strdup_printf ("%s.raw", govf_disk_get_disk_id (disk));
+				g_autofree gchar *path = g_build_filename (tmp_dir, basename, NULL);
+				GovfExtraction *extraction;
+
+				extraction = govf_extraction_new (disk, path);
+				govf_extraction_set_flags (extraction, GOVF_EXTRACT_FLAGS_CONVERT_RAW);
+				g_ptr_array_add (extractions, extraction);
+			}
+
+			start = g_get_monotonic_time ();
+			if (!govf_package_extract_disks (package, extractions, &error))
+				g_error ("Cannot convert: %s", error->message);
+			seconds = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+			for (k = 0; k < extractions->len; k++)
+				g_assert_cmpint (govf_extraction_get_size (g_ptr_array_index (extractions, k)), ==, disk_size);
+
+			mib_per_second = total / (1024.0 * 1024.0) / seconds;
+			if (n_threads == 1)
+				baseline = MAX (baseline, mib_per_second);
+
+			fields = g_strdup_printf ("\"threads\": %u, \"compressed\": %s, \"iteration\": %d, "
+			                          "\"bytes\": %" G_GOFFSET_FORMAT ", \"mib_per_second\": %.1f, "
+			                          "\"speedup\": %.2f",
+			                          n_threads,
+			                          compressed ? "true" : "false",
+			                          j,
+			                          total,
+			                          mib_per_second,
+			                          mib_per_second / baseline);
+			print_result ("convert", start, fields);
+
+			for (k = 0; k < extractions->len; k++)
+				g_unlink (govf_extraction_get_save_path (g_ptr_array_index (extractions, k)));
+		}
+
+		if (n_threads >= g_get_num_processors ())
+			break;
+	}
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+	g_autofree gchar *descriptor = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GOptionContext) context = NULL;
+	goffset disk_size;
+
+	context = g_option_context_new ("- benchmark libgovf");
+	g_option_context_add_main_entries (context, entries, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		return 1;
+	}
+	if (n_disks < 1 || n_hardware_items < 0 || descriptor_size_kib < 0 ||
+	    disk_size_mib < 0 || iterations < 1 || n_packages < 1) {
+		g_printerr ("Invalid package shape\n");
+		return 1;
+	}
+
+	disk_size = (goffset) disk_size_mib * 1024 * 1024;
+	descriptor = create_descriptor ("bench", disk_size, 0);
+
+	if (benchmark_enabled ("parse"))
+		bench_parse (descriptor);
+	if (benchmark_enabled ("xpath")) {
+		g_autoptr(GPtrArray) corpus = create_corpus (disk_size);
+
+		bench_xpath (corpus);
+	}
+	if (benchmark_enabled ("memory"))
+		bench_memory (descriptor);
+
+	if (!benchmark_enabled ("load") &&
+	    !benchmark_enabled ("extract") &&
+	    !benchmark_enabled ("convert") &&
+	    !benchmark_enabled ("catalog"))
+		return 0;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-bench-XXXXXX", &error);
+	if (tmp_dir == NULL) {
+		g_printerr ("%s\n", error->message);
+		return 1;
+	}
+
+	if (benchmark_enabled ("load") || benchmark_enabled ("extract")) {
+		ova_filename = g_build_filename (tmp_dir, "bench.ova", NULL);
+		create_ova (ova_filename, descriptor, disk_size);
+
+		if (benchmark_enabled ("load"))
+			bench_load (ova_filename);
+		if (benchmark_enabled ("extract"))
+			bench_extract (ova_filename, tmp_dir, disk_size);
+
+		g_unlink (ova_filename);
+	}
+
+	if (benchmark_enabled ("catalog"))
+		bench_catalog (tmp_dir);
+
+	if (benchmark_enabled ("convert")) {
+		g_autofree gchar *vmdk_descriptor = NULL;
+		g_autofree gchar *vmdk_filename = NULL;
+		g_autofree gchar *vmdk_ova_filename = NULL;
+		goffset vmdk_size;
+
+		vmdk_filename = g_build_filename (tmp_dir, "bench.vmdk", NULL);
+		vmdk_size = create_vmdk (vmdk_filename, disk_size);
+		vmdk_descriptor = create_descriptor ("bench", disk_size, vmdk_size);
+		vmdk_ova_filename = g_build_filename (tmp_dir, "vmdk.ova", NULL);
+		create_vmdk_ova (vmdk_ova_filename, vmdk_descriptor, vmdk_filename);
+		g_unlink (vmdk_filename);
+
+		bench_convert (vmdk_ova_filename, tmp_dir, disk_size);
+		g_unlink (vmdk_ova_filename);
+	}
+
+	g_rmdir (tmp_dir);
+	g_strfreev (benchmarks);
+	g_free (corpus_dir);
+
+	return 0;
+}
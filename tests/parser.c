@@ -18,9 +18,408 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
  */
 
+#include "config.h"
+
+#include <archive.h>
+#include <archive_entry.h>
+#include <fcntl.h>
 #include <glib/gstdio.h>
+#include <govf/govf-catalog.h>
 #include <govf/govf-disk.h>
+#include <govf/govf-extract-options.h>
+#include <govf/govf-extraction.h>
+#include <govf/govf-file.h>
 #include <govf/govf-package.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <utime.h>
+
+static const gchar multi_disk_ovf[] =
+"<?xml version=\"1.0\"?>"
+"<Envelope ovf:version=\"1.0\" xml:lang=\"en-US\" xmlns=\"http://schemas.dmtf.org/ovf/envelope/1\" xmlns:ovf=\"http://schemas.dmtf.org/ovf/envelope/1\">"
+"  <References>"
+"    <File ovf:href=\"disk1.img\" ovf:id=\"file1\"/>"
+"    <File ovf:href=\"disk2.img\" ovf:id=\"file2\"/>"
+"  </References>"
+"  <DiskSection>"
+"    <Disk ovf:capacity=\"1024\" ovf:diskId=\"disk1\" ovf:fileRef=\"file1\"/>"
+"    <Disk ovf:capacity=\"1024\" ovf:diskId=\"disk2\" ovf:fileRef=\"file2\""
+"          ovf:format=\"http://www.vmware.com/interfaces/specifications/vmdk.html#streamOptimized\"/>"
+"  </DiskSection>"
+"  <VirtualSystem ovf:id=\"multi\">"
+"    <OperatingSystemSection ovf:id=\"80\"/>"
+"    <VirtualHardwareSection/>"
+"  </VirtualSystem>"
+"</Envelope>";
+
+static struct archive *
+create_ova_open (const gchar *filename, gboolean compressed)
+{
+	struct archive *a;
+
+	a = archive_write_new ();
+	archive_write_set_format_ustar (a);
+	if (compressed)
+		archive_write_add_filter_gzip (a);
+	g_assert_cmpint (archive_write_open_filename (a, filename), ==, ARCHIVE_OK);
+
+	return a;
+}
+
+static void
+create_ova_member (struct archive *a,
+                   const gchar    *name,
+                   const gchar    *contents,
+                   gsize           length)
+{
+	struct archive_entry *entry;
+
+	entry = archive_entry_new ();
+	archive_entry_set_pathname (entry, name);
+	archive_entry_set_size (entry, length);
+	archive_entry_set_filetype (entry, AE_IFREG);
+	archive_entry_set_perm (entry, 0644);
+	g_assert_cmpint (archive_write_header (a, entry), ==, ARCHIVE_OK);
+	g_assert_cmpint (archive_write_data (a, contents, length), ==, length);
+	archive_entry_free (entry);
+}
+
+static void
+create_ova_close (struct archive *a)
+{
+	archive_write_close (a);
+	archive_write_free (a);
+}
+
+/* writes a ustar archive from NULL-terminated name/contents pairs */
+static void
+create_ova (const gchar *filename, gboolean compressed, ...)
+{
+	const gchar *name;
+	struct archive *a;
+	va_list args;
+
+	a = create_ova_open (filename, compressed);
+
+	va_start (args, compressed);
+	while ((name = va_arg (args, const gchar *)) != NULL) {
+		const gchar *contents = va_arg (args, const gchar *);
+		create_ova_member (a, name, contents, strlen (contents));
+	}
+	va_end (args);
+
+	create_ova_close (a);
+}
+
+/* a seekable in-memory stream that counts the bytes read from it */
+typedef struct
+{
+	GMemoryInputStream	 parent_instance;
+	gsize			 bytes_read;
+} CountingInputStream;
+
+typedef struct
+{
+	GMemoryInputStreamClass	 parent_class;
+} CountingInputStreamClass;
+
+G_DEFINE_TYPE (CountingInputStream, counting_input_stream, G_TYPE_MEMORY_INPUT_STREAM)
+
+static gssize
+counting_input_stream_read (GInputStream  *stream,
+                            void          *buffer,
+                            gsize          count,
+                            GCancellable  *cancellable,
+                            GError       **error)
+{
+	CountingInputStream *self = (CountingInputStream *) stream;
+	gssize n;
+
+	n = G_INPUT_STREAM_CLASS (counting_input_stream_parent_class)->read_fn (stream,
+	                                                                         buffer,
+	                                                                         count,
+	                                                                         cancellable,
+	                                                                         error);
+	if (n > 0)
+		self->bytes_read += n;
+
+	return n;
+}
+
+static void
+counting_input_stream_class_init (CountingInputStreamClass *klass)
+{
+	G_INPUT_STREAM_CLASS (klass)->read_fn = counting_input_stream_read;
+}
+
+static void
+counting_input_stream_init (CountingInputStream *self)
+{
+}
+
+/* a stream that can't seek, like a pipe, handing out only the bytes let
+ * through with gated_input_stream_open() and blocking for more until the
+ * read is cancelled */
+typedef struct
+{
+	GInputStream		 parent_instance;
+	GBytes			*bytes;
+	gsize			 offset;
+	gsize			 available;
+	GMutex			 mutex;
+	GCond			 cond;
+} GatedInputStream;
+
+typedef struct
+{
+	GInputStreamClass	 parent_class;
+} GatedInputStreamClass;
+
+G_DEFINE_TYPE (GatedInputStream, gated_input_stream, G_TYPE_INPUT_STREAM)
+
+static void
+gated_input_stream_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	GatedInputStream *self = user_data;
+
+	g_mutex_lock (&self->mutex);
+	g_cond_broadcast (&self->cond);
+	g_mutex_unlock (&self->mutex);
+}
+
+static gssize
+gated_input_stream_read (GInputStream  *stream,
+                         void          *buffer,
+                         gsize          count,
+                         GCancellable  *cancellable,
+                         GError       **error)
+{
+	GatedInputStream *self = (GatedInputStream *) stream;
+	gulong handler_id = 0;
+	gssize n = -1;
+
+	if (cancellable != NULL)
+		handler_id = g_cancellable_connect (cancellable,
+		                                    G_CALLBACK (gated_input_stream_cancelled_cb),
+		                                    self,
+		                                    NULL);
+
+	g_mutex_lock (&self->mutex);
+	while (self->offset == self->available &&
+	       self->available < g_bytes_get_size (self->bytes) &&
+	       !g_cancellable_is_cancelled (cancellable))
+		g_cond_wait (&self->cond, &self->mutex);
+	if (!g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		n = MIN (count, self->available - self->offset);
+		memcpy (buffer, (const guint8 *) g_bytes_get_data (self->bytes, NULL) + self->offset, n);
+		self->offset += n;
+	}
+	g_mutex_unlock (&self->mutex);
+
+	g_cancellable_disconnect (cancellable, handler_id);
+
+	return n;
+}
+
+static void
+gated_input_stream_finalize (GObject *object)
+{
+	GatedInputStream *self = (GatedInputStream *) object;
+
+	g_bytes_unref (self->bytes);
+	g_mutex_clear (&self->mutex);
+	g_cond_clear (&self->cond);
+
+	G_OBJECT_CLASS (gated_input_stream_parent_class)->finalize (object);
+}
+
+static void
+gated_input_stream_class_init (GatedInputStreamClass *klass)
+{
+	G_OBJECT_CLASS (klass)->finalize = gated_input_stream_finalize;
+	G_INPUT_STREAM_CLASS (klass)->read_fn = gated_input_stream_read;
+}
+
+static void
+gated_input_stream_init (GatedInputStream *self)
+{
+	g_mutex_init (&self->mutex);
+	g_cond_init (&self->cond);
+}
+
+static GInputStream *
+gated_input_stream_new (GBytes *bytes)
+{
+	GatedInputStream *self;
+
+	self = g_object_new (gated_input_stream_get_type (), NULL);
+	self->bytes = g_bytes_ref (bytes);
+
+	return G_INPUT_STREAM (self);
+}
+
+/* lets the first @available bytes through */
+static void
+gated_input_stream_open (GInputStream *stream, gsize available)
+{
+	GatedInputStream *self = (GatedInputStream *) stream;
+
+	g_mutex_lock (&self->mutex);
+	self->available = MIN (available, g_bytes_get_size (self->bytes));
+	g_cond_broadcast (&self->cond);
+	g_mutex_unlock (&self->mutex);
+}
+
+/* the offset of the first byte of @needle in @haystack */
+static gsize
+find_bytes (GBytes *haystack, const gchar *needle, gsize needle_len)
+{
+	const gchar *data;
+	gsize size;
+	gsize i;
+
+	data = g_bytes_get_data (haystack, &size);
+	for (i = 0; i + needle_len <= size; i++) {
+		if (memcmp (data + i, needle, needle_len) == 0)
+			return i;
+	}
+	g_assert_not_reached ();
+}
+
+#define VMDK_GRAIN_SIZE (64 * 1024)
+
+static void
+vmdk_put_le32 (guint8 *buf, guint32 value)
+{
+	value = GUINT32_TO_LE (value);
+	memcpy (buf, &value, sizeof (value));
+}
+
+static void
+vmdk_put_le64 (guint8 *buf, guint64 value)
+{
+	value = GUINT64_TO_LE (value);
+	memcpy (buf, &value, sizeof (value));
+}
+
+static void
+vmdk_append_sector (GByteArray *vmdk, const guint8 *data, gsize length)
+{
+	static const guint8 zeros[512] = { 0, };
+
+	g_byte_array_append (vmdk, data, length);
+	if (vmdk->len % 512 != 0)
+		g_byte_array_append (vmdk, zeros, 512 - vmdk->len % 512);
+}
+
+/* builds a streamOptimized VMDK, leaving out grains that are all zeros */
+static GByteArray *
+create_vmdk (const gchar *disk_data, gsize disk_size)
+{
+	static const gchar descriptor[] = "# Disk DescriptorFile\ncreateType=\"streamOptimized\"\n";
+	GByteArray *vmdk;
+	guint8 sector[512] = { 0, };
+	gsize offset;
+
+	vmdk = g_byte_array_new ();
+
+	vmdk_put_le32 (sector, 0x564d444b);
+	vmdk_put_le32 (sector + 4, 3);
+	vmdk_put_le32 (sector + 8, (1 << 16) | (1 << 17));
+	vmdk_put_le64 (sector + 12, disk_size / 512);
+	vmdk_put_le64 (sector + 20, VMDK_GRAIN_SIZE / 512);
+	vmdk_put_le64 (sector + 28, 1);
+	vmdk_put_le64 (sector + 36, 1);
+	vmdk_put_le64 (sector + 64, 2);
+	sector[77] = 1;
+	vmdk_append_sector (vmdk, sector, sizeof (sector));
+	vmdk_append_sector (vmdk, (const guint8 *) descriptor, strlen (descriptor));
+
+	for (offset = 0; offset < disk_size; offset += VMDK_GRAIN_SIZE) {
+		g_autoptr(GZlibCompressor) compressor = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autofree guint8 *buf = NULL;
+		gsize bytes_read;
+		gsize bytes_written;
+		guint8 marker[12];
+		gsize i;
+
+		for (i = 0; i < VMDK_GRAIN_SIZE && disk_data[offset + i] == 0; i++);
+		if (i == VMDK_GRAIN_SIZE)
+			continue;
+
+		compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB, -1);
+		buf = g_malloc (2 * VMDK_GRAIN_SIZE);
+		g_assert_cmpint (g_converter_convert (G_CONVERTER (compressor),
+		                                      disk_data + offset,
+		                                      VMDK_GRAIN_SIZE,
+		                                      buf,
+		                                      2 * VMDK_GRAIN_SIZE,
+		                                      G_CONVERTER_INPUT_AT_END,
+		                                      &bytes_read,
+		                                      &bytes_written,
+		                                      &error), ==, G_CONVERTER_FINISHED);
+		g_assert_no_error (error);
+
+		vmdk_put_le64 (marker, offset / 512);
+		vmdk_put_le32 (marker + 8, bytes_written);
+		g_byte_array_append (vmdk, marker, sizeof (marker));
+		vmdk_append_sector (vmdk, buf, bytes_written);
+	}
+
+	/* a grain table marker followed by one sector of grain table */
+	memset (sector, 0, sizeof (sector));
+	vmdk_put_le64 (sector, 1);
+	vmdk_put_le32 (sector + 12, 1);
+	vmdk_append_sector (vmdk, sector, sizeof (sector));
+	memset (sector, 0, sizeof (sector));
+	vmdk_append_sector (vmdk, sector, sizeof (sector));
+
+	/* end of stream marker */
+	vmdk_append_sector (vmdk, sector, sizeof (sector));
+
+	return vmdk;
+}
+
+static void
+async_result_cb (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+	GAsyncResult **result_out = user_data;
+
+	*result_out = g_object_ref (result);
+}
+
+static void
+progress_cb (goffset  current,
+             goffset  total,
+             gpointer user_data)
+{
+	goffset *current_out = user_data;
+
+	g_assert_cmpint (current, <=, total);
+	*current_out = current;
+}
+
+static GovfDisk *
+find_disk (GPtrArray *disks, const gchar *disk_id)
+{
+	guint i;
+
+	for (i = 0; i < disks->len; i++) {
+		GovfDisk *disk = g_ptr_array_index (disks, i);
+		if (g_strcmp0 (govf_disk_get_disk_id (disk), disk_id) == 0)
+			return disk;
+	}
+
+	return NULL;
+}
 
 static void
 test_init_parser (void)
@@ -108,6 +507,116 @@ test_save_ovf (void)
 	g_rmdir (tmp_dir);
 }
 
+/* starts measuring the peak RSS afresh, where the kernel allows that */
+static gboolean
+reset_peak_rss (void)
+{
+	gboolean ret;
+	gint fd;
+
+	fd = g_open ("/proc/self/clear_refs", O_WRONLY, 0);
+	if (fd == -1)
+		return FALSE;
+	ret = write (fd, "5", 1) == 1;
+	close (fd);
+
+	return ret;
+}
+
+/* the peak RSS in kilobytes since reset_peak_rss() */
+static gint64
+get_peak_rss (void)
+{
+	g_autofree gchar *status = NULL;
+	const gchar *hwm;
+
+	if (!g_file_get_contents ("/proc/self/status", &status, NULL, NULL))
+		return -1;
+	hwm = strstr (status, "VmHWM:");
+	if (hwm == NULL)
+		return -1;
+
+	return g_ascii_strtoll (hwm + strlen ("VmHWM:"), NULL, 10);
+}
+
+static void
+test_save_to_stream (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GOutputStream) stream = NULL;
+	g_autoptr(GString) ovf = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	gint64 peak_rss = -1;
+	gsize length;
+	gsize ovf_length;
+	guint i;
+
+	/* a descriptor of several megabytes, mostly product properties */
+	ovf = g_string_new ("<?xml version=\"1.0\"?>\n"
+	                    "<Envelope xmlns=\"http://schemas.dmtf.org/ovf/envelope/1\" xmlns:ovf=\"http://schemas.dmtf.org/ovf/envelope/1\">\n"
+	                    "  <References>\n"
+	                    "    <File ovf:href=\"disk1.img\" ovf:id=\"file1\"/>\n"
+	                    "  </References>\n"
+	                    "  <DiskSection>\n"
+	                    "    <Disk ovf:capacity=\"1024\" ovf:diskId=\"disk1\" ovf:fileRef=\"file1\"/>\n"
+	                    "  </DiskSection>\n"
+	                    "  <VirtualSystem ovf:id=\"large\">\n"
+	                    "    <OperatingSystemSection ovf:id=\"80\"/>\n"
+	                    "    <VirtualHardwareSection/>\n"
+	                    "    <ProductSection>\n");
+	for (i = 0; ovf->len < 16 * 1024 * 1024; i++) {
+		g_string_append_printf (ovf,
+		                        "      <Property ovf:key=\"property%u\" ovf:value=\"value%u\"/>\n",
+		                        i, i);
+	}
+	g_string_append (ovf,
+	                 "    </ProductSection>\n"
+	                 "  </VirtualSystem>\n"
+	                 "</Envelope>\n");
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_data (ovf_package, ovf->str, ovf->len, &error);
+	g_assert_no_error (error);
+	ovf_length = ovf->len;
+	g_string_free (g_steal_pointer (&ovf), TRUE);
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmp_dir, "large.ovf", NULL);
+
+	/* saving streams the descriptor out rather than dumping it into
+	 * memory first, so the RSS hardly grows while saving */
+	if (reset_peak_rss ())
+		peak_rss = get_peak_rss ();
+	govf_package_save_file (ovf_package, filename, &error);
+	g_assert_no_error (error);
+	if (peak_rss >= 0) {
+		g_test_message ("peak RSS grew by %" G_GINT64_FORMAT " kB while saving %" G_GSIZE_FORMAT " bytes",
+		                get_peak_rss () - peak_rss, ovf_length);
+		g_assert_cmpint (get_peak_rss () - peak_rss, <, 4 * 1024);
+	}
+
+	/* the same descriptor comes out of a stream */
+	stream = g_memory_output_stream_new_resizable ();
+	govf_package_save_to_stream (ovf_package, stream, NULL, &error);
+	g_assert_no_error (error);
+	g_output_stream_close (stream, NULL, &error);
+	g_assert_no_error (error);
+
+	g_file_get_contents (filename, &contents, &length, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (length, ==, g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream)));
+	g_assert (memcmp (contents, g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream)), length) == 0);
+	g_assert (g_str_has_prefix (contents, "<?xml"));
+	g_assert (strstr (contents, "property1000") != NULL);
+
+	g_unlink (filename);
+	g_rmdir (tmp_dir);
+}
+
 static void
 test_get_disks (void)
 {
@@ -164,6 +673,2195 @@ test_extract_disk (void)
 	g_rmdir (tmp_dir);
 }
 
+static void
+test_extract_disk_indexed (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *extracted = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	const gchar *payload = "second disk payload";
+	gchar *found = NULL;
+	gsize length = 0;
+	gsize i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", payload,
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	/* scribble over every byte of the archive apart from the payload of
+	 * the second disk, so that any read outside of it would be noticed */
+	g_file_get_contents (ova_filename, &contents, &length, &error);
+	g_assert_no_error (error);
+	for (i = 0; i + strlen (payload) <= length; i++) {
+		if (memcmp (contents + i, payload, strlen (payload)) == 0) {
+			found = contents + i;
+			break;
+		}
+	}
+	g_assert (found != NULL);
+	memset (contents, 0xaa, found - contents);
+	memset (found + strlen (payload), 0xaa, length - (found - contents) - strlen (payload));
+	g_file_set_contents (ova_filename, contents, length, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+
+	filename = g_build_filename (tmp_dir, "disk2.img", NULL);
+	govf_package_extract_disk (ovf_package,
+	                           find_disk (ovf_disks, "disk2"),
+	                           filename,
+	                           &error);
+	g_assert_no_error (error);
+
+	g_file_get_contents (filename, &extracted, &length, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (extracted, ==, payload);
+
+	g_unlink (filename);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_disks (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfDisk) missing_disk = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	GovfExtraction *extraction;
+	guint i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, TRUE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+
+	extractions = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < ovf_disks->len; i++) {
+		GovfDisk *disk = g_ptr_array_index (ovf_disks, i);
+		g_autofree gchar *filename = NULL;
+
+		filename = g_build_filename (tmp_dir, govf_disk_get_disk_id (disk), NULL);
+		g_ptr_array_add (extractions, govf_extraction_new (disk, filename));
+	}
+
+	/* a disk that is not part of the package */
+	missing_disk = govf_disk_new ();
+	govf_disk_set_file_ref (missing_disk, "file3");
+	extraction = govf_extraction_new (missing_disk, tmp_dir);
+	g_ptr_array_add (extractions, extraction);
+
+	govf_package_extract_disks (ovf_package, extractions, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+	g_assert (govf_extraction_get_error (extraction) != NULL);
+
+	extraction = g_ptr_array_index (extractions, 0);
+	g_assert_no_error (govf_extraction_get_error (extraction));
+	g_file_get_contents (govf_extraction_get_save_path (extraction), &contents, NULL, NULL);
+	g_assert_cmpstr (contents, ==, "first disk payload");
+	g_unlink (govf_extraction_get_save_path (extraction));
+	g_clear_pointer (&contents, g_free);
+
+	extraction = g_ptr_array_index (extractions, 1);
+	g_assert_no_error (govf_extraction_get_error (extraction));
+	g_file_get_contents (govf_extraction_get_save_path (extraction), &contents, NULL, NULL);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+	g_unlink (govf_extraction_get_save_path (extraction));
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_disks_parallel (void)
+{
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	const gchar *payloads[] = { "first disk payload", "second disk payload" };
+	guint i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", payloads[0],
+	            "disk2.img", payloads[1],
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	g_assert_cmpuint (govf_package_get_extract_threads (ovf_package), >, 1);
+	govf_package_set_extract_threads (ovf_package, 2);
+	g_assert_cmpuint (govf_package_get_extract_threads (ovf_package), ==, 2);
+
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+
+	extractions = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < ovf_disks->len; i++) {
+		GovfDisk *disk = g_ptr_array_index (ovf_disks, i);
+		g_autofree gchar *filename = NULL;
+
+		filename = g_build_filename (tmp_dir, govf_disk_get_disk_id (disk), NULL);
+		g_ptr_array_add (extractions, govf_extraction_new (disk, filename));
+	}
+
+	govf_package_extract_disks (ovf_package, extractions, &error);
+	g_assert_no_error (error);
+
+	for (i = 0; i < extractions->len; i++) {
+		GovfExtraction *extraction = g_ptr_array_index (extractions, i);
+		g_autofree gchar *contents = NULL;
+
+		g_assert_no_error (govf_extraction_get_error (extraction));
+		g_file_get_contents (govf_extraction_get_save_path (extraction), &contents, NULL, NULL);
+		g_assert_cmpstr (contents, ==, payloads[i]);
+		g_unlink (govf_extraction_get_save_path (extraction));
+	}
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_disks_compressed (void)
+{
+	g_autofree gchar *filename1 = NULL;
+	g_autofree gchar *filename2 = NULL;
+	g_autofree gchar *manifest = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *payload = NULL;
+	g_autofree gchar *sha_disk1 = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	struct archive *a;
+	gsize payload_size;
+	guint i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* large enough to fill the queues between the pipeline stages, with
+	 * runs of zeros to leave holes when extracting sparsely */
+	payload_size = 12 * 1024 * 1024 + 100;
+	payload = g_malloc0 (payload_size);
+	for (i = 0; i < payload_size; i++) {
+		if ((i / 65536) % 3 != 0)
+			payload[i] = 'a' + i % 26;
+	}
+	sha_disk1 = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) payload, payload_size);
+	manifest = g_strdup_printf ("SHA256(disk1.img)= %s\n", sha_disk1);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	a = create_ova_open (ova_filename, TRUE);
+	create_ova_member (a, "multi.ovf", multi_disk_ovf, strlen (multi_disk_ovf));
+	create_ova_member (a, "multi.mf", manifest, strlen (manifest));
+	create_ova_member (a, "disk1.img", payload, payload_size);
+	create_ova_member (a, "disk2.img", "second disk payload", strlen ("second disk payload"));
+	create_ova_close (a);
+
+	filename1 = g_build_filename (tmp_dir, "disk1.img", NULL);
+	filename2 = g_build_filename (tmp_dir, "disk2.img", NULL);
+	for (i = 0; i < 2; i++) {
+		g_autofree gchar *contents = NULL;
+		g_autoptr(GFile) file = NULL;
+		g_autoptr(GFileInputStream) file_stream = NULL;
+		g_autoptr(GPtrArray) extractions = NULL;
+		g_autoptr(GPtrArray) ovf_disks = NULL;
+		g_autoptr(GovfPackage) ovf_package = NULL;
+		GovfExtraction *extraction1;
+		GovfExtraction *extraction2;
+		gsize length;
+
+		/* both from a file, and from a stream that is read only once */
+		ovf_package = govf_package_new ();
+		if (i == 0) {
+			govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+		} else {
+			file = g_file_new_for_path (ova_filename);
+			file_stream = g_file_read (file, NULL, &error);
+			g_assert_no_error (error);
+			govf_package_load_from_stream (ovf_package, G_INPUT_STREAM (file_stream), NULL, &error);
+		}
+		g_assert_no_error (error);
+
+		ovf_disks = govf_package_get_disks (ovf_package);
+		g_assert (ovf_disks != NULL);
+
+		extraction1 = govf_extraction_new (find_disk (ovf_disks, "disk1"), filename1);
+		govf_extraction_set_flags (extraction1,
+		                           GOVF_EXTRACT_FLAGS_VERIFY |
+		                           (i == 0 ? GOVF_EXTRACT_FLAGS_SPARSE : 0));
+		extraction2 = govf_extraction_new (find_disk (ovf_disks, "disk2"), filename2);
+		extractions = g_ptr_array_new_with_free_func (g_object_unref);
+		g_ptr_array_add (extractions, extraction1);
+		g_ptr_array_add (extractions, extraction2);
+
+		govf_package_extract_disks (ovf_package, extractions, &error);
+		g_assert_no_error (error);
+		if (i == 0)
+			g_assert_cmpuint (govf_extraction_get_bytes_written (extraction1), <, payload_size);
+		else
+			g_assert_cmpuint (govf_extraction_get_bytes_written (extraction1), ==, payload_size);
+
+		g_file_get_contents (filename1, &contents, &length, &error);
+		g_assert_no_error (error);
+		g_assert_cmpuint (length, ==, payload_size);
+		g_assert (memcmp (contents, payload, payload_size) == 0);
+		g_clear_pointer (&contents, g_free);
+
+		g_file_get_contents (filename2, &contents, NULL, &error);
+		g_assert_no_error (error);
+		g_assert_cmpstr (contents, ==, "second disk payload");
+
+		g_unlink (filename1);
+		g_unlink (filename2);
+	}
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_disk_async (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GCancellable) cancellable = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	goffset current = 0;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, TRUE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file_async (ovf_package, ova_filename, NULL,
+	                                       async_result_cb, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	govf_package_load_from_ova_file_finish (ovf_package, result, &error);
+	g_assert_no_error (error);
+	g_clear_object (&result);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+
+	/* extract with progress reporting */
+	filename = g_build_filename (tmp_dir, "disk2.img", NULL);
+	govf_package_extract_disk_async (ovf_package,
+	                                 find_disk (ovf_disks, "disk2"),
+	                                 filename,
+	                                 NULL,
+	                                 progress_cb, &current,
+	                                 async_result_cb, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	govf_package_extract_disk_finish (ovf_package, result, &error);
+	g_assert_no_error (error);
+	g_clear_object (&result);
+
+	g_assert_cmpint (current, ==, strlen ("second disk payload"));
+	g_file_get_contents (filename, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+	g_unlink (filename);
+
+	/* a cancelled extraction leaves nothing behind */
+	cancellable = g_cancellable_new ();
+	g_cancellable_cancel (cancellable);
+	govf_package_extract_disk_async (ovf_package,
+	                                 find_disk (ovf_disks, "disk2"),
+	                                 filename,
+	                                 cancellable,
+	                                 NULL, NULL,
+	                                 async_result_cb, &result);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	govf_package_extract_disk_finish (ovf_package, result, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_concurrent (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename1 = NULL;
+	g_autofree gchar *filename2 = NULL;
+	g_autofree gchar *ova_data = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *payload = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	const gsize payload_size = 24 * 1024;
+	goffset current = 0;
+	gsize ova_size;
+	gsize offset;
+	gsize i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	payload = g_malloc (payload_size + 1);
+	for (i = 0; i < payload_size; i++)
+		payload[i] = 'a' + i % 26;
+	payload[i] = '\0';
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", payload,
+	            "disk2.img", "second disk payload",
+	            NULL);
+	g_file_get_contents (ova_filename, &ova_data, &ova_size, &error);
+	g_assert_no_error (error);
+	bytes = g_bytes_new_take (g_steal_pointer (&ova_data), ova_size);
+
+	/* the stream stalls halfway through the first disk */
+	offset = find_bytes (bytes, payload, payload_size);
+	stream = gated_input_stream_new (bytes);
+	gated_input_stream_open (stream, offset + payload_size / 2);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_stream (ovf_package, stream, NULL, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+
+	filename1 = g_build_filename (tmp_dir, "disk1.img", NULL);
+	govf_package_extract_disk_async (ovf_package,
+	                                 find_disk (ovf_disks, "disk1"),
+	                                 filename1,
+	                                 NULL,
+	                                 progress_cb, &current,
+	                                 async_result_cb, &result);
+	while (current == 0)
+		g_main_context_iteration (NULL, TRUE);
+
+	/* the first extraction is still reading the stream */
+	filename2 = g_build_filename (tmp_dir, "disk2.img", NULL);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename2, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+	g_clear_error (&error);
+	govf_package_verify (ovf_package, NULL, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+	g_clear_error (&error);
+
+	gated_input_stream_open (stream, G_MAXSIZE);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	govf_package_extract_disk_finish (ovf_package, result, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (filename1, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, payload);
+	g_clear_pointer (&contents, g_free);
+
+	/* and once it's done, the next one carries on from there */
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename2, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (filename2, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+
+	g_unlink (filename1);
+	g_unlink (filename2);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_cancel_stalled (void)
+{
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_data = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *payload = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GAsyncResult) result = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GCancellable) cancellable = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GRand) rand = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	const gsize payload_size = 256 * 1024;
+	struct archive *a;
+	goffset current = 0;
+	gsize ova_size;
+	gsize i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* random, so that the compressed archive is about as large */
+	rand = g_rand_new_with_seed (0);
+	payload = g_malloc (payload_size);
+	for (i = 0; i < payload_size; i++)
+		payload[i] = g_rand_int (rand);
+
+	/* compressed archives are read ahead on a thread of their own */
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	a = create_ova_open (ova_filename, TRUE);
+	create_ova_member (a, "multi.ovf", multi_disk_ovf, strlen (multi_disk_ovf));
+	create_ova_member (a, "disk1.img", payload, payload_size);
+	create_ova_member (a, "disk2.img", "second disk payload", strlen ("second disk payload"));
+	create_ova_close (a);
+	g_file_get_contents (ova_filename, &ova_data, &ova_size, &error);
+	g_assert_no_error (error);
+	bytes = g_bytes_new_take (g_steal_pointer (&ova_data), ova_size);
+
+	/* the stream stalls halfway through the first disk for good */
+	stream = gated_input_stream_new (bytes);
+	gated_input_stream_open (stream, ova_size / 2);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_stream (ovf_package, stream, NULL, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+
+	cancellable = g_cancellable_new ();
+	filename = g_build_filename (tmp_dir, "disk1.img", NULL);
+	govf_package_extract_disk_async (ovf_package,
+	                                 find_disk (ovf_disks, "disk1"),
+	                                 filename,
+	                                 cancellable,
+	                                 progress_cb, &current,
+	                                 async_result_cb, &result);
+	while (current == 0)
+		g_main_context_iteration (NULL, TRUE);
+
+	g_cancellable_cancel (cancellable);
+	while (result == NULL)
+		g_main_context_iteration (NULL, TRUE);
+	govf_package_extract_disk_finish (ovf_package, result, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	/* dropping the package doesn't wait on the stream either */
+	g_clear_object (&result);
+	g_clear_object (&ovf_package);
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_load_from_stream (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *ovagz_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GConverter) decompressor = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GFileInputStream) file_stream = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	GovfExtraction *extraction;
+	guint i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+	ovagz_filename = g_build_filename (tmp_dir, "multi.ova.gz", NULL);
+	create_ova (ovagz_filename, TRUE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+
+	/* a seekable stream allows extracting disks in any order */
+	file = g_file_new_for_path (ova_filename);
+	ovf_package = govf_package_new ();
+	govf_package_load_from_gfile (ovf_package, file, NULL, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+
+	filename = g_build_filename (tmp_dir, "disk.img", NULL);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (filename, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+	g_clear_pointer (&contents, g_free);
+
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk1"), filename, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (filename, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "first disk payload");
+	g_clear_pointer (&contents, g_free);
+	g_unlink (filename);
+
+	g_clear_object (&ovf_package);
+	g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+
+	/* decompressing on the fly gives a stream that can't seek */
+	g_clear_object (&file);
+	file = g_file_new_for_path (ovagz_filename);
+	file_stream = g_file_read (file, NULL, &error);
+	g_assert_no_error (error);
+	decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+	stream = g_converter_input_stream_new (G_INPUT_STREAM (file_stream), decompressor);
+	g_assert (!G_IS_SEEKABLE (stream) || !g_seekable_can_seek (G_SEEKABLE (stream)));
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_stream (ovf_package, stream, NULL, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+
+	extractions = g_ptr_array_new_with_free_func (g_object_unref);
+	for (i = 0; i < ovf_disks->len; i++) {
+		GovfDisk *disk = g_ptr_array_index (ovf_disks, i);
+		g_autofree gchar *path = NULL;
+
+		path = g_build_filename (tmp_dir, govf_disk_get_disk_id (disk), NULL);
+		g_ptr_array_add (extractions, govf_extraction_new (disk, path));
+	}
+	govf_package_extract_disks (ovf_package, extractions, &error);
+	g_assert_no_error (error);
+
+	extraction = g_ptr_array_index (extractions, 0);
+	g_file_get_contents (govf_extraction_get_save_path (extraction), &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "first disk payload");
+	g_unlink (govf_extraction_get_save_path (extraction));
+	g_clear_pointer (&contents, g_free);
+
+	extraction = g_ptr_array_index (extractions, 1);
+	g_file_get_contents (govf_extraction_get_save_path (extraction), &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+	g_unlink (govf_extraction_get_save_path (extraction));
+
+	/* the stream has been read past both disks now */
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk1"), filename, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_NOT_FOUND);
+
+	g_unlink (ova_filename);
+	g_unlink (ovagz_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_disk_sparse (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *disk_data = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	GovfExtraction *extraction;
+	const gsize disk_size = 1024 * 1024;
+	gsize length = 0;
+	struct archive *a;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* a disk with data only at the start and the end */
+	disk_data = g_malloc0 (disk_size);
+	memset (disk_data, 'a', 4096);
+	memset (disk_data + disk_size - 4096, 'b', 4096);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	a = create_ova_open (ova_filename, FALSE);
+	create_ova_member (a, "multi.ovf", multi_disk_ovf, strlen (multi_disk_ovf));
+	create_ova_member (a, "disk1.img", disk_data, disk_size);
+	create_ova_close (a);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+
+	filename = g_build_filename (tmp_dir, "disk1.img", NULL);
+	extraction = govf_extraction_new (find_disk (ovf_disks, "disk1"), filename);
+	govf_extraction_set_flags (extraction, GOVF_EXTRACT_FLAGS_SPARSE);
+	extractions = g_ptr_array_new_with_free_func (g_object_unref);
+	g_ptr_array_add (extractions, extraction);
+
+	govf_package_extract_disks (ovf_package, extractions, &error);
+	g_assert_no_error (error);
+
+	g_assert_cmpuint (govf_extraction_get_size (extraction), ==, disk_size);
+	g_assert_cmpuint (govf_extraction_get_bytes_written (extraction), ==, 2 * 4096);
+
+	g_file_get_contents (filename, &contents, &length, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (length, ==, disk_size);
+	g_assert (memcmp (contents, disk_data, disk_size) == 0);
+
+	g_unlink (filename);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_disk_convert_raw (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *disk_data = NULL;
+	g_autofree gchar *filename1 = NULL;
+	g_autofree gchar *filename2 = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GByteArray) vmdk = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfExtractOptions) options = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	GovfExtraction *extraction1;
+	GovfExtraction *extraction2;
+	const gsize disk_size = 4 * VMDK_GRAIN_SIZE;
+	gsize length = 0;
+	gboolean compressed;
+	struct archive *a;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* the second and fourth grains are left out of the VMDK */
+	disk_data = g_malloc0 (disk_size);
+	memset (disk_data, 'a', VMDK_GRAIN_SIZE);
+	memset (disk_data + 2 * VMDK_GRAIN_SIZE, 'b', 4096);
+	vmdk = create_vmdk (disk_data, disk_size);
+
+	filename1 = g_build_filename (tmp_dir, "disk1.img", NULL);
+	filename2 = g_build_filename (tmp_dir, "disk2.img", NULL);
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+
+	/* grains are read from the member directly and through libarchive */
+	for (compressed = FALSE; compressed <= TRUE; compressed++) {
+		a = create_ova_open (ova_filename, compressed);
+		create_ova_member (a, "multi.ovf", multi_disk_ovf, strlen (multi_disk_ovf));
+		create_ova_member (a, "disk1.img", "first disk payload", 18);
+		create_ova_member (a, "disk2.img", (const gchar *) vmdk->data, vmdk->len);
+		create_ova_close (a);
+
+		g_clear_object (&ovf_package);
+		ovf_package = govf_package_new ();
+		govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+		g_assert_no_error (error);
+
+		g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+		ovf_disks = govf_package_get_disks (ovf_package);
+		g_assert (ovf_disks != NULL);
+
+		/* only disks in the streamOptimized format are converted */
+		extraction1 = govf_extraction_new (find_disk (ovf_disks, "disk1"), filename1);
+		govf_extraction_set_flags (extraction1, GOVF_EXTRACT_FLAGS_CONVERT_RAW);
+		extraction2 = govf_extraction_new (find_disk (ovf_disks, "disk2"), filename2);
+		govf_extraction_set_flags (extraction2, GOVF_EXTRACT_FLAGS_CONVERT_RAW);
+		g_clear_pointer (&extractions, g_ptr_array_unref);
+		extractions = g_ptr_array_new_with_free_func (g_object_unref);
+		g_ptr_array_add (extractions, extraction1);
+		g_ptr_array_add (extractions, extraction2);
+
+		govf_package_extract_disks (ovf_package, extractions, &error);
+		g_assert_no_error (error);
+
+		g_file_get_contents (filename1, &contents, &length, &error);
+		g_assert_no_error (error);
+		g_assert_cmpstr (contents, ==, "first disk payload");
+		g_clear_pointer (&contents, g_free);
+
+		g_assert_cmpuint (govf_extraction_get_size (extraction2), ==, disk_size);
+		g_assert_cmpuint (govf_extraction_get_bytes_written (extraction2), ==, disk_size);
+		g_file_get_contents (filename2, &contents, &length, &error);
+		g_assert_no_error (error);
+		g_assert_cmpuint (length, ==, disk_size);
+		g_assert (memcmp (contents, disk_data, disk_size) == 0);
+		g_clear_pointer (&contents, g_free);
+
+		/* missing grains are left as holes, also with a single
+		 * thread inflating them */
+		g_clear_object (&options);
+		options = govf_extract_options_new ();
+		govf_extract_options_set_convert_threads (options, 1);
+		govf_package_set_extract_options (ovf_package, options);
+		govf_extraction_set_flags (extraction2,
+		                           GOVF_EXTRACT_FLAGS_CONVERT_RAW |
+		                           GOVF_EXTRACT_FLAGS_SPARSE);
+		g_ptr_array_remove_index (extractions, 0);
+		govf_package_extract_disks (ovf_package, extractions, &error);
+		g_assert_no_error (error);
+
+		g_assert_cmpuint (govf_extraction_get_size (extraction2), ==, disk_size);
+		g_assert_cmpuint (govf_extraction_get_bytes_written (extraction2), ==, 2 * VMDK_GRAIN_SIZE);
+		g_file_get_contents (filename2, &contents, &length, &error);
+		g_assert_no_error (error);
+		g_assert_cmpuint (length, ==, disk_size);
+		g_assert (memcmp (contents, disk_data, disk_size) == 0);
+		g_clear_pointer (&contents, g_free);
+	}
+
+	g_unlink (filename1);
+	g_unlink (filename2);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_load_streaming (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	const gchar *disk_id;
+	gsize length = 0;
+	gchar data[] =
+"<?xml version=\"1.0\"?>"
+"<Envelope ovf:version=\"1.0\" xml:lang=\"en-US\" xmlns=\"http://schemas.dmtf.org/ovf/envelope/1\" xmlns:ovf=\"http://schemas.dmtf.org/ovf/envelope/1\" xmlns:vbox=\"http://www.virtualbox.org/ovf/machine\">"
+"  <VirtualSystem ovf:id=\"Fedora 23\">"
+"    <vbox:Machine>"
+"      <OperatingSystemSection ovf:id=\"80\"/>"
+"      <VirtualHardwareSection/>"
+"    </vbox:Machine>"
+"  </VirtualSystem>"
+"</Envelope>";
+
+	ovf_package = govf_package_new ();
+	govf_package_set_load_flags (ovf_package, GOVF_LOAD_FLAGS_STREAMING);
+	g_assert_cmpint (govf_package_get_load_flags (ovf_package), ==, GOVF_LOAD_FLAGS_STREAMING);
+
+	/* sections nested in vendor extensions don't count */
+	govf_package_load_from_data (ovf_package, data, -1, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_XML);
+	g_clear_error (&error);
+
+	govf_package_load_from_file (ovf_package,
+	                             g_test_get_filename (G_TEST_DIST, "Fedora_23.ovf", NULL),
+	                             &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 1);
+	disk_id = govf_disk_get_disk_id ((GovfDisk *) g_ptr_array_index (ovf_disks, 0));
+	g_assert_cmpstr (disk_id, ==, "vmdisk2");
+	g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* the document is built when saving */
+	filename = g_build_filename (tmp_dir, "Fedora_23.ovf", NULL);
+	govf_package_save_file (ovf_package, filename, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (filename, &contents, &length, &error);
+	g_assert_no_error (error);
+	g_assert (length > 0);
+	g_unlink (filename);
+	g_clear_pointer (&filename, g_free);
+
+	/* disks are looked up by the file references found while streaming */
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+
+	filename = g_build_filename (tmp_dir, "disk2.img", NULL);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error);
+	g_assert_no_error (error);
+	g_clear_pointer (&contents, g_free);
+	g_file_get_contents (filename, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+
+	g_unlink (filename);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_load_detached (void)
+{
+	g_autofree gchar *expected = NULL;
+	GovfLoadFlags flags[] = {
+		GOVF_LOAD_FLAGS_NONE,
+		GOVF_LOAD_FLAGS_STREAMING,
+		GOVF_LOAD_FLAGS_DETACHED
+	};
+	guint i;
+
+	/* the summary doesn't depend on how the package was loaded, and a
+	 * detached package saves the same as one that kept its tree */
+	for (i = 0; i < G_N_ELEMENTS (flags); i++) {
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GOutputStream) stream = NULL;
+		g_autoptr(GPtrArray) ovf_disks = NULL;
+		g_autoptr(GovfPackage) ovf_package = NULL;
+		gchar *saved;
+
+		ovf_package = govf_package_new ();
+		govf_package_set_load_flags (ovf_package, flags[i]);
+		govf_package_load_from_ova_file (ovf_package,
+		                                 g_test_get_filename (G_TEST_DIST, "Fedora_23.ova", NULL),
+		                                 &error);
+		g_assert_no_error (error);
+
+		g_assert_cmpstr (govf_package_get_name (ovf_package), ==, "Fedora 23");
+		g_assert_cmpstr (govf_package_get_description (ovf_package), ==, "Clean install of Fedora 23.");
+		g_assert_cmpstr (govf_package_get_os_id (ovf_package), ==, "100");
+		ovf_disks = govf_package_get_disks (ovf_package);
+		g_assert (ovf_disks != NULL);
+		g_assert (ovf_disks->len == 1);
+		g_assert_cmpstr (govf_disk_get_disk_id (g_ptr_array_index (ovf_disks, 0)), ==, "vmdisk2");
+
+		stream = g_memory_output_stream_new_resizable ();
+		govf_package_save_to_stream (ovf_package, stream, NULL, &error);
+		g_assert_no_error (error);
+		g_output_stream_write_all (stream, "", 1, NULL, NULL, &error);
+		g_assert_no_error (error);
+		g_output_stream_close (stream, NULL, &error);
+		g_assert_no_error (error);
+
+		saved = g_memory_output_stream_steal_data (G_MEMORY_OUTPUT_STREAM (stream));
+		if (expected == NULL) {
+			expected = saved;
+		} else {
+			g_assert_cmpstr (saved, ==, expected);
+			g_free (saved);
+		}
+	}
+}
+
+static void
+test_file_ref_quotes (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	const gchar data[] =
+"<?xml version=\"1.0\"?>"
+"<Envelope ovf:version=\"1.0\" xml:lang=\"en-US\" xmlns=\"http://schemas.dmtf.org/ovf/envelope/1\" xmlns:ovf=\"http://schemas.dmtf.org/ovf/envelope/1\">"
+"  <References>"
+"    <File ovf:href=\"disk1.img\" ovf:id=\"it's &quot;quoted&quot;\"/>"
+"  </References>"
+"  <DiskSection>"
+"    <Disk ovf:capacity=\"1024\" ovf:diskId=\"disk1\" ovf:fileRef=\"it's &quot;quoted&quot;\"/>"
+"  </DiskSection>"
+"  <VirtualSystem ovf:id=\"quotes\">"
+"    <OperatingSystemSection ovf:id=\"80\"/>"
+"    <VirtualHardwareSection/>"
+"  </VirtualSystem>"
+"</Envelope>";
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "quotes.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "quotes.ovf", data,
+	            "disk1.img", "first disk payload",
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+
+	filename = g_build_filename (tmp_dir, "disk1.img", NULL);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk1"), filename, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (filename, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "first disk payload");
+
+	g_unlink (filename);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_lookup (void)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) files = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	GovfLoadFlags flags;
+	GovfDisk *disk;
+	GovfFile *file;
+	const gchar data[] =
+"<?xml version=\"1.0\"?>"
+"<Envelope ovf:version=\"1.0\" xml:lang=\"en-US\" xmlns=\"http://schemas.dmtf.org/ovf/envelope/1\" xmlns:ovf=\"http://schemas.dmtf.org/ovf/envelope/1\">"
+"  <References>"
+"    <File ovf:href=\"disk1.vmdk.gz\" ovf:id=\"file1\" ovf:size=\"4096\" ovf:compression=\"gzip\"/>"
+"    <File ovf:href=\"disk2.vmdk\" ovf:id=\"file2\" ovf:size=\"8192\" ovf:chunkSize=\"2048\"/>"
+"    <File ovf:href=\"duplicate.vmdk\" ovf:id=\"file2\"/>"
+"  </References>"
+"  <DiskSection>"
+"    <Disk ovf:capacity=\"1024\" ovf:diskId=\"disk1\" ovf:fileRef=\"file1\"/>"
+"    <Disk ovf:capacity=\"2048\" ovf:diskId=\"disk2\" ovf:fileRef=\"file2\"/>"
+"  </DiskSection>"
+"  <VirtualSystem ovf:id=\"lookup\">"
+"    <OperatingSystemSection ovf:id=\"80\"/>"
+"    <VirtualHardwareSection/>"
+"  </VirtualSystem>"
+"</Envelope>";
+
+	/* both parse engines build the same indexes */
+	for (flags = GOVF_LOAD_FLAGS_NONE; flags <= GOVF_LOAD_FLAGS_STREAMING; flags++) {
+		g_clear_object (&ovf_package);
+		ovf_package = govf_package_new ();
+		govf_package_set_load_flags (ovf_package, flags);
+		govf_package_load_from_data (ovf_package, data, -1, &error);
+		g_assert_no_error (error);
+
+		g_clear_pointer (&files, g_ptr_array_unref);
+		files = govf_package_get_files (ovf_package);
+		g_assert (files != NULL);
+		g_assert_cmpint (files->len, ==, 3);
+
+		file = govf_package_lookup_file (ovf_package, "file1");
+		g_assert (file != NULL);
+		g_assert_cmpstr (govf_file_get_href (file), ==, "disk1.vmdk.gz");
+		g_assert_cmpstr (govf_file_get_size (file), ==, "4096");
+		g_assert_cmpstr (govf_file_get_compression (file), ==, "gzip");
+		g_assert_cmpstr (govf_file_get_chunk_size (file), ==, NULL);
+
+		/* the first of several files with the same id wins */
+		file = govf_package_lookup_file (ovf_package, "file2");
+		g_assert (file != NULL);
+		g_assert_cmpstr (govf_file_get_href (file), ==, "disk2.vmdk");
+		g_assert_cmpstr (govf_file_get_chunk_size (file), ==, "2048");
+
+		g_assert (govf_package_lookup_file (ovf_package, "file3") == NULL);
+
+		disk = govf_package_lookup_disk (ovf_package, "disk2");
+		g_assert (disk != NULL);
+		g_assert_cmpstr (govf_disk_get_capacity (disk), ==, "2048");
+		g_assert (govf_package_lookup_disk (ovf_package, "disk3") == NULL);
+	}
+}
+
+static void
+test_verify (void)
+{
+	g_autofree gchar *filename1 = NULL;
+	g_autofree gchar *filename2 = NULL;
+	g_autofree gchar *manifest = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *sha_disk1 = NULL;
+	g_autofree gchar *sha_disk2 = NULL;
+	g_autofree gchar *sha_ovf = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	GovfExtraction *extraction1;
+	GovfExtraction *extraction2;
+	gboolean compressed;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	filename1 = g_build_filename (tmp_dir, "disk1.img", NULL);
+	filename2 = g_build_filename (tmp_dir, "disk2.img", NULL);
+	sha_ovf = g_compute_checksum_for_string (G_CHECKSUM_SHA256, multi_disk_ovf, -1);
+	sha_disk1 = g_compute_checksum_for_string (G_CHECKSUM_SHA1, "first disk payload", -1);
+	sha_disk2 = g_compute_checksum_for_string (G_CHECKSUM_SHA256, "second disk payload", -1);
+
+	for (compressed = FALSE; compressed <= TRUE; compressed++) {
+		/* the second disk was modified after the manifest was written */
+		g_free (manifest);
+		manifest = g_strdup_printf ("SHA256(multi.ovf)= %s\n"
+		                            "SHA1(disk1.img)= %s\n"
+		                            "SHA256(disk2.img)= %s\n",
+		                            sha_ovf, sha_disk1, sha_disk2);
+		create_ova (ova_filename, compressed,
+		            "multi.ovf", multi_disk_ovf,
+		            "multi.mf", manifest,
+		            "disk1.img", "first disk payload",
+		            "disk2.img", "second disk payloaf",
+		            NULL);
+
+		g_clear_object (&ovf_package);
+		ovf_package = govf_package_new ();
+		govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+		g_assert_no_error (error);
+
+		g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+		ovf_disks = govf_package_get_disks (ovf_package);
+		g_assert (ovf_disks != NULL);
+
+		extraction1 = govf_extraction_new (find_disk (ovf_disks, "disk1"), filename1);
+		govf_extraction_set_flags (extraction1, GOVF_EXTRACT_FLAGS_VERIFY);
+		extraction2 = govf_extraction_new (find_disk (ovf_disks, "disk2"), filename2);
+		govf_extraction_set_flags (extraction2, GOVF_EXTRACT_FLAGS_VERIFY);
+		g_clear_pointer (&extractions, g_ptr_array_unref);
+		extractions = g_ptr_array_new_with_free_func (g_object_unref);
+		g_ptr_array_add (extractions, extraction1);
+		g_ptr_array_add (extractions, extraction2);
+
+		govf_package_extract_disks (ovf_package, extractions, &error);
+		g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+		g_clear_error (&error);
+
+		g_assert (govf_extraction_get_error (extraction1) == NULL);
+		g_assert (g_file_test (filename1, G_FILE_TEST_EXISTS));
+		g_assert_error (govf_extraction_get_error (extraction2),
+		                GOVF_PACKAGE_ERROR,
+		                GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH);
+		g_assert (!g_file_test (filename2, G_FILE_TEST_EXISTS));
+
+		govf_package_verify (ovf_package, NULL, &error);
+		g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH);
+		g_clear_error (&error);
+
+		/* errors name the file a GFile source was read from */
+		g_clear_object (&file);
+		file = g_file_new_for_path (ova_filename);
+		govf_package_load_from_gfile (ovf_package, file, NULL, &error);
+		g_assert_no_error (error);
+
+		g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+		ovf_disks = govf_package_get_disks (ovf_package);
+		g_assert (ovf_disks != NULL);
+
+		extraction2 = govf_extraction_new (find_disk (ovf_disks, "disk2"), filename2);
+		govf_extraction_set_flags (extraction2, GOVF_EXTRACT_FLAGS_VERIFY);
+		g_clear_pointer (&extractions, g_ptr_array_unref);
+		extractions = g_ptr_array_new_with_free_func (g_object_unref);
+		g_ptr_array_add (extractions, extraction2);
+
+		govf_package_extract_disks (ovf_package, extractions, &error);
+		g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+		g_clear_error (&error);
+		g_assert_error (govf_extraction_get_error (extraction2),
+		                GOVF_PACKAGE_ERROR,
+		                GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH);
+		g_assert (strstr (govf_extraction_get_error (extraction2)->message, ova_filename) != NULL);
+
+		/* a manifest that matches */
+		g_free (sha_disk2);
+		sha_disk2 = g_compute_checksum_for_string (G_CHECKSUM_SHA256, "second disk payloaf", -1);
+		g_free (manifest);
+		manifest = g_strdup_printf ("SHA256(multi.ovf)= %s\n"
+		                            "SHA1(disk1.img)= %s\n"
+		                            "SHA256(disk2.img)= %s\n",
+		                            sha_ovf, sha_disk1, sha_disk2);
+		create_ova (ova_filename, compressed,
+		            "multi.ovf", multi_disk_ovf,
+		            "multi.mf", manifest,
+		            "disk1.img", "first disk payload",
+		            "disk2.img", "second disk payloaf",
+		            NULL);
+
+		govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+		g_assert_no_error (error);
+		govf_package_verify (ovf_package, NULL, &error);
+		g_assert_no_error (error);
+
+		g_free (sha_disk2);
+		sha_disk2 = g_compute_checksum_for_string (G_CHECKSUM_SHA256, "second disk payload", -1);
+		g_unlink (filename1);
+	}
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+/* extracts a single disk, verified against the manifest */
+static gboolean
+extract_one (GovfPackage *ovf_package, GovfDisk *disk, const gchar *save_path, GError **error)
+{
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	GovfExtraction *extraction;
+
+	extraction = govf_extraction_new (disk, save_path);
+	govf_extraction_set_flags (extraction, GOVF_EXTRACT_FLAGS_VERIFY);
+	extractions = g_ptr_array_new_with_free_func (g_object_unref);
+	g_ptr_array_add (extractions, extraction);
+
+	if (govf_package_extract_disks (ovf_package, extractions, &error_local))
+		return TRUE;
+	g_propagate_error (error, g_error_copy (govf_extraction_get_error (extraction)));
+	return FALSE;
+}
+
+/* a failed extraction only removes a file it created itself */
+static void
+test_extract_existing_target (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *manifest = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *sha_disk2 = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	struct stat st;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* no digest for the first disk, a wrong one for the second */
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	sha_disk2 = g_compute_checksum_for_string (G_CHECKSUM_SHA256, "second disk payload", -1);
+	manifest = g_strdup_printf ("SHA256(disk2.img)= %s\n", sha_disk2);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "multi.mf", manifest,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payloaf",
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+
+	/* failing before any data is copied leaves the file untouched */
+	filename = g_build_filename (tmp_dir, "disk.img", NULL);
+	g_file_set_contents (filename, "precious", -1, &error);
+	g_assert_no_error (error);
+	g_assert (!extract_one (ovf_package, find_disk (ovf_disks, "disk1"), filename, &error));
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_NOT_FOUND);
+	g_clear_error (&error);
+	g_file_get_contents (filename, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "precious");
+
+	/* failing later overwrites it, but doesn't remove it */
+	g_assert (!extract_one (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error));
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH);
+	g_clear_error (&error);
+	g_assert (g_file_test (filename, G_FILE_TEST_EXISTS));
+	g_unlink (filename);
+
+	/* nor a target that isn't a regular file */
+	if (g_stat ("/dev/null", &st) == 0 && S_ISCHR (st.st_mode)) {
+		g_assert (!extract_one (ovf_package, find_disk (ovf_disks, "disk2"), "/dev/null", &error));
+		g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH);
+		g_clear_error (&error);
+		g_assert_cmpint (g_stat ("/dev/null", &st), ==, 0);
+		g_assert (S_ISCHR (st.st_mode));
+	}
+
+	/* a file the extraction created is removed */
+	g_assert (!extract_one (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error));
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH);
+	g_clear_error (&error);
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_write_ova (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *disk1_filename = NULL;
+	g_autofree gchar *disk2_filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *save_path = NULL;
+	g_autofree gchar *src_dir = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	g_autoptr(GovfPackage) written_package = NULL;
+	const gchar *bad_hrefs[] = {
+		"ovf:href=\"../disk1.img\"",
+		"ovf:href=\"src/../../disk1.img\"",
+		"ovf:href=\"/etc/passwd\"",
+		"ovf:href=\"\""
+	};
+	guint i;
+	struct archive *a;
+	struct archive_entry *entry;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	src_dir = g_build_filename (tmp_dir, "src", NULL);
+	g_assert_cmpint (g_mkdir (src_dir, 0755), ==, 0);
+	disk1_filename = g_build_filename (src_dir, "disk1.img", NULL);
+	g_file_set_contents (disk1_filename, "first disk payload", -1, &error);
+	g_assert_no_error (error);
+	disk2_filename = g_build_filename (src_dir, "disk2.img", NULL);
+	g_file_set_contents (disk2_filename, "second disk payload", -1, &error);
+	g_assert_no_error (error);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_data (ovf_package, multi_disk_ovf, -1, &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "appliance.ova", NULL);
+	govf_package_write_ova (ovf_package, ova_filename, src_dir, NULL, &error);
+	g_assert_no_error (error);
+
+	/* descriptor first, then the manifest, then the files */
+	a = archive_read_new ();
+	archive_read_support_format_tar (a);
+	g_assert_cmpint (archive_read_open_filename (a, ova_filename, 10240), ==, ARCHIVE_OK);
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpstr (archive_entry_pathname (entry), ==, "appliance.ovf");
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpstr (archive_entry_pathname (entry), ==, "appliance.mf");
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpstr (archive_entry_pathname (entry), ==, "disk1.img");
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpstr (archive_entry_pathname (entry), ==, "disk2.img");
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_EOF);
+	archive_read_free (a);
+
+	written_package = govf_package_new ();
+	govf_package_load_from_ova_file (written_package, ova_filename, &error);
+	g_assert_no_error (error);
+	govf_package_verify (written_package, NULL, &error);
+	g_assert_no_error (error);
+
+	ovf_disks = govf_package_get_disks (written_package);
+	g_assert (ovf_disks != NULL);
+	save_path = g_build_filename (tmp_dir, "disk2.img", NULL);
+	govf_package_extract_disk (written_package, find_disk (ovf_disks, "disk2"), save_path, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (save_path, &contents, NULL, NULL);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+
+	/* a referenced file that is missing */
+	g_unlink (disk2_filename);
+	govf_package_write_ova (ovf_package, ova_filename, src_dir, NULL, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_NOT_FOUND);
+	g_assert (!g_file_test (ova_filename, G_FILE_TEST_EXISTS));
+	g_clear_error (&error);
+
+	/* hrefs that point outside the source directory */
+	for (i = 0; i < G_N_ELEMENTS (bad_hrefs); i++) {
+		g_autofree gchar *bad_ovf = NULL;
+		g_auto(GStrv) parts = NULL;
+		g_autoptr(GovfPackage) bad_package = NULL;
+
+		parts = g_strsplit (multi_disk_ovf, "ovf:href=\"disk1.img\"", 2);
+		bad_ovf = g_strjoinv (bad_hrefs[i], parts);
+		bad_package = govf_package_new ();
+		govf_package_load_from_data (bad_package, bad_ovf, -1, &error);
+		g_assert_no_error (error);
+		govf_package_write_ova (bad_package, ova_filename, src_dir, NULL, &error);
+		g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+		g_assert (!g_file_test (ova_filename, G_FILE_TEST_EXISTS));
+		g_clear_error (&error);
+	}
+
+	g_unlink (save_path);
+	g_unlink (disk1_filename);
+	g_rmdir (src_dir);
+	g_rmdir (tmp_dir);
+}
+
+/* members of 8 GiB and over don't fit in a plain ustar header */
+static void
+test_write_ova_large (void)
+{
+	const goffset large_size = G_GINT64_CONSTANT (8) * 1024 * 1024 * 1024 + 1;
+	g_autofree gchar *disk1_filename = NULL;
+	g_autofree gchar *disk2_filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *src_dir = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	g_autoptr(GovfPackage) written_package = NULL;
+	struct archive *a;
+	struct archive_entry *entry;
+	struct statvfs vfs;
+	gchar c = 'x';
+	gint fd;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* the source is sparse, but the .ova file holds every byte */
+	if (statvfs (tmp_dir, &vfs) != 0 ||
+	    (guint64) vfs.f_bavail * vfs.f_frsize < (guint64) large_size + 64 * 1024 * 1024) {
+		g_test_skip ("Not enough space for an 8 GiB .ova file");
+		g_rmdir (tmp_dir);
+		return;
+	}
+
+	src_dir = g_build_filename (tmp_dir, "src", NULL);
+	g_assert_cmpint (g_mkdir (src_dir, 0755), ==, 0);
+	disk1_filename = g_build_filename (src_dir, "disk1.img", NULL);
+	fd = g_open (disk1_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	g_assert_cmpint (fd, !=, -1);
+	if (ftruncate (fd, large_size) != 0) {
+		close (fd);
+		g_test_skip ("Cannot create an 8 GiB sparse file");
+		g_unlink (disk1_filename);
+		g_rmdir (src_dir);
+		g_rmdir (tmp_dir);
+		return;
+	}
+	g_assert_cmpint (close (fd), ==, 0);
+	disk2_filename = g_build_filename (src_dir, "disk2.img", NULL);
+	g_file_set_contents (disk2_filename, "second disk payload", -1, &error);
+	g_assert_no_error (error);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_data (ovf_package, multi_disk_ovf, -1, &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "appliance.ova", NULL);
+	govf_package_write_ova (ovf_package, ova_filename, src_dir, NULL, &error);
+	g_assert_no_error (error);
+
+	a = archive_read_new ();
+	archive_read_support_format_tar (a);
+	g_assert_cmpint (archive_read_open_filename (a, ova_filename, 10240), ==, ARCHIVE_OK);
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpstr (archive_entry_pathname (entry), ==, "disk1.img");
+	g_assert_cmpint (archive_entry_size (entry), ==, large_size);
+	g_assert_cmpint (archive_read_next_header (a, &entry), ==, ARCHIVE_OK);
+	g_assert_cmpstr (archive_entry_pathname (entry), ==, "disk2.img");
+	archive_read_free (a);
+
+	/* the members after the large one are found where they are */
+	written_package = govf_package_new ();
+	govf_package_load_from_ova_file (written_package, ova_filename, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (written_package);
+	stream = govf_package_open_disk (written_package, find_disk (ovf_disks, "disk1"), &error);
+	g_assert_no_error (error);
+	g_seekable_seek (G_SEEKABLE (stream), -1, G_SEEK_END, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (g_input_stream_read (stream, &c, 1, NULL, &error), ==, 1);
+	g_assert_no_error (error);
+	g_assert_cmpint (c, ==, 0);
+	g_clear_object (&stream);
+
+	stream = govf_package_open_disk (written_package, find_disk (ovf_disks, "disk2"), &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (g_input_stream_read (stream, &c, 1, NULL, &error), ==, 1);
+	g_assert_no_error (error);
+	g_assert_cmpint (c, ==, 's');
+
+	g_unlink (ova_filename);
+	g_unlink (disk1_filename);
+	g_unlink (disk2_filename);
+	g_rmdir (src_dir);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_load_metadata_only (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *payload = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	CountingInputStream *stream;
+	gsize length;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* the disks come before the descriptor */
+	payload = g_strnfill (8 * 1024 * 1024, 'x');
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "disk1.img", payload,
+	            "disk2.img", payload,
+	            "multi.ovf", multi_disk_ovf,
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_set_load_flags (ovf_package, GOVF_LOAD_FLAGS_METADATA_ONLY);
+	g_assert_cmpint (govf_package_get_load_flags (ovf_package), ==, GOVF_LOAD_FLAGS_METADATA_ONLY);
+
+	g_file_get_contents (ova_filename, &contents, &length, &error);
+	g_assert_no_error (error);
+	stream = g_object_new (counting_input_stream_get_type (), NULL);
+	g_memory_input_stream_add_data (G_MEMORY_INPUT_STREAM (stream),
+	                                g_steal_pointer (&contents),
+	                                length,
+	                                g_free);
+	govf_package_load_from_stream (ovf_package, G_INPUT_STREAM (stream), NULL, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+	g_assert_cmpuint (govf_package_get_bytes_read (ovf_package), ==, stream->bytes_read);
+	g_assert_cmpuint (stream->bytes_read, <, 256 * 1024);
+	g_clear_object (&ovf_package);
+	g_object_unref (stream);
+
+	ovf_package = govf_package_new ();
+	govf_package_set_load_flags (ovf_package, GOVF_LOAD_FLAGS_METADATA_ONLY);
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (govf_package_get_bytes_read (ovf_package), >, 0);
+	g_assert_cmpuint (govf_package_get_bytes_read (ovf_package), <, 256 * 1024);
+
+	/* a compressed archive can't be stepped over without reading it */
+	create_ova (ova_filename, TRUE,
+	            "disk1.img", payload,
+	            "multi.ovf", multi_disk_ovf,
+	            NULL);
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+	g_clear_error (&error);
+
+	govf_package_set_load_flags (ovf_package, GOVF_LOAD_FLAGS_NONE);
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_extract_options (void)
+{
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *payload = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GovfExtractOptions) options = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	gboolean compressed;
+	guint i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* not a multiple of the block size, to leave a partial block at the end */
+	payload = g_malloc (3 * 8192 + 100 + 1);
+	for (i = 0; i < 3 * 8192 + 100; i++)
+		payload[i] = 'a' + i % 26;
+	payload[i] = '\0';
+
+	options = govf_extract_options_new ();
+	g_assert_cmpuint (govf_extract_options_get_block_size (options), ==, 0);
+	g_assert_cmpint (govf_extract_options_get_flags (options), ==, GOVF_IO_FLAGS_NONE);
+	g_assert_cmpuint (govf_extract_options_get_convert_threads (options), ==, 0);
+	govf_extract_options_set_block_size (options, 8192);
+	govf_extract_options_set_flags (options,
+	                                GOVF_IO_FLAGS_DROP_CACHE |
+	                                GOVF_IO_FLAGS_DIRECT |
+	                                GOVF_IO_FLAGS_PREALLOCATE);
+	g_assert_cmpuint (govf_extract_options_get_block_size (options), ==, 8192);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	filename = g_build_filename (tmp_dir, "disk1.img", NULL);
+	for (compressed = FALSE; compressed <= TRUE; compressed++) {
+		g_autofree gchar *contents = NULL;
+		g_autoptr(GPtrArray) ovf_disks = NULL;
+		gsize length;
+
+		create_ova (ova_filename, compressed,
+		            "multi.ovf", multi_disk_ovf,
+		            "disk1.img", payload,
+		            "disk2.img", "second disk payload",
+		            NULL);
+
+		g_clear_object (&ovf_package);
+		ovf_package = govf_package_new ();
+		g_assert (govf_package_get_extract_options (ovf_package) == NULL);
+		govf_package_set_extract_options (ovf_package, options);
+		g_assert (govf_package_get_extract_options (ovf_package) == options);
+		govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+		g_assert_no_error (error);
+
+		ovf_disks = govf_package_get_disks (ovf_package);
+		g_assert (ovf_disks != NULL);
+		govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk1"), filename, &error);
+		g_assert_no_error (error);
+
+		g_file_get_contents (filename, &contents, &length, &error);
+		g_assert_no_error (error);
+		g_assert_cmpuint (length, ==, strlen (payload));
+		g_assert_cmpstr (contents, ==, payload);
+		g_unlink (filename);
+	}
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+#ifdef HAVE_LIBURING
+static void
+test_extract_io_uring (void)
+{
+	g_autofree gchar *bad_manifest = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *manifest = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *payload = NULL;
+	g_autofree gchar *sha_disk1 = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GovfExtractOptions) options = NULL;
+	struct io_uring ring;
+	gsize payload_size;
+	guint i;
+
+	/* io_uring may be disabled or filtered out by a sandbox */
+	if (io_uring_queue_init (8, &ring, 0) < 0) {
+		g_test_skip ("io_uring is not available");
+		return;
+	}
+	io_uring_queue_exit (&ring);
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	/* hundreds of small blocks, so that completions come back out of
+	 * order, and a partial block at the end */
+	payload_size = 1024 * 1024 + 123;
+	payload = g_malloc (payload_size);
+	for (i = 0; i < payload_size; i++)
+		payload[i] = (i * 7 + i / 4096) % 251;
+	sha_disk1 = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) payload, payload_size);
+	manifest = g_strdup_printf ("SHA256(disk1.img)= %s\n", sha_disk1);
+	bad_manifest = g_strdup_printf ("SHA256(disk1.img)= %064x\n", 0);
+
+	options = govf_extract_options_new ();
+	govf_extract_options_set_block_size (options, 4096);
+	govf_extract_options_set_flags (options, GOVF_IO_FLAGS_IO_URING);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	filename = g_build_filename (tmp_dir, "disk1.img", NULL);
+	for (i = 0; i < 2; i++) {
+		g_autofree gchar *contents = NULL;
+		g_autoptr(GPtrArray) extractions = NULL;
+		g_autoptr(GPtrArray) ovf_disks = NULL;
+		g_autoptr(GovfPackage) ovf_package = NULL;
+		GovfExtraction *extraction;
+		struct archive *a;
+		gsize length;
+
+		/* uncompressed, so that the member is copied at its offset */
+		a = create_ova_open (ova_filename, FALSE);
+		create_ova_member (a, "multi.ovf", multi_disk_ovf, strlen (multi_disk_ovf));
+		create_ova_member (a, "multi.mf", i == 0 ? manifest : bad_manifest,
+		                   strlen (i == 0 ? manifest : bad_manifest));
+		create_ova_member (a, "disk1.img", payload, payload_size);
+		create_ova_member (a, "disk2.img", "second disk payload", strlen ("second disk payload"));
+		create_ova_close (a);
+
+		ovf_package = govf_package_new ();
+		govf_package_set_extract_options (ovf_package, options);
+		govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+		g_assert_no_error (error);
+
+		ovf_disks = govf_package_get_disks (ovf_package);
+		g_assert (ovf_disks != NULL);
+
+		/* verifying keeps the in-kernel copies out of the way */
+		extraction = govf_extraction_new (find_disk (ovf_disks, "disk1"), filename);
+		govf_extraction_set_flags (extraction, GOVF_EXTRACT_FLAGS_VERIFY);
+		extractions = g_ptr_array_new_with_free_func (g_object_unref);
+		g_ptr_array_add (extractions, extraction);
+
+		govf_package_extract_disks (ovf_package, extractions, &error);
+		if (i == 1) {
+			g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+			g_assert_error (govf_extraction_get_error (extraction),
+			                GOVF_PACKAGE_ERROR,
+			                GOVF_PACKAGE_ERROR_CHECKSUM_MISMATCH);
+			g_clear_error (&error);
+			g_unlink (filename);
+			continue;
+		}
+		g_assert_no_error (error);
+		g_assert_cmpuint (govf_extraction_get_bytes_written (extraction), ==, payload_size);
+
+		g_file_get_contents (filename, &contents, &length, &error);
+		g_assert_no_error (error);
+		g_assert_cmpuint (length, ==, payload_size);
+		g_assert (memcmp (contents, payload, payload_size) == 0);
+		g_unlink (filename);
+	}
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+#endif
+
+static void
+test_stats (void)
+{
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) extractions = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	GovfExtraction *extraction;
+	guint i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	for (i = 0; i < GOVF_PACKAGE_STAT_LAST; i++)
+		g_assert_cmpuint (govf_package_get_stat (ovf_package, i), ==, 0);
+
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_HEADERS_SCANNED), ==, 3);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_MEMBERS_VISITED), ==, 1);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_BYTES_READ), ==,
+	                  govf_package_get_bytes_read (ovf_package));
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_BYTES_WRITTEN), ==, 0);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+
+	filename = g_build_filename (tmp_dir, "disk.img", NULL);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_MEMBERS_VISITED), ==, 2);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_BYTES_WRITTEN), ==,
+	                  strlen ("second disk payload"));
+	g_unlink (filename);
+
+	/* a reflink or in-kernel copy reads nothing itself, while a sparse
+	 * copy reads the member through userspace */
+	govf_package_reset_stats (ovf_package);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_BYTES_READ), <=,
+	                  strlen ("second disk payload"));
+	g_unlink (filename);
+
+	govf_package_reset_stats (ovf_package);
+	extraction = govf_extraction_new (find_disk (ovf_disks, "disk2"), filename);
+	govf_extraction_set_flags (extraction, GOVF_EXTRACT_FLAGS_SPARSE);
+	extractions = g_ptr_array_new_with_free_func (g_object_unref);
+	g_ptr_array_add (extractions, extraction);
+	govf_package_extract_disks (ovf_package, extractions, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_BYTES_READ), ==,
+	                  strlen ("second disk payload"));
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_BYTES_WRITTEN), ==,
+	                  strlen ("second disk payload"));
+	g_unlink (filename);
+
+	govf_package_reset_stats (ovf_package);
+	for (i = 0; i < GOVF_PACKAGE_STAT_LAST; i++)
+		g_assert_cmpuint (govf_package_get_stat (ovf_package, i), ==, 0);
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+/* the path of the one entry in a cache directory */
+static gchar *
+get_cache_entry (const gchar *cache_dir)
+{
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GError) error = NULL;
+	const gchar *name;
+
+	dir = g_dir_open (cache_dir, 0, &error);
+	g_assert_no_error (error);
+	name = g_dir_read_name (dir);
+	g_assert (name != NULL);
+	g_assert (g_dir_read_name (dir) == NULL);
+
+	return g_build_filename (cache_dir, name, NULL);
+}
+
+static GovfPackage *
+load_cached (const gchar *ova_filename, const gchar *cache_dir)
+{
+	g_autoptr(GError) error = NULL;
+	GovfPackage *ovf_package;
+
+	ovf_package = govf_package_new ();
+	govf_package_set_cache_dir (ovf_package, cache_dir);
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+
+	return ovf_package;
+}
+
+static void
+test_load_cache (void)
+{
+	g_autofree gchar *cache_dir = NULL;
+	g_autofree gchar *cache_entry = NULL;
+	g_autofree gchar *changed_ovf = NULL;
+	g_autofree gchar *contents = NULL;
+	g_autofree gchar *digest = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *manifest = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	struct utimbuf times = { 1000000000, 1000000000 };
+	gchar *id;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	cache_dir = g_build_filename (tmp_dir, "cache", NULL);
+
+	digest = g_compute_checksum_for_string (G_CHECKSUM_SHA256, "second disk payload", -1);
+	manifest = g_strdup_printf ("SHA256(disk2.img)= %s\n", digest);
+
+	/* with a whole second for an mtime, so that it can be put back */
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "multi.mf", manifest,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+	g_assert_cmpint (g_utime (ova_filename, &times), ==, 0);
+
+	/* a cold load scans the archive and fills in the cache */
+	ovf_package = load_cached (ova_filename, cache_dir);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_CACHE_HITS), ==, 0);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_HEADERS_SCANNED), ==, 4);
+	cache_entry = get_cache_entry (cache_dir);
+	g_clear_object (&ovf_package);
+
+	/* a warm one has everything a cold one has, without the scan */
+	ovf_package = load_cached (ova_filename, cache_dir);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_CACHE_HITS), ==, 1);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_HEADERS_SCANNED), ==, 0);
+	g_assert_cmpstr (govf_package_get_name (ovf_package), ==, "multi");
+	g_assert_cmpstr (govf_package_get_os_id (ovf_package), ==, "80");
+	g_assert (govf_package_lookup_file (ovf_package, "file2") != NULL);
+
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+	g_assert (ovf_disks->len == 2);
+	g_assert_cmpstr (govf_disk_get_capacity (find_disk (ovf_disks, "disk1")), ==, "1024");
+	g_assert (govf_disk_get_format (find_disk (ovf_disks, "disk1")) == NULL);
+
+	filename = g_build_filename (tmp_dir, "disk.img", NULL);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error);
+	g_assert_no_error (error);
+	g_file_get_contents (filename, &contents, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (contents, ==, "second disk payload");
+	g_unlink (filename);
+
+	govf_package_verify (ovf_package, NULL, &error);
+	g_assert_no_error (error);
+	g_clear_object (&ovf_package);
+	g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+
+	/* a descriptor rewritten to the same size and mtime is caught by
+	 * reading it back */
+	changed_ovf = g_strdup (multi_disk_ovf);
+	id = strstr (changed_ovf, "ovf:id=\"multi\"");
+	g_assert (id != NULL);
+	memcpy (id + strlen ("ovf:id=\""), "multj", strlen ("multj"));
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", changed_ovf,
+	            "multi.mf", manifest,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+	g_assert_cmpint (g_utime (ova_filename, &times), ==, 0);
+
+	ovf_package = load_cached (ova_filename, cache_dir);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_CACHE_HITS), ==, 0);
+	g_assert_cmpstr (govf_package_get_name (ovf_package), ==, "multj");
+	g_clear_object (&ovf_package);
+
+	/* a touched file misses, as does a corrupt entry; either is
+	 * replaced with a fresh one */
+	times.modtime++;
+	g_assert_cmpint (g_utime (ova_filename, &times), ==, 0);
+	ovf_package = load_cached (ova_filename, cache_dir);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_CACHE_HITS), ==, 0);
+	g_clear_object (&ovf_package);
+
+	g_file_set_contents (cache_entry, "garbage", -1, &error);
+	g_assert_no_error (error);
+	ovf_package = load_cached (ova_filename, cache_dir);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_CACHE_HITS), ==, 0);
+	g_assert_cmpstr (govf_package_get_name (ovf_package), ==, "multj");
+	g_clear_object (&ovf_package);
+
+	ovf_package = load_cached (ova_filename, cache_dir);
+	g_assert_cmpuint (govf_package_get_stat (ovf_package, GOVF_PACKAGE_STAT_CACHE_HITS), ==, 1);
+	g_clear_object (&ovf_package);
+
+	g_unlink (cache_entry);
+	g_rmdir (cache_dir);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+catalog_collect_cb (GovfCatalogEntry *entry, gpointer user_data)
+{
+	GPtrArray *entries = user_data;
+
+	g_ptr_array_add (entries, g_object_ref (entry));
+}
+
+static void
+test_catalog (void)
+{
+	g_autofree gchar *broken_filename = NULL;
+	g_autofree gchar *missing_filename = NULL;
+	g_autofree gchar *nested_dir = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *path = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GCancellable) cancellable = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) entries = NULL;
+	g_autoptr(GovfCatalog) catalog = NULL;
+	const gchar *filenames[3];
+	guint n_failed = 0;
+	guint i;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	nested_dir = g_build_filename (tmp_dir, "nested", NULL);
+	g_assert_cmpint (g_mkdir (nested_dir, 0755), ==, 0);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+	path = g_build_filename (nested_dir, "multi.ova", NULL);
+	create_ova (path, TRUE, "multi.ovf", multi_disk_ovf, NULL);
+	g_free (path);
+	path = g_build_filename (tmp_dir, "multi.OVF", NULL);
+	g_file_set_contents (path, multi_disk_ovf, -1, &error);
+	g_assert_no_error (error);
+	g_free (path);
+	broken_filename = g_build_filename (tmp_dir, "broken.ova", NULL);
+	g_file_set_contents (broken_filename, "not an archive", -1, &error);
+	g_assert_no_error (error);
+
+	/* left out of a directory scan */
+	path = g_build_filename (tmp_dir, "notes.txt", NULL);
+	g_file_set_contents (path, "not a package", -1, &error);
+	g_assert_no_error (error);
+	g_free (path);
+	path = g_build_filename (tmp_dir, ".hidden.ova", NULL);
+	g_file_set_contents (path, "not an archive", -1, &error);
+	g_assert_no_error (error);
+	g_free (path);
+
+	catalog = govf_catalog_new ();
+	govf_catalog_set_max_threads (catalog, 2);
+
+	entries = g_ptr_array_new_with_free_func (g_object_unref);
+	govf_catalog_scan_dir (catalog, tmp_dir, catalog_collect_cb, entries, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (entries->len, ==, 4);
+
+	for (i = 0; i < entries->len; i++) {
+		GovfCatalogEntry *entry = g_ptr_array_index (entries, i);
+		g_autoptr(GPtrArray) ovf_disks = NULL;
+
+		if (g_strcmp0 (govf_catalog_entry_get_filename (entry), broken_filename) == 0) {
+			g_assert (govf_catalog_entry_get_error (entry) != NULL);
+			n_failed++;
+			continue;
+		}
+
+		g_assert (govf_catalog_entry_get_error (entry) == NULL);
+		g_assert_cmpstr (govf_catalog_entry_get_name (entry), ==, "multi");
+		g_assert_cmpstr (govf_catalog_entry_get_os_id (entry), ==, "80");
+		ovf_disks = govf_catalog_entry_get_disks (entry);
+		g_assert (ovf_disks != NULL);
+		g_assert (ovf_disks->len == 2);
+		g_assert_cmpstr (govf_disk_get_capacity (find_disk (ovf_disks, "disk2")), ==, "1024");
+	}
+	g_assert_cmpuint (n_failed, ==, 1);
+
+	/* a file that doesn't exist gets an entry with the error */
+	missing_filename = g_build_filename (tmp_dir, "missing.ova", NULL);
+	filenames[0] = ova_filename;
+	filenames[1] = missing_filename;
+	filenames[2] = NULL;
+	g_ptr_array_set_size (entries, 0);
+	govf_catalog_scan_files (catalog, filenames, catalog_collect_cb, entries, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpuint (entries->len, ==, 2);
+	for (i = 0; i < entries->len; i++) {
+		GovfCatalogEntry *entry = g_ptr_array_index (entries, i);
+		gboolean missing;
+
+		missing = g_strcmp0 (govf_catalog_entry_get_filename (entry), missing_filename) == 0;
+		g_assert ((govf_catalog_entry_get_error (entry) != NULL) == missing);
+	}
+
+	cancellable = g_cancellable_new ();
+	g_cancellable_cancel (cancellable);
+	g_ptr_array_set_size (entries, 0);
+	govf_catalog_scan_dir (catalog, tmp_dir, catalog_collect_cb, entries, cancellable, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert_cmpuint (entries->len, ==, 0);
+
+	path = g_build_filename (nested_dir, "multi.ova", NULL);
+	g_unlink (path);
+	g_free (path);
+	g_rmdir (nested_dir);
+	path = g_build_filename (tmp_dir, "multi.OVF", NULL);
+	g_unlink (path);
+	g_free (path);
+	path = g_build_filename (tmp_dir, "notes.txt", NULL);
+	g_unlink (path);
+	g_free (path);
+	path = g_build_filename (tmp_dir, ".hidden.ova", NULL);
+	g_unlink (path);
+	g_unlink (broken_filename);
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+test_open_disk (void)
+{
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *ova_filename = NULL;
+	g_autofree gchar *tmp_dir = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GInputStream) stream = NULL;
+	g_autoptr(GPtrArray) ovf_disks = NULL;
+	g_autoptr(GovfPackage) ovf_package = NULL;
+	gchar buf[64];
+	gsize n;
+
+	tmp_dir = g_dir_make_tmp ("libgovf-test-XXXXXX", &error);
+	g_assert_no_error (error);
+
+	ova_filename = g_build_filename (tmp_dir, "multi.ova", NULL);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (ovf_package);
+	g_assert (ovf_disks != NULL);
+
+	stream = govf_package_open_disk (ovf_package, find_disk (ovf_disks, "disk2"), &error);
+	g_assert_no_error (error);
+	g_assert (G_IS_SEEKABLE (stream));
+
+	/* the stream doesn't need the package */
+	g_clear_object (&ovf_package);
+
+	memset (buf, 0, sizeof (buf));
+	g_input_stream_read_all (stream, buf, sizeof (buf), &n, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (buf, ==, "second disk payload");
+	g_assert_cmpint (g_seekable_tell (G_SEEKABLE (stream)), ==, n);
+
+	memset (buf, 0, sizeof (buf));
+	g_seekable_seek (G_SEEKABLE (stream), 7, G_SEEK_SET, NULL, &error);
+	g_assert_no_error (error);
+	g_input_stream_read_all (stream, buf, 4, &n, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (buf, ==, "disk");
+
+	memset (buf, 0, sizeof (buf));
+	g_seekable_seek (G_SEEKABLE (stream), -7, G_SEEK_END, NULL, &error);
+	g_assert_no_error (error);
+	g_input_stream_read_all (stream, buf, sizeof (buf), &n, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (buf, ==, "payload");
+
+	/* reads never run into the next member */
+	g_seekable_seek (G_SEEKABLE (stream), 1, G_SEEK_END, NULL, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+	g_clear_error (&error);
+
+	g_input_stream_close (stream, NULL, &error);
+	g_assert_no_error (error);
+	g_clear_object (&stream);
+	g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+
+	/* the offsets are those of the file as it was loaded */
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (ovf_package);
+	create_ova (ova_filename, FALSE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "a longer first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+	stream = govf_package_open_disk (ovf_package, find_disk (ovf_disks, "disk2"), &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+	g_assert (strstr (error->message, "changed since it was loaded") != NULL);
+	g_assert (stream == NULL);
+	g_clear_error (&error);
+
+	filename = g_build_filename (tmp_dir, "disk2.img", NULL);
+	govf_package_extract_disk (ovf_package, find_disk (ovf_disks, "disk2"), filename, &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+	g_assert (strstr (error->message, "changed since it was loaded") != NULL);
+	g_clear_error (&error);
+	g_unlink (filename);
+	g_clear_pointer (&ovf_disks, g_ptr_array_unref);
+	g_clear_object (&ovf_package);
+
+	/* a compressed archive has to be extracted */
+	create_ova (ova_filename, TRUE,
+	            "multi.ovf", multi_disk_ovf,
+	            "disk1.img", "first disk payload",
+	            "disk2.img", "second disk payload",
+	            NULL);
+
+	ovf_package = govf_package_new ();
+	govf_package_load_from_ova_file (ovf_package, ova_filename, &error);
+	g_assert_no_error (error);
+	ovf_disks = govf_package_get_disks (ovf_package);
+	stream = govf_package_open_disk (ovf_package, find_disk (ovf_disks, "disk1"), &error);
+	g_assert_error (error, GOVF_PACKAGE_ERROR, GOVF_PACKAGE_ERROR_FAILED);
+	g_assert (stream == NULL);
+
+	g_unlink (ova_filename);
+	g_rmdir (tmp_dir);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -175,8 +2873,36 @@ main (int   argc,
 	g_test_add_func ("/parser/load-valid-ovf", test_load_valid_ovf);
 	g_test_add_func ("/parser/load-valid-ova", test_load_valid_ova);
 	g_test_add_func ("/parser/save-ovf", test_save_ovf);
+	g_test_add_func ("/parser/save-to-stream", test_save_to_stream);
 	g_test_add_func ("/parser/get-disks", test_get_disks);
 	g_test_add_func ("/parser/extract-disk", test_extract_disk);
+	g_test_add_func ("/parser/extract-disk-indexed", test_extract_disk_indexed);
+	g_test_add_func ("/parser/extract-disks", test_extract_disks);
+	g_test_add_func ("/parser/extract-disks-parallel", test_extract_disks_parallel);
+	g_test_add_func ("/parser/extract-disks-compressed", test_extract_disks_compressed);
+	g_test_add_func ("/parser/extract-disk-async", test_extract_disk_async);
+	g_test_add_func ("/parser/extract-concurrent", test_extract_concurrent);
+	g_test_add_func ("/parser/extract-cancel-stalled", test_extract_cancel_stalled);
+	g_test_add_func ("/parser/load-from-stream", test_load_from_stream);
+	g_test_add_func ("/parser/extract-disk-sparse", test_extract_disk_sparse);
+	g_test_add_func ("/parser/extract-disk-convert-raw", test_extract_disk_convert_raw);
+	g_test_add_func ("/parser/load-streaming", test_load_streaming);
+	g_test_add_func ("/parser/load-detached", test_load_detached);
+	g_test_add_func ("/parser/file-ref-quotes", test_file_ref_quotes);
+	g_test_add_func ("/parser/lookup", test_lookup);
+	g_test_add_func ("/parser/verify", test_verify);
+	g_test_add_func ("/parser/extract-existing-target", test_extract_existing_target);
+	g_test_add_func ("/parser/write-ova", test_write_ova);
+	g_test_add_func ("/parser/write-ova-large", test_write_ova_large);
+	g_test_add_func ("/parser/load-metadata-only", test_load_metadata_only);
+	g_test_add_func ("/parser/extract-options", test_extract_options);
+#ifdef HAVE_LIBURING
+	g_test_add_func ("/parser/extract-io-uring", test_extract_io_uring);
+#endif
+	g_test_add_func ("/parser/stats", test_stats);
+	g_test_add_func ("/parser/load-cache", test_load_cache);
+	g_test_add_func ("/parser/catalog", test_catalog);
+	g_test_add_func ("/parser/open-disk", test_open_disk);
 
 	return g_test_run ();
 }